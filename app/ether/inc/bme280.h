@@ -3,10 +3,14 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include "hal/i2c_types.h"
 #include "i2c_controller.h"
 
-#define BME280_I2C_ADDRESS  (0x76)
+#define BME280_I2C_ADDRESS            (0x76)   /*!< SDO to GND. */
+#define BME280_I2C_ADDRESS_SECONDARY  (0x77)   /*!< SDO to VDDIO. */
+#define BME280_I2C_RETRIES    (0x01)
+#define BME280_I2C_TIMEOUT_MS (25)
 
 #define BME280_REGISTER_ID        	(0xd0)
 #define BME280_REGISTER_RESET     	(0xe0)
@@ -69,6 +73,9 @@
 #define BME280_DATA_RESET (0xb6)
 #define BME280_DATA_ID    (0x60)
 
+#define BME280_STATUS_MEASURING (1 << 3)    /*!< Conversion running. */
+#define BME280_STATUS_IM_UPDATE (1 << 0)    /*!< NVM data being copied to the image registers. */
+
 #define BME280_SETTINGS_OSRS_H_SKIPPED  (0 << 0)
 #define BME280_SETTINGS_OSRS_H_1        (1 << 0)
 #define BME280_SETTINGS_OSRS_H_2        (2 << 0)
@@ -93,6 +100,22 @@
 #define BME280_SETTINGS_MODE_SLEEP      (0 << 0)
 #define BME280_SETTINGS_MODE_FORCE      (1 << 0)
 #define BME280_SETTINGS_MODE_NORMAL     (3 << 0)
+#define BME280_SETTINGS_MODE_MASK       (3 << 0)
+
+#define BME280_SETTINGS_T_SB_0_5        (0 << 5)    /*!< Standby 0.5 ms between normal mode conversions. */
+#define BME280_SETTINGS_T_SB_62_5       (1 << 5)
+#define BME280_SETTINGS_T_SB_125        (2 << 5)
+#define BME280_SETTINGS_T_SB_250        (3 << 5)
+#define BME280_SETTINGS_T_SB_500        (4 << 5)
+#define BME280_SETTINGS_T_SB_1000       (5 << 5)
+#define BME280_SETTINGS_T_SB_10         (6 << 5)
+#define BME280_SETTINGS_T_SB_20         (7 << 5)
+
+#define BME280_SETTINGS_FILTER_OFF      (0 << 2)    /*!< IIR filter coefficient, applies to temperature and pressure. */
+#define BME280_SETTINGS_FILTER_2        (1 << 2)
+#define BME280_SETTINGS_FILTER_4        (2 << 2)
+#define BME280_SETTINGS_FILTER_8        (3 << 2)
+#define BME280_SETTINGS_FILTER_16       (4 << 2)
 
 #define BME280_I2C_ACK_ENABLE   (0x01)
 #define BME280_I2C_ACK_DISABLE  (0x00)
@@ -100,7 +123,8 @@
 #define BME280_SIZE_HUM   (0x02)
 #define BME280_SIZE_PRESS (0x03)
 #define BME280_SIZE_TEMP  (0x03)
-#define BME280_SIZE_COMP  (0x21)
+#define BME280_SIZE_COMP  (0x21)   /*!< 26 bytes at 0x88...0xa1 and 7 at 0xe1...0xe7. */
+#define BME280_SIZE_DATA  (0x08)
 
 /** 
  * \brief Result codes for BME280 sensor operations.
@@ -118,13 +142,13 @@ typedef enum {
   BME280_STATE_RESET,                   /*!< Reset state. */
   BME280_STATE_ID,                      /*!< ID reading state. */
   BME280_STATE_FORCE_MODE,              /*!< Force mode state. */
+  BME280_STATE_WAIT,                    /*!< Conversion wait state. */
   BME280_STATE_MEASURE_HUMIDITY,        /*!< Humidity measurement state. */
   BME280_STATE_MEASURE_TEMPERATURE,     /*!< Temperature measurement state. */
   BME280_STATE_MEASURE_PRESSURE,        /*!< Pressure measurement state. */
+  BME280_STATE_MEASURE_ALL,             /*!< Burst measurement state. */
   BME280_STATE_GET_COMPENSATION_DATA,   /*!< Compensation data retrieval state. */
-  BME280_STATE_COMPENSATE_HUMIDITY,     /*!< Humidity compensation state. */
-  BME280_STATE_COMPENSATE_TEMPERATURE,  /*!< Temperature compensation state. */
-  BME280_STATE_COMPENSATE_PRESSURE,     /*!< Pressure compensation state. */
+  BME280_STATE_COMPENSATE,              /*!< Compensation state. */
   BME280_STATE_UNSET = 0xFF,            /*!< Unset state. */
 } bme280_state_t;
 
@@ -137,6 +161,36 @@ typedef struct {
   uint8_t config;     /*!< Configuration register value. */
 } bme280_settings_t;
 
+#if defined(BME280_COMPENSATION_INTEGER) && defined(BME280_COMPENSATION_FLOAT)
+#error "BME280_COMPENSATION_INTEGER and BME280_COMPENSATION_FLOAT are exclusive"
+#endif
+
+#if defined(BME280_COMPENSATION_INTEGER)
+typedef int32_t   bme280_temperature_compensated_t;   /*!< Temperature in 0.01 degC. */
+typedef uint32_t  bme280_pressure_compensated_t;      /*!< Pressure in Pa, Q24.8 (Pa * 256). */
+typedef uint32_t  bme280_humidity_compensated_t;      /*!< Relative humidity in %, Q22.10 (%RH * 1024). */
+
+#define BME280_TEMPERATURE_CELSIUS(compensated)   ((float)(compensated) / 100.0f)
+#define BME280_PRESSURE_PASCALS(compensated)      ((float)(compensated) / 256.0f)
+#define BME280_HUMIDITY_PERCENT(compensated)      ((float)(compensated) / 1024.0f)
+#elif defined(BME280_COMPENSATION_FLOAT)
+typedef float     bme280_temperature_compensated_t;   /*!< Temperature in degC. */
+typedef float     bme280_pressure_compensated_t;      /*!< Pressure in Pa. */
+typedef float     bme280_humidity_compensated_t;      /*!< Relative humidity in %. */
+
+#define BME280_TEMPERATURE_CELSIUS(compensated)   (compensated)
+#define BME280_PRESSURE_PASCALS(compensated)      (compensated)
+#define BME280_HUMIDITY_PERCENT(compensated)      (compensated)
+#else
+typedef double    bme280_temperature_compensated_t;   /*!< Temperature in degC. */
+typedef double    bme280_pressure_compensated_t;      /*!< Pressure in Pa. */
+typedef double    bme280_humidity_compensated_t;      /*!< Relative humidity in %. */
+
+#define BME280_TEMPERATURE_CELSIUS(compensated)   (compensated)
+#define BME280_PRESSURE_PASCALS(compensated)      (compensated)
+#define BME280_HUMIDITY_PERCENT(compensated)      (compensated)
+#endif
+
 /** 
  * \brief Structure for the BME280 sensor pressure data.
  */
@@ -144,7 +198,7 @@ typedef struct {
   uint8_t msb;          /*!< Most significant byte. */
   uint8_t lsb;          /*!< Least significant byte. */
   uint8_t xlsb;         /*!< Extended least significant byte. */
-  double  compensated;  /*!< Compensated pressure value. */
+  bme280_pressure_compensated_t compensated;      /*!< Compensated pressure value. */
 } bme280_pressure_t;
 
 /** 
@@ -154,7 +208,7 @@ typedef struct {
   uint8_t msb;          /*!< Most significant byte. */
   uint8_t lsb;          /*!< Least significant byte. */
   uint8_t xlsb;         /*!< Extended least significant byte. */
-  double  compensated;  /*!< Compensated temperature value. */
+  bme280_temperature_compensated_t compensated;   /*!< Compensated temperature value. */
 } bme280_temperature_t;
 
 /** 
@@ -163,7 +217,7 @@ typedef struct {
 typedef struct {
   uint8_t msb;          /*!< Most significant byte. */
   uint8_t lsb;          /*!< Least significant byte. */
-  double  compensated;  /*!< Compensated humidity value. */
+  bme280_humidity_compensated_t compensated;      /*!< Compensated humidity value. */
 } bme280_humidity_t;
 
 /** 
@@ -197,9 +251,45 @@ typedef struct {
   bme280_humidity_t humidity;         /*!< Humidity data. */
   bme280_pressure_t pressure;         /*!< Pressure data. */
   bme280_temperature_t temperature;   /*!< Temperature data. */
-  bme280_compensator_t compensator;   /*!< Compensator data. */
 } bme280_measurements_t;
 
+/** 
+ * \brief Packed BME280 sample for buffers that hold many readings.
+ *
+ * The raw values keep only their significant bits, the compensated ones
+ * are fixed point whatever compensation the build uses. 24 bytes against
+ * 48 for bme280_measurements_t with double compensation.
+ */
+typedef struct {
+  uint64_t adc_p : 20;      /*!< Raw pressure. */
+  uint64_t adc_t : 20;      /*!< Raw temperature. */
+  uint64_t adc_h : 16;      /*!< Raw humidity. */
+  uint64_t reserved : 8;    /*!< Unused, always zero. */
+  uint32_t timestamp_ms;    /*!< Time of the reading, wraps after ~49 days. */
+  int32_t temperature;      /*!< Temperature in 0.01 degC. */
+  int32_t pressure;         /*!< Pressure in Pa, Q24.8 (Pa * 256). */
+  int32_t humidity;         /*!< Relative humidity in %, Q22.10 (%RH * 1024). */
+} bme280_sample_t;
+
+_Static_assert(sizeof(bme280_sample_t) == 24, "bme280_sample_t must stay packed");
+
+#define BME280_SAMPLE_CELSIUS(sample)   ((float)(sample)->temperature / 100.0f)
+#define BME280_SAMPLE_PASCALS(sample)   ((float)(sample)->pressure / 256.0f)
+#define BME280_SAMPLE_PERCENT(sample)   ((float)(sample)->humidity / 1024.0f)
+
+/** 
+ * \brief Structure for a BME280 sensor instance.
+ *
+ * Everything a sensor needs lives here, so any number of them can be 
+ * driven at once, e.g. one at 0x76 and one at 0x77.
+ */
+typedef struct {
+  i2c_controller_device_t device;     /*!< I2C device of the sensor. */
+  bme280_settings_t settings;         /*!< Sensor settings. */
+  bme280_compensator_t compensator;   /*!< Calibration data read from the sensor. */
+  int32_t t_fine;                     /*!< Fine temperature shared by the compensations. */
+} bme280_dev_t;
+
 /**
  * Suggested settings for weather monitoring;
  * Sensor mode: force mode, 1 sample per minute;
@@ -211,108 +301,228 @@ typedef struct {
   .config = 0x00,                                                     \
 }
 
+/**
+ * Continuous sampling with filtered pressure;
+ * Sensor mode: normal mode, a conversion every ~1 s, IIR filter 4;
+ * The latest sample is read on demand, no mode write or conversion wait.
+ */
+#define BME280_SETTINGS_NORMAL {                                      \
+  .ctrl_hum = BME280_SETTINGS_OSRS_H_1,                               \
+  .ctrl_meas = (BME280_SETTINGS_OSRS_T_2 | BME280_SETTINGS_OSRS_P_4 | \
+                BME280_SETTINGS_MODE_NORMAL),                         \
+  .config = (BME280_SETTINGS_T_SB_1000 | BME280_SETTINGS_FILTER_4),   \
+}
+
+/**
+ * Pressure transients at the highest output rate;
+ * Sensor mode: normal mode, a conversion every ~7 ms, no IIR filter;
+ * Temperature stays at 1 sample, the pressure compensation needs t_fine.
+ */
+#define BME280_SETTINGS_CAPTURE {                                     \
+  .ctrl_hum = BME280_SETTINGS_OSRS_H_SKIPPED,                         \
+  .ctrl_meas = (BME280_SETTINGS_OSRS_T_1 | BME280_SETTINGS_OSRS_P_1 | \
+                BME280_SETTINGS_MODE_NORMAL),                         \
+  .config = (BME280_SETTINGS_T_SB_0_5 | BME280_SETTINGS_FILTER_OFF),  \
+}
+
 /** 
- * \brief Initialize the BME280 sensor.
+ * \brief Default I2C device for a BME280 sensor.
+ */
+#define BME280_DEVICE(port, addr) {                       \
+  .i2c_num = (port),                                      \
+  .address = (addr),                                      \
+  .clk_speed = I2C_CONTROLLER_FAST_FREQ_HZ,               \
+  .timeout_ms = BME280_I2C_TIMEOUT_MS,                    \
+  .retries = BME280_I2C_RETRIES,                          \
+  .probe_reg = BME280_REGISTER_ID,                        \
+}
+
+#define BME280_DEVICE_DEFAULT BME280_DEVICE(I2C_NUM_0, BME280_I2C_ADDRESS)
+
+/** 
+ * \brief Default BME280 sensor instance, calibration is read at runtime.
+ */
+#define BME280_DEV(port, addr) {                          \
+  .device = BME280_DEVICE((port), (addr)),                \
+  .settings = BME280_SETTINGS_DEFAULT,                    \
+  .compensator = { 0 },                                   \
+  .t_fine = 0,                                            \
+}
+
+#define BME280_DEV_DEFAULT BME280_DEV(I2C_NUM_0, BME280_I2C_ADDRESS)
+
+/** 
+ * \brief Initialize the BME280 sensor with its settings.
  * 
- * \param[in]   i2c_num: I2C port number.
- * \param[in]   settings: Pointer to sensor settings structure.
+ * \param[in]   dev: Pointer to the BME280 sensor.
  * \return      Result of the initialization.
  */
-bme280_result_t bme280_init(i2c_port_t i2c_num, const bme280_settings_t *settings);
+bme280_result_t bme280_init(bme280_dev_t *dev);
 
 /** 
  * \brief Reset the BME280 sensor.
  * 
- * \param[in]   i2c_num: I2C port number.
+ * \param[in]   dev: Pointer to the BME280 sensor.
  * \return      Result of the reset operation.
  */
-bme280_result_t bme280_reset(i2c_port_t i2c_num);
+bme280_result_t bme280_reset(bme280_dev_t *dev);
 
 /** 
  * \brief Read the sensor ID.
  * 
- * \param[in]   i2c_num: I2C port number.
+ * \param[in]   dev: Pointer to the BME280 sensor.
  * \param[out]  data: Pointer to buffer to store ID data.
  * \param[in]   data_len: Length of the buffer.
  * \return      Result of the ID read operation.
  */
-bme280_result_t bme280_id(i2c_port_t i2c_num, uint8_t *data, size_t data_len);
+bme280_result_t bme280_id(bme280_dev_t *dev, uint8_t *data, size_t data_len);
 
 /** 
- * \brief Set the sensor to force mode.
+ * \brief Set the sensor to the mode of its settings, starts a forced measurement.
  * 
- * \param[in]   i2c_num: I2C port number.
- * \param[in]   settings: Pointer to sensor settings structure.
+ * \param[in]   dev: Pointer to the BME280 sensor.
  * \return      Result of the operation.
  */
-bme280_result_t bme280_force_mode(i2c_port_t i2c_num, const bme280_settings_t *settings);
+bme280_result_t bme280_force_mode(bme280_dev_t *dev);
+
+/** 
+ * \brief Check whether the sensor converts continuously (normal mode).
+ * 
+ * \param[in]   dev: Pointer to the BME280 sensor.
+ * \return      True in normal mode, the data registers then always hold the latest sample.
+ */
+bool bme280_continuous(const bme280_dev_t *dev);
+
+/** 
+ * \brief Get the conversion time of the given settings.
+ *
+ * Datasheet, appendix B: 1.25 + 2.3 * osrs_t + (2.3 * osrs_p + 0.575) + 
+ * (2.3 * osrs_h + 0.575) ms at most, a skipped measurement adds nothing.
+ * The typical time uses 1, 2 and 0.5 ms instead.
+ * 
+ * \param[in]   settings: Pointer to sensor settings structure.
+ * \param[in]   max: True for the maximum time, false for the typical one.
+ * \return      Conversion time in microseconds.
+ */
+uint32_t bme280_measurement_time_us(const bme280_settings_t *settings, bool max);
+
+/** 
+ * \brief Pack compensated measurements into a sample.
+ * 
+ * \param[in]   measurements: Pointer to the compensated measurements.
+ * \param[in]   timestamp_ms: Time of the reading.
+ * \param[out]  sample: Pointer to the sample.
+ * \return      Result of the packing.
+ */
+bme280_result_t bme280_sample_pack(const bme280_measurements_t *measurements, uint32_t timestamp_ms, 
+                                   bme280_sample_t *sample);
+
+/** 
+ * \brief Unpack a sample into measurements, raw and compensated values both.
+ * 
+ * \param[in]   sample: Pointer to the sample.
+ * \param[out]  measurements: Pointer to the measurements.
+ * \return      Result of the unpacking.
+ */
+bme280_result_t bme280_sample_unpack(const bme280_sample_t *sample, bme280_measurements_t *measurements);
+
+/** 
+ * \brief Get the normal mode standby time of the given settings.
+ * 
+ * \param[in]   settings: Pointer to sensor settings structure.
+ * \return      Standby time in microseconds.
+ */
+uint32_t bme280_standby_time_us(const bme280_settings_t *settings);
+
+/** 
+ * \brief Wait for the forced conversion to finish.
+ *
+ * Sleeps for the typical conversion time, then polls the measuring bit of
+ * the status register until it clears or the maximum time has passed.
+ * 
+ * \param[in]   dev: Pointer to the BME280 sensor.
+ * \return      Result of the wait, an error when the conversion never ended.
+ */
+bme280_result_t bme280_wait(bme280_dev_t *dev);
 
 /** 
  * \brief Measure humidity.
  * 
- * \param[in]   i2c_num: I2C port number.
+ * \param[in]   dev: Pointer to the BME280 sensor.
  * \param[out]  humidity: Pointer to humidity structure to store the measurement.
  * \return      Result of the humidity measurement.
  */
-bme280_result_t bme280_measure_humidity(i2c_port_t i2c_num, bme280_humidity_t *humidity);
+bme280_result_t bme280_measure_humidity(bme280_dev_t *dev, bme280_humidity_t *humidity);
 
 /** 
  * \brief Measure temperature.
  * 
- * \param[in]   i2c_num: I2C port number.
+ * \param[in]   dev: Pointer to the BME280 sensor.
  * \param[out]  temperature: Pointer to temperature structure to store the measurement.
  * \return      Result of the temperature measurement.
  */
-bme280_result_t bme280_measure_temperature(i2c_port_t i2c_num, 
-                                           bme280_temperature_t *temperature);
+bme280_result_t bme280_measure_temperature(bme280_dev_t *dev, bme280_temperature_t *temperature);
 
 /** 
  * \brief Measure pressure.
  * 
- * \param[in]   i2c_num: I2C port number.
+ * \param[in]   dev: Pointer to the BME280 sensor.
  * \param[out]  pressure: Pointer to pressure structure to store the measurement.
  * \return      Result of the pressure measurement.
  */
-bme280_result_t bme280_measure_pressure(i2c_port_t i2c_num, bme280_pressure_t *pressure);
+bme280_result_t bme280_measure_pressure(bme280_dev_t *dev, bme280_pressure_t *pressure);
 
 /** 
- * \brief Get sensor compensation data.
+ * \brief Measure pressure, temperature and humidity in a single burst read.
+ *
+ * Reads the whole data block (0xf7...0xfe) at once, so all three values 
+ * come from the same measurement cycle.
  * 
- * \param[in]   i2c_num: I2C port number.
- * \param[out]  compensator: Pointer to compensator structure to store the data.
- * \return      Result of the compensation data retrieval.
+ * \param[in]   dev: Pointer to the BME280 sensor.
+ * \param[out]  measurements: Pointer to measurements structure to store the data.
+ * \return      Result of the burst measurement.
+ */
+bme280_result_t bme280_measure_all(bme280_dev_t *dev, bme280_measurements_t *measurements);
+
+/** 
+ * \brief Read the raw calibration block (0x88...0xa1, 0xe1...0xe7).
+ * 
+ * \param[in]   dev: Pointer to the BME280 sensor.
+ * \param[out]  data: Pointer to buffer of at least BME280_SIZE_COMP bytes.
+ * \param[in]   data_len: Length of the buffer.
+ * \return      Result of the calibration read.
  */
-bme280_result_t bme280_get_compensation_data(i2c_port_t i2c_num, 
-                                             bme280_compensator_t *compensator);
+bme280_result_t bme280_read_calibration(bme280_dev_t *dev, uint8_t *data, size_t data_len);
 
 /** 
- * \brief Compensate the humidity measurement.
+ * \brief Parse a raw calibration block read by bme280_read_calibration().
  * 
- * \param[in]   compensator: Pointer to compensator structure with calibration data.
- * \param[out]  humidity: Pointer to humidity structure to store compensated value.
- * \return      Result of the humidity compensation.
+ * \param[in]   data: Pointer to the raw calibration block.
+ * \param[in]   data_len: Length of the block.
+ * \param[out]  compensator: Pointer to compensator structure to store the data.
+ * \return      Result of the parsing.
  */
-bme280_result_t bme280_compensate_humidity(bme280_compensator_t *compensator, 
-                                           bme280_humidity_t *humidity);
+bme280_result_t bme280_parse_calibration(const uint8_t *data, size_t data_len, 
+                                         bme280_compensator_t *compensator);
 
 /** 
- * \brief Compensate the temperature measurement.
+ * \brief Read the sensor calibration data into the sensor instance.
  * 
- * \param[in]   compensator: Pointer to compensator structure with calibration data.
- * \param[out]  temperature: Pointer to temperature structure to store compensated value.
- * \return      Result of the temperature compensation.
+ * \param[in,out] dev: Pointer to the BME280 sensor.
+ * \return      Result of the compensation data retrieval.
  */
-bme280_result_t bme280_compensate_temperature(bme280_compensator_t *compensator, 
-                                              bme280_temperature_t *temperature);
+bme280_result_t bme280_get_compensation_data(bme280_dev_t *dev);
 
 /** 
- * \brief Compensate the pressure measurement.
+ * \brief Compensate all the measurements in a single pass.
+ *
+ * Temperature goes first, pressure and humidity use the t_fine it leaves 
+ * in the sensor instance, so all three come from the same cycle.
  * 
- * \param[in]   compensator: Pointer to compensator structure with calibration data.
- * \param[out]  pressure: Pointer to pressure structure to store compensated value.
- * \return      Result of the pressure compensation.
+ * \param[in,out] dev: Pointer to the BME280 sensor.
+ * \param[in,out] measurements: Pointer to raw measurements, compensated in place.
+ * \return      Result of the compensation.
  */
-bme280_result_t bme280_compensate_pressure(bme280_compensator_t *compensator, 
-                                           bme280_pressure_t *pressure);
+bme280_result_t bme280_compensate(bme280_dev_t *dev, bme280_measurements_t *measurements);
 
 #endif // !INC_BME280_H
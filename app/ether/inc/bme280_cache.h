@@ -0,0 +1,64 @@
+#ifndef INC_BME280_CACHE_H
+#define INC_BME280_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bme280.h"
+
+#define BME280_CACHE_MAGIC          (0x42453238)   /*!< "BE28", marks an initialized entry. */
+#define BME280_CACHE_ENTRIES        (2)            /*!< Sensors kept in RTC memory, e.g. 0x76 and 0x77. */
+#define BME280_CACHE_NVS_NAMESPACE  "bme280"       /*!< NVS namespace of the calibration blobs. */
+#define BME280_CACHE_VERIFY_SIZE    (6)            /*!< dig_T1...dig_T3, read back before an NVS blob is used. */
+
+/** 
+ * \brief Result codes for BME280 cache operations.
+ */
+typedef enum {
+  BME280_CACHE_RESULT_SUCCESS = 0,   /*!< Operation was successful. */
+  BME280_CACHE_RESULT_ERROR,         /*!< Operation encountered an error, or nothing was cached. */
+} bme280_cache_result_t;
+
+/** 
+ * \brief Structure for the cached calibration of one sensor.
+ *
+ * The raw block is kept instead of the parsed coefficients, so the entry
+ * does not depend on the layout of bme280_compensator_t.
+ */
+typedef struct {
+  uint32_t magic;                   /*!< BME280_CACHE_MAGIC when the entry is in use. */
+  uint8_t chip_id;                  /*!< Chip ID read from the sensor. */
+  uint8_t address;                  /*!< I2C address of the sensor. */
+  uint8_t i2c_num;                  /*!< I2C port number of the sensor. */
+  uint8_t reserved;                 /*!< Padding, always zero. */
+  uint8_t raw[BME280_SIZE_COMP];    /*!< Raw calibration block. */
+  uint32_t raw_crc;                 /*!< CRC32 of the raw calibration block. */
+} bme280_cache_entry_t;
+
+/** 
+ * \brief Load the cached calibration of a sensor, RTC memory first, then NVS.
+ *
+ * RTC memory is trusted as is. A blob from NVS is used only when dig_T read
+ * back from the sensor matches it, otherwise the sensor was replaced and the
+ * calibration has to be read again.
+ *
+ * \param[out]  dev: Pointer to the BME280 sensor, its compensator is filled on success.
+ * \param[in]   chip_id: Chip ID of the sensor.
+ * \return      Result of the load operation.
+ */
+bme280_cache_result_t bme280_cache_load(bme280_dev_t *dev, uint8_t chip_id);
+
+/** 
+ * \brief Store the calibration of a sensor in RTC memory and NVS.
+ *
+ * NVS is written only when the block differs from the one already there.
+ *
+ * \param[in]   dev: Pointer to the BME280 sensor.
+ * \param[in]   chip_id: Chip ID of the sensor.
+ * \param[in]   raw: Pointer to the raw calibration block.
+ * \param[in]   raw_len: Length of the raw calibration block.
+ * \return      Result of the store operation.
+ */
+bme280_cache_result_t bme280_cache_store(const bme280_dev_t *dev, uint8_t chip_id,
+                                         const uint8_t *raw, size_t raw_len);
+
+#endif // !INC_BME280_CACHE_H
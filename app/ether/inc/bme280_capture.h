@@ -0,0 +1,153 @@
+#ifndef INC_BME280_CAPTURE_H
+#define INC_BME280_CAPTURE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "bme280.h"
+
+#define BME280_CAPTURE_SIZE               (512)                       /*!< Ring slots, a power of two, ~3.5 s at the capture rate. */
+#define BME280_CAPTURE_TASK_STACK_SIZE    (3072)                      /*!< Sampling task stack size. */
+#define BME280_CAPTURE_TASK_PRIORITY      (configMAX_PRIORITIES - 2)  /*!< Sampling task priority. */
+#define BME280_CAPTURE_WINDOW_US          (1000000)                   /*!< Length of a summary window. */
+#define BME280_CAPTURE_THRESHOLD_PA       (15.0)                      /*!< Deviation from the baseline that triggers a window. */
+#define BME280_CAPTURE_BASELINE_WEIGHT    (0.05)                      /*!< Weight of a quiet window in the baseline. */
+
+_Static_assert((BME280_CAPTURE_SIZE & (BME280_CAPTURE_SIZE - 1)) == 0, "BME280_CAPTURE_SIZE must be a power of two");
+
+/** 
+ * \brief Result codes for BME280 capture operations.
+ */
+typedef enum {
+  BME280_CAPTURE_RESULT_SUCCESS = 0,   /*!< Operation was successful. */
+  BME280_CAPTURE_RESULT_ERROR,         /*!< Operation encountered an error. */
+} bme280_capture_result_t;
+
+/** 
+ * \brief Structure for a raw sample, as read from the data registers.
+ */
+typedef struct {
+  uint32_t timestamp_us;    /*!< esp_timer time of the read, wraps after ~71 minutes. */
+  uint8_t pressure[3];      /*!< Pressure msb, lsb and xlsb. */
+  uint8_t temperature[3];   /*!< Temperature msb, lsb and xlsb. */
+} bme280_capture_sample_t;
+
+/** 
+ * \brief Single producer, single consumer ring of raw samples.
+ *
+ * The indices run freely and are masked on access; each one is written by
+ * one side only, so neither side takes a lock or waits for the other.
+ */
+typedef struct {
+  bme280_capture_sample_t samples[BME280_CAPTURE_SIZE];   /*!< Sample slots. */
+  atomic_uint_fast32_t head;                              /*!< Next slot to write, owned by the producer. */
+  atomic_uint_fast32_t tail;                              /*!< Next slot to read, owned by the consumer. */
+  atomic_uint_fast32_t overruns;                          /*!< Samples dropped on a full ring. */
+} bme280_capture_ring_t;
+
+/** 
+ * \brief Structure for a closed summary window.
+ */
+typedef struct {
+  uint32_t start_us;              /*!< Timestamp of the first sample. */
+  uint32_t peak_us;               /*!< Timestamp of the sample furthest from the baseline. */
+  uint32_t count;                 /*!< Samples in the window. */
+  uint32_t overruns;              /*!< Samples dropped since the previous window. */
+  double mean;                    /*!< Mean pressure in pascals. */
+  double min;                     /*!< Lowest pressure in pascals. */
+  double max;                     /*!< Highest pressure in pascals. */
+  double baseline;                /*!< Baseline the window was compared against. */
+  bme280_sample_t latest;         /*!< Last sample of the window. */
+  bool triggered;                 /*!< True when a sample left the baseline by the threshold. */
+} bme280_capture_summary_t;
+
+/** 
+ * \brief Structure for the downsampling and transient detection stage.
+ */
+typedef struct {
+  bme280_capture_summary_t window;    /*!< Window being filled. */
+  double sum;                         /*!< Pressure sum of the window. */
+  double peak;                        /*!< Largest deviation from the baseline. */
+  double baseline;                    /*!< Slow average of the window means, 0 until the first sample. */
+  uint32_t overruns;                  /*!< Ring overruns seen so far. */
+} bme280_capture_detector_t;
+
+/** 
+ * \brief Structure for a running capture.
+ */
+typedef struct {
+  bme280_dev_t *dev;                  /*!< Sensor, in BME280_SETTINGS_CAPTURE. */
+  bme280_capture_ring_t ring;         /*!< Raw samples. */
+  esp_timer_handle_t timer;           /*!< Periodic sampling timer. */
+  TaskHandle_t task;                  /*!< Sampling task. */
+  atomic_uint_fast32_t errors;        /*!< Failed reads. */
+  atomic_bool running;                /*!< Cleared to let the sampling task leave. */
+} bme280_capture_t;
+
+/** 
+ * \brief Put a sample into the ring, the sample is dropped when the ring is full.
+ *
+ * \param[in]   ring: Pointer to the ring.
+ * \param[in]   sample: Pointer to the sample.
+ * \return      True when the sample was stored.
+ */
+bool bme280_capture_push(bme280_capture_ring_t *ring, const bme280_capture_sample_t *sample);
+
+/** 
+ * \brief Take the oldest sample out of the ring.
+ *
+ * \param[in]   ring: Pointer to the ring.
+ * \param[out]  sample: Pointer to the sample.
+ * \return      True when a sample was taken.
+ */
+bool bme280_capture_pop(bme280_capture_ring_t *ring, bme280_capture_sample_t *sample);
+
+/** 
+ * \brief Read the latest pressure and temperature in one burst.
+ *
+ * \param[in]   dev: Pointer to the BME280 sensor.
+ * \param[out]  sample: Pointer to the sample.
+ * \return      Result of the read.
+ */
+bme280_capture_result_t bme280_capture_read(bme280_dev_t *dev, bme280_capture_sample_t *sample);
+
+/** 
+ * \brief Start sampling at the output rate of the sensor settings.
+ *
+ * The sensor must be initialized and calibrated. The capture owns the bus
+ * access to it until bme280_capture_stop().
+ *
+ * \param[out]  capture: Pointer to the capture.
+ * \param[in]   dev: Pointer to the BME280 sensor.
+ * \return      Result of the start.
+ */
+bme280_capture_result_t bme280_capture_start(bme280_capture_t *capture, bme280_dev_t *dev);
+
+/** 
+ * \brief Stop sampling, the samples in the ring stay readable.
+ *
+ * \param[in]   capture: Pointer to the capture.
+ * \return      Result of the stop.
+ */
+bme280_capture_result_t bme280_capture_stop(bme280_capture_t *capture);
+
+/** 
+ * \brief Feed a raw sample to the detector.
+ *
+ * Compensates the sample, adds it to the current window and closes the
+ * window once BME280_CAPTURE_WINDOW_US has passed.
+ *
+ * \param[in]   detector: Pointer to the detector.
+ * \param[in]   capture: Pointer to the capture the sample came from.
+ * \param[in]   sample: Pointer to the sample.
+ * \param[out]  summary: Pointer to the closed window.
+ * \return      True when a window was closed into summary.
+ */
+bool bme280_capture_process(bme280_capture_detector_t *detector, bme280_capture_t *capture,
+                            const bme280_capture_sample_t *sample, bme280_capture_summary_t *summary);
+
+#endif // !INC_BME280_CAPTURE_H
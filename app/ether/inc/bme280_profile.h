@@ -0,0 +1,73 @@
+#ifndef INC_BME280_PROFILE_H
+#define INC_BME280_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "bme280.h"
+
+#define BME280_PROFILE_WINDOW           (8)       /*!< Samples observed before a profile decision. */
+#define BME280_PROFILE_NOISE_TARGET_PA  (3.0f)    /*!< Pressure noise the selected profile should stay under. */
+#define BME280_PROFILE_RATE_FAST_PA     (20.0f)   /*!< Mean change per sample above which a long IIR lags too much. */
+#define BME280_PROFILE_SMOOTHING        (0.5f)    /*!< Weight of the newest window in the noise estimate. */
+
+/** 
+ * \brief Oversampling profiles, from the cheapest to the quietest.
+ */
+typedef enum {
+  BME280_PROFILE_LOW = 0,       /*!< T x1, P x1, H x1, filter off. */
+  BME280_PROFILE_STANDARD,      /*!< T x2, P x4, H x1, filter 4, the BME280_SETTINGS_NORMAL oversampling. */
+  BME280_PROFILE_HIGH,          /*!< T x2, P x16, H x1, filter 4. */
+  BME280_PROFILE_ULTRA,         /*!< T x2, P x16, H x1, filter 16. */
+  BME280_PROFILE_COUNT,         /*!< Number of profiles. */
+} bme280_profile_level_t;
+
+/** 
+ * \brief Structure for the adaptive profile engine of one sensor.
+ */
+typedef struct {
+  float pressure[BME280_PROFILE_WINDOW];    /*!< Pressures of the current window in pascals. */
+  uint8_t count;                            /*!< Samples in the current window. */
+  float variance;                           /*!< Smoothed pressure noise before the profile, Pa^2, 0 until the first window. */
+  bme280_profile_level_t level;             /*!< Profile the sensor runs with. */
+  uint32_t changes;                         /*!< Profile changes so far. */
+} bme280_profile_t;
+
+#define BME280_PROFILE_DEFAULT {          \
+  .pressure = { 0 },                      \
+  .count = 0,                             \
+  .variance = 0.0f,                       \
+  .level = BME280_PROFILE_STANDARD,       \
+  .changes = 0,                           \
+}
+
+/** 
+ * \brief Write a profile into the sensor settings, mode and standby time are kept.
+ *
+ * Only the settings change, bme280_init() takes them to the sensor.
+ *
+ * \param[out]  dev: Pointer to the BME280 sensor.
+ * \param[in]   level: Profile to apply.
+ * \return      Result of the operation.
+ */
+bme280_result_t bme280_profile_apply(bme280_dev_t *dev, bme280_profile_level_t level);
+
+/** 
+ * \brief Feed a compensated sample and pick the profile the signal needs.
+ *
+ * Decides once per BME280_PROFILE_WINDOW samples. The noise is estimated
+ * from the sample to sample differences, which leaves a steady trend out,
+ * scaled back by what the current profile already removes and smoothed
+ * over the windows. The cheapest profile that brings it under
+ * BME280_PROFILE_NOISE_TARGET_PA wins; stepping down needs half of it.
+ * A fast trend rules out the 16 coefficient filter. The samples are
+ * assumed further apart than the filter settles, as in the 60 s cycle.
+ *
+ * \param[in,out] profile: Pointer to the profile engine.
+ * \param[in,out] dev: Pointer to the BME280 sensor, its settings follow the profile.
+ * \param[in]   measurements: Pointer to the compensated measurements.
+ * \return      True when the settings changed and bme280_init() has to run.
+ */
+bool bme280_profile_update(bme280_profile_t *profile, bme280_dev_t *dev,
+                           const bme280_measurements_t *measurements);
+
+#endif // !INC_BME280_PROFILE_H
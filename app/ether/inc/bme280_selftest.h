@@ -0,0 +1,40 @@
+#ifndef INC_BME280_SELFTEST_H
+#define INC_BME280_SELFTEST_H
+
+#include <stdint.h>
+
+#define BME280_SELFTEST_ITERATIONS  (1000)   /*!< Compensations timed by the benchmark. */
+
+/** 
+ * \brief Result codes for BME280 self test operations.
+ */
+typedef enum {
+  BME280_SELFTEST_RESULT_SUCCESS = 0,   /*!< Every vector matched. */
+  BME280_SELFTEST_RESULT_ERROR,         /*!< At least one vector did not match. */
+} bme280_selftest_result_t;
+
+/** 
+ * \brief Structure for the outcome of a self test run.
+ */
+typedef struct {
+  uint32_t checks;        /*!< Values compared against the reference. */
+  uint32_t failures;      /*!< Values off the reference. */
+  uint32_t cycles_min;    /*!< Fewest CPU cycles of one bme280_compensate() call. */
+  uint32_t cycles_mean;   /*!< Mean CPU cycles of one bme280_compensate() call. */
+} bme280_selftest_report_t;
+
+/** 
+ * \brief Check calibration parsing and compensation against reference vectors, then time the compensation.
+ *
+ * The compensation checked is the one compiled in, integer with
+ * BME280_COMPENSATION_INTEGER, float with BME280_COMPENSATION_FLOAT and
+ * double otherwise, each against its own tolerances. Cycles come from
+ * esp_cpu_get_cycle_count(), the host test shim maps it to the time stamp
+ * counter.
+ *
+ * \param[out]  report: Pointer to the report.
+ * \return      Result of the self test.
+ */
+bme280_selftest_result_t bme280_selftest_run(bme280_selftest_report_t *report);
+
+#endif // !INC_BME280_SELFTEST_H
@@ -5,6 +5,7 @@
 #include "freertos/projdefs.h"
 #include "freertos/task.h"
 #include "esp_system.h"
+#include "esp_sleep.h"
 #include "esp_log.h"
 #include "esp_task_wdt.h"
 #include "driver/uart.h"
@@ -13,13 +14,33 @@
 #include "string.h"
 #include "driver/gpio.h"
 #include "pms7003.h"
+#include "pms7003_aggregate.h"
+#include "pms7003_receiver.h"
+#include "pms7003_scheduler.h"
 #include "bme280.h"
+#include "bme280_cache.h"
+#include "bme280_capture.h"
+#include "bme280_profile.h"
+#include "bme280_selftest.h"
+#include "psychrometrics.h"
 #include "i2c_controller.h"
 #include "mqtt_client.h"
 #include "uart_controller.h"
 #include "wifi_controller.h"
 #include "mqtt_controller.h"
 
+#if !defined(ETHER_ALTITUDE_M)
+#define ETHER_ALTITUDE_M  (0)   /*!< Sensor altitude for the sea level pressure, set from CMake. */
+#endif
+
+#if !defined(ETHER_PMS7003_PERIOD_S)
+#define ETHER_PMS7003_PERIOD_S  (0)   /*!< Wanted time between PMS7003 readings, set from CMake. */
+#endif
+
+#if !defined(ETHER_PMS7003_SERVICE_H)
+#define ETHER_PMS7003_SERVICE_H (0)   /*!< Wanted PMS7003 fan service life, set from CMake. */
+#endif
+
 /** 
  * \brief Result codes for ETHER operations.
  */
@@ -34,6 +55,7 @@ typedef enum {
 typedef struct {
   pms7003_measurements_t pms7003;   /*!< PMS7003 measurements. */
   bme280_measurements_t bme280;     /*!< BME280 measurements. */
+  psychrometrics_t psychrometrics;  /*!< Quantities derived from the BME280 measurements. */
 } ether_measurements_t;
 
 /** 
@@ -41,18 +63,15 @@ typedef struct {
  */
 typedef struct {
   i2c_controller_descriptor_t i2c_controller;     /*!< I2C controller descriptor. */
+  bme280_dev_t bme280;                            /*!< BME280 sensor. */
+  bme280_profile_t bme280_profile;                /*!< Adaptive oversampling of the BME280 sensor. */
   mqtt_controller_descriptor_t mqtt_controller;   /*!< MQTT controller descriptor. */
   uart_controller_descriptor_t uart_controller;   /*!< UART controller descriptor. */
+  pms7003_receiver_t pms7003_receiver;            /*!< PMS7003 frame receiver. */
+  pms7003_scheduler_t pms7003_scheduler;          /*!< PMS7003 fan duty cycle scheduler. */
   wifi_controller_descriptor_t wifi_controller;   /*!< WIFI controller descriptor. */
 } ether_descriptor_t;
 
-/** 
- * \brief Structure for ETHER settings.
- */
-typedef struct {
-  bme280_settings_t bme280;   /*!< BME280 sensor settings. */
-} ether_settings_t;
-
 /** 
  * \brief Structure to hold the state machine for PMS7003 and BME280 sensors.
  */
@@ -62,12 +81,11 @@ typedef struct {
 } ether_state_machine_t;
 
 /** 
- * \brief Main structure for ETHER containing measurements, descriptors, settings, and state machine.
+ * \brief Main structure for ETHER containing measurements, descriptors and state machine.
  */
 typedef struct {
   ether_measurements_t measurements;      /*!< Measurements data. */
   ether_descriptor_t descriptor;          /*!< Controller descriptors. */
-  ether_settings_t settings;              /*!< Settings data. */
   ether_state_machine_t state_machine;    /*!< State machine data. */
 } ether_t;
 
@@ -3,12 +3,23 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
 #include "driver/i2c.h"
+#include "driver/gpio.h"
+#include "esp_rom_sys.h"
 #include "esp_log.h"
 #include "hal/gpio_types.h"
 #include "hal/i2c_types.h"
 #include "soc/gpio_num.h"
+#include "freertos/FreeRTOS.h"
 #include "freertos/projdefs.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#if defined(I2C_CONTROLLER_SIMULATOR)
+#include "i2c_simulator.h"
+#endif
 
 #define I2C_CONTROLLER_I2C_ACK_ENABLE   (0x01)
 #define I2C_CONTROLLER_I2C_ACK_DISABLE  (0x00)
@@ -18,10 +29,45 @@
 
 #define I2C_CONTROLLER_MASTER_SCL_IO          (GPIO_NUM_22)     /*!< GPIO number for I2C master clock. */
 #define I2C_CONTROLLER_MASTER_SDA_IO          (GPIO_NUM_21)     /*!< GPIO number for I2C master data.  */
-#define I2C_CONTROLLER_MASTER_FREQ_HZ         (100000)          /*!< I2C master clock frequency. */
+#define I2C_CONTROLLER_MASTER_FREQ_HZ         (100000)          /*!< I2C master clock frequency, the safe fallback. */
+#define I2C_CONTROLLER_MEDIUM_FREQ_HZ         (200000)          /*!< Intermediate fallback clock frequency. */
+#define I2C_CONTROLLER_FAST_FREQ_HZ           (400000)          /*!< Fast-mode clock frequency. */
 #define I2C_CONTROLLER_MASTER_TX_BUF_DISABLE  (0)               /*!< I2C master doesn't need buffer. */
 #define I2C_CONTROLLER_MASTER_RX_BUF_DISABLE  (0)               /*!< I2C master doesn't need buffer. */
 
+/*
+ * The worst case is a register write followed by a repeated-START read, two 
+ * transactions for I2C_LINK_RECOMMENDED_SIZE(), which counts 5 commands each. 
+ * They take 9 commands (START, address W, prefix, data, START, address R, 
+ * read, last read, STOP), 5 transactions' worth leaves room for 25.
+ */
+#define I2C_CONTROLLER_CMD_LINK_TRANSACTIONS  (5)               /*!< Transactions the command link buffer is sized for. */
+#define I2C_CONTROLLER_CMD_LINK_SIZE          (I2C_LINK_RECOMMENDED_SIZE(I2C_CONTROLLER_CMD_LINK_TRANSACTIONS))
+
+#define I2C_CONTROLLER_DEVICES_MAX            (4)               /*!< Devices per bus. */
+#define I2C_CONTROLLER_SHADOW_SIZE            (8)               /*!< Shadowed registers per device. */
+#define I2C_CONTROLLER_TIMEOUT_MS_DEFAULT     (100)             /*!< Deadline for bus access and transfer. */
+
+#define I2C_CONTROLLER_RECOVER_PULSES         (9)               /*!< SCL pulses of the bus clear sequence. */
+#define I2C_CONTROLLER_RECOVER_HALF_PERIOD_US (5)               /*!< Half period of a bus clear pulse (100 kHz). */
+
+#define I2C_CONTROLLER_PROBE_READS            (4)               /*!< Read-backs per device and clock. */
+#define I2C_CONTROLLER_PROBE_TIMEOUT_MS       (50)              /*!< Limit for a single probe read. */
+#define I2C_CONTROLLER_HEALTH_WINDOW          (64)              /*!< Transfers in a health window. */
+#define I2C_CONTROLLER_HEALTH_ERRORS_MAX      (4)               /*!< Errors in a window that step the clock down. */
+
+#define I2C_CONTROLLER_ASYNC_QUEUE_LENGTH     (8)                         /*!< Pending asynchronous transactions. */
+#define I2C_CONTROLLER_ASYNC_TASK_STACK_SIZE  (4096)                      /*!< Worker task stack size. */
+#define I2C_CONTROLLER_ASYNC_TASK_PRIORITY    (tskIDLE_PRIORITY + 5)      /*!< Worker task priority, an ordinary one. */
+
+#define I2C_CONTROLLER_NOTIFY_INDEX           (1)       /*!< Notification slot of the completions, 0 stays free for the tasks. */
+#define I2C_CONTROLLER_NOTIFY_SUCCESS         (1 << 0)  /*!< Notification bit set on success. */
+#define I2C_CONTROLLER_NOTIFY_ERROR           (1 << 1)  /*!< Notification bit set on failure. */
+
+#if (configTASK_NOTIFICATION_ARRAY_ENTRIES <= I2C_CONTROLLER_NOTIFY_INDEX)
+#error "CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES must be 2 or more for the I2C completions"
+#endif
+
 /** 
  * \brief Result codes for I2C controller operations.
  */
@@ -30,6 +76,82 @@ typedef enum {
   I2C_CONTROLLER_RESULT_ERROR,        /*!< Operation encountered an error. */
 } i2c_controller_result_t;
 
+/** 
+ * \brief Structure for a device attached to an I2C bus.
+ */
+typedef struct {
+  i2c_port_t i2c_num;     /*!< I2C port number of the bus. */
+  uint8_t address;        /*!< I2C address of the device. */
+  uint32_t clk_speed;     /*!< Fastest bus clock supported by the device, 0 for no limit. */
+  uint32_t timeout_ms;    /*!< Deadline for a whole call, bus access and retries included. */
+  uint8_t retries;        /*!< Extra attempts after a failed transfer. */
+  uint8_t probe_reg;      /*!< Register read back by the bus probe. */
+} i2c_controller_device_t;
+
+/** 
+ * \brief Structure for a register/value pair, an array of them is sent as is.
+ */
+typedef struct {
+  uint8_t reg;      /*!< Register address. */
+  uint8_t value;    /*!< Value to write. */
+} i2c_controller_pair_t;
+
+_Static_assert(sizeof(i2c_controller_pair_t) == 2, "pairs must pack without padding");
+
+/** 
+ * \brief Structure for I2C bus health counters.
+ */
+typedef struct {
+  uint32_t transfers;       /*!< Transfers attempted, retries included. */
+  uint32_t nacks;           /*!< Transfers not acknowledged. */
+  uint32_t timeouts;        /*!< Transfers timed out. */
+  uint32_t clk_downgrades;  /*!< Clock steps down caused by errors. */
+  uint32_t recoveries;      /*!< Bus clear sequences run. */
+  uint32_t writes_skipped;  /*!< Cached writes matching the register shadow. */
+  uint32_t clk_speed;       /*!< Current bus clock limit. */
+} i2c_controller_health_t;
+
+/** 
+ * \brief Device with the controller defaults, used by the port level API.
+ */
+#define I2C_CONTROLLER_DEVICE_DEFAULT(port, addr) {   \
+  .i2c_num = (port),                                  \
+  .address = (addr),                                  \
+  .clk_speed = 0,                                     \
+  .timeout_ms = I2C_CONTROLLER_TIMEOUT_MS_DEFAULT,    \
+  .retries = 0,                                       \
+  .probe_reg = 0,                                     \
+}
+
+/** 
+ * \brief Callback function type for completed asynchronous transactions.
+ * 
+ * Called from the I2C worker task context.
+ *
+ * \param[in]   result: Result of the transaction.
+ * \param[in]   arg: User argument given with the transaction.
+ */
+typedef void (*i2c_controller_callback_t)(i2c_controller_result_t, void *);
+
+/** 
+ * \brief Structure for an asynchronous I2C transaction.
+ *
+ * The transaction is copied into the queue, but the data buffers are not, 
+ * they must stay valid until the transaction completes. A registered device 
+ * at the address is accessed with its settings and register shadow.
+ */
+typedef struct {
+  i2c_port_t i2c_num;                   /*!< I2C port number. */
+  uint8_t address;                      /*!< I2C address of the device. */
+  const uint8_t *write_data;            /*!< Data to send, NULL if none. */
+  size_t write_len;                     /*!< Length of the data to send. */
+  uint8_t *read_data;                   /*!< Buffer for received data, NULL if none. */
+  size_t read_len;                      /*!< Length of the data to receive. */
+  i2c_controller_callback_t callback;   /*!< Completion callback, NULL if not used. */
+  void *arg;                            /*!< User argument passed to the callback. */
+  TaskHandle_t notify_task;             /*!< Task notified on I2C_CONTROLLER_NOTIFY_INDEX, NULL if not used. */
+} i2c_controller_transaction_t;
+
 /** 
  * \brief Structure for I2C controller descriptor.
  */
@@ -80,6 +202,40 @@ i2c_controller_result_t i2c_controller_send(i2c_port_t i2c_num, uint8_t address,
                                             uint8_t reg, const uint8_t *data, 
                                             size_t data_len);
 
+/** 
+ * \brief Write several registers in a single START...STOP transaction.
+ *
+ * The pairs are sent in order as reg, value, reg, value..., which is the 
+ * multi-register write supported by e.g. the BME280.
+ * 
+ * \param[in]   i2c_num: I2C port number.
+ * \param[in]   address: I2C address of the device.
+ * \param[in]   pairs: Pointer to the register/value pairs.
+ * \param[in]   pairs_count: Number of the pairs.
+ * \return      Result of the send operation.
+ */
+i2c_controller_result_t i2c_controller_send_pairs(i2c_port_t i2c_num, uint8_t address, 
+                                                  const i2c_controller_pair_t *pairs, 
+                                                  size_t pairs_count);
+
+/** 
+ * \brief Write and then read data over I2C in a single transaction.
+ *
+ * The write and read phases are joined with a repeated START, so the bus 
+ * is not released in between and only one command link is executed.
+ * 
+ * \param[in]   i2c_num: I2C port number.
+ * \param[in]   address: I2C address of the device.
+ * \param[in]   write_data: Pointer to the data to send, e.g. register address.
+ * \param[in]   write_len: Length of the data to send.
+ * \param[out]  read_data: Pointer to the buffer to store received data.
+ * \param[in]   read_len: Length of the data to receive.
+ * \return      Result of the write-read operation.
+ */
+i2c_controller_result_t i2c_controller_write_read(i2c_port_t i2c_num, uint8_t address, 
+                                                  const uint8_t *write_data, size_t write_len, 
+                                                  uint8_t *read_data, size_t read_len);
+
 /** 
  * \brief Receive data over I2C.
  * 
@@ -94,4 +250,169 @@ i2c_controller_result_t i2c_controller_receive(i2c_port_t i2c_num, uint8_t addre
                                                uint8_t reg, uint8_t *data, 
                                                size_t data_len);
 
+/** 
+ * \brief Register a device on its I2C bus.
+ *
+ * The device structure is referenced, not copied, it must outlive the bus.
+ * 
+ * \param[in]   device: Pointer to the device.
+ * \return      Result of the registration.
+ */
+i2c_controller_result_t i2c_controller_device_register(const i2c_controller_device_t *device);
+
+/** 
+ * \brief Find the fastest clock the bus handles without errors.
+ *
+ * Tries the clock steps from 400 kHz down and keeps the first one at which 
+ * every registered device answers its probe register consistently. At run 
+ * time the clock is stepped down further when NACKs and timeouts climb.
+ * Call it after all the devices of the bus are registered. When no step 
+ * passes, the bus stays at I2C_CONTROLLER_MASTER_FREQ_HZ.
+ * 
+ * \param[in]   i2c_num: I2C port number.
+ * \return      Result of the probe, error when no clock step passed.
+ */
+i2c_controller_result_t i2c_controller_probe(i2c_port_t i2c_num);
+
+/** 
+ * \brief Clear a bus held low by a slave and reinstall the driver.
+ *
+ * Runs the bus clear sequence (up to 9 SCL pulses and a STOP). Device 
+ * transfers do this by themselves when a timeout leaves SDA low.
+ * 
+ * \param[in]   i2c_num: I2C port number.
+ * \return      Result of the recovery.
+ */
+i2c_controller_result_t i2c_controller_recover(i2c_port_t i2c_num);
+
+/** 
+ * \brief Get the bus health counters.
+ * 
+ * \param[in]   i2c_num: I2C port number.
+ * \param[out]  health: Pointer to the structure to store the counters.
+ * \return      Result of the operation.
+ */
+i2c_controller_result_t i2c_controller_health(i2c_port_t i2c_num, i2c_controller_health_t *health);
+
+/** 
+ * \brief Send data to a device register.
+ * 
+ * \param[in]   device: Pointer to the device.
+ * \param[in]   reg: Register address to send data to.
+ * \param[in]   data: Pointer to the data to send.
+ * \param[in]   data_len: Length of the data to send.
+ * \return      Result of the send operation.
+ */
+i2c_controller_result_t i2c_controller_device_send(const i2c_controller_device_t *device, 
+                                                   uint8_t reg, const uint8_t *data, 
+                                                   size_t data_len);
+
+/** 
+ * \brief Write a single register through the device's register shadow.
+ *
+ * The write is skipped when the shadow says the register already holds the 
+ * value. Use i2c_controller_device_send() for registers whose write has a 
+ * side effect, e.g. triggering a measurement.
+ * 
+ * \param[in]   device: Pointer to the registered device.
+ * \param[in]   reg: Register address.
+ * \param[in]   value: Value to write.
+ * \return      Result of the send operation.
+ */
+i2c_controller_result_t i2c_controller_device_send_cached(const i2c_controller_device_t *device, 
+                                                          uint8_t reg, uint8_t value);
+
+/** 
+ * \brief Write several device registers in a single transaction.
+ *
+ * The pairs go through the register shadow as a whole: the transaction is 
+ * skipped when all of them match it, otherwise all of them are written.
+ * 
+ * \param[in]   device: Pointer to the device.
+ * \param[in]   pairs: Pointer to the register/value pairs.
+ * \param[in]   pairs_count: Number of the pairs.
+ * \return      Result of the send operation.
+ */
+i2c_controller_result_t i2c_controller_device_send_pairs(const i2c_controller_device_t *device, 
+                                                         const i2c_controller_pair_t *pairs, 
+                                                         size_t pairs_count);
+
+/** 
+ * \brief Forget the register shadow of a device, e.g. after its reset.
+ * 
+ * \param[in]   device: Pointer to the registered device.
+ * \return      Result of the operation, error for a device not registered.
+ */
+i2c_controller_result_t i2c_controller_device_invalidate(const i2c_controller_device_t *device);
+
+/** 
+ * \brief Check the register shadow of a device without touching the bus.
+ * 
+ * \param[in]   device: Pointer to the registered device.
+ * \param[in]   reg: Register address.
+ * \param[in]   value: Value expected in the register.
+ * \return      True when the shadow says the register holds the value.
+ */
+bool i2c_controller_device_shadowed(const i2c_controller_device_t *device, uint8_t reg, uint8_t value);
+
+/** 
+ * \brief Write and then read data from a device in a single transaction.
+ * 
+ * \param[in]   device: Pointer to the device.
+ * \param[in]   write_data: Pointer to the data to send, e.g. register address.
+ * \param[in]   write_len: Length of the data to send.
+ * \param[out]  read_data: Pointer to the buffer to store received data.
+ * \param[in]   read_len: Length of the data to receive.
+ * \return      Result of the write-read operation.
+ */
+i2c_controller_result_t i2c_controller_device_write_read(const i2c_controller_device_t *device, 
+                                                         const uint8_t *write_data, size_t write_len, 
+                                                         uint8_t *read_data, size_t read_len);
+
+/** 
+ * \brief Receive data from a device register.
+ * 
+ * \param[in]   device: Pointer to the device.
+ * \param[in]   reg: Register address to receive data from.
+ * \param[out]  data: Pointer to the buffer to store received data.
+ * \param[in]   data_len: Length of the data to receive.
+ * \return      Result of the receive operation.
+ */
+i2c_controller_result_t i2c_controller_device_receive(const i2c_controller_device_t *device, 
+                                                      uint8_t reg, uint8_t *data, 
+                                                      size_t data_len);
+
+/** 
+ * \brief Start the asynchronous I2C worker.
+ *
+ * Creates the transaction queue and the task executing it. The first 
+ * i2c_controller_submit() calls it, a firmware never submitting anything 
+ * doesn't pay for the task. Must be called after i2c_controller_init().
+ * 
+ * \return      Result of the initialization.
+ */
+i2c_controller_result_t i2c_controller_async_init(void);
+
+/** 
+ * \brief Queue an I2C transaction and return immediately.
+ *
+ * On completion the callback is called and/or the notify task gets one of 
+ * the I2C_CONTROLLER_NOTIFY_* bits in its I2C_CONTROLLER_NOTIFY_INDEX 
+ * notification, the default one is left to the task.
+ * 
+ * \param[in]   transaction: Pointer to the transaction to queue.
+ * \param[in]   ticks: Time to wait for a free slot in the queue.
+ * \return      Result of the submission, not of the transaction itself.
+ */
+i2c_controller_result_t i2c_controller_submit(const i2c_controller_transaction_t *transaction, 
+                                              TickType_t ticks);
+
+/** 
+ * \brief Wait in the calling task for its submitted transaction to complete.
+ * 
+ * \param[in]   ticks: Time to wait for the completion.
+ * \return      Result of the transaction, error on timeout.
+ */
+i2c_controller_result_t i2c_controller_async_wait(TickType_t ticks);
+
 #endif // !INC_I2C_CONTROLLER_H
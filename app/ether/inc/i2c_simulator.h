@@ -0,0 +1,165 @@
+#ifndef INC_I2C_SIMULATOR_H
+#define INC_I2C_SIMULATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "hal/i2c_types.h"
+#include "freertos/FreeRTOS.h"
+
+#define I2C_SIMULATOR_REGISTERS_SIZE    (0x100)   /*!< Register file of a simulated device. */
+#define I2C_SIMULATOR_DEVICES_MAX       (2)       /*!< Sensors per simulated bus, e.g. 0x76 and 0x77. */
+#define I2C_SIMULATOR_STUCK_FOREVER     (0xff)    /*!< SDA held low whatever the bus clear does. */
+
+/** 
+ * \brief Result codes for I2C simulator operations.
+ */
+typedef enum {
+  I2C_SIMULATOR_RESULT_SUCCESS = 0,   /*!< Operation was successful. */
+  I2C_SIMULATOR_RESULT_ERROR,         /*!< Operation encountered an error. */
+} i2c_simulator_result_t;
+
+/** 
+ * \brief Structure for the environment seen by the simulated BME280.
+ */
+typedef struct {
+  double temperature;   /*!< Temperature in degrees Celsius. */
+  double pressure;      /*!< Pressure in pascals. */
+  double humidity;      /*!< Relative humidity in percent. */
+} i2c_simulator_environment_t;
+
+/** 
+ * \brief Structure for the faults injected into a simulated bus.
+ */
+typedef struct {
+  uint32_t nacks;           /*!< Next transfers answered with a NACK. */
+  uint8_t stuck_pulses;     /*!< SCL pulses needed to release a stuck SDA, 0 for a free bus. */
+  uint32_t delay_us;        /*!< Clock stretching added to every transfer. */
+} i2c_simulator_fault_t;
+
+/** 
+ * \brief Structure for the counters of a simulated bus.
+ */
+typedef struct {
+  uint32_t transfers;       /*!< START...STOP transactions seen on the bus. */
+  uint32_t bytes_written;   /*!< Bytes written, address bytes excluded. */
+  uint32_t bytes_read;      /*!< Bytes read. */
+  uint32_t nacks;           /*!< Transfers ended by a NACK. */
+  uint32_t timeouts;        /*!< Transfers that did not finish in time. */
+  uint32_t recoveries;      /*!< Bus clear sequences. */
+  uint32_t measurements;    /*!< Measurements started by the BME280 model. */
+  uint64_t busy_us;         /*!< Time the bus was busy at the current clock. */
+} i2c_simulator_stats_t;
+
+#define I2C_SIMULATOR_ENVIRONMENT_DEFAULT { \
+  .temperature = 21.5,                      \
+  .pressure = 101325.0,                     \
+  .humidity = 45.0,                         \
+}
+
+/** 
+ * \brief Attach a simulated BME280 to a bus, again at the same address re-powers it.
+ *
+ * \param[in]   i2c_num: I2C port number.
+ * \param[in]   address: I2C address of the sensor.
+ * \return      Result of the attach operation.
+ */
+i2c_simulator_result_t i2c_simulator_attach_bme280(i2c_port_t i2c_num, uint8_t address);
+
+/** 
+ * \brief Set the environment a simulated BME280 measures.
+ *
+ * \param[in]   i2c_num: I2C port number.
+ * \param[in]   address: I2C address of the sensor.
+ * \param[in]   environment: Pointer to the environment.
+ * \return      Result of the set operation.
+ */
+i2c_simulator_result_t i2c_simulator_set_environment(i2c_port_t i2c_num, uint8_t address,
+                                                     const i2c_simulator_environment_t *environment);
+
+/** 
+ * \brief Inject faults into a simulated bus, replacing the previous ones.
+ *
+ * \param[in]   i2c_num: I2C port number.
+ * \param[in]   fault: Pointer to the faults.
+ * \return      Result of the inject operation.
+ */
+i2c_simulator_result_t i2c_simulator_inject(i2c_port_t i2c_num, const i2c_simulator_fault_t *fault);
+
+/** 
+ * \brief Get the counters of a simulated bus.
+ *
+ * \param[in]   i2c_num: I2C port number.
+ * \param[out]  stats: Pointer to the counters.
+ * \return      Result of the get operation.
+ */
+i2c_simulator_result_t i2c_simulator_stats(i2c_port_t i2c_num, i2c_simulator_stats_t *stats);
+
+/** 
+ * \brief Clear the counters of a simulated bus.
+ *
+ * \param[in]   i2c_num: I2C port number.
+ * \return      Result of the clear operation.
+ */
+i2c_simulator_result_t i2c_simulator_stats_reset(i2c_port_t i2c_num);
+
+/** 
+ * \brief Bring up a simulated bus, stands in for the driver installation.
+ *
+ * \param[in]   i2c_num: I2C port number.
+ * \param[in]   clk_speed: Bus clock frequency.
+ * \return      ESP_OK or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t i2c_simulator_install(i2c_port_t i2c_num, uint32_t clk_speed);
+
+/** 
+ * \brief Change the clock of a simulated bus.
+ *
+ * \param[in]   i2c_num: I2C port number.
+ * \param[in]   clk_speed: Bus clock frequency.
+ * \return      ESP_OK or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t i2c_simulator_set_clock(i2c_port_t i2c_num, uint32_t clk_speed);
+
+/** 
+ * \brief Run a transaction on a simulated bus.
+ *
+ * The transaction mirrors the one built for the driver: START, address+W,
+ * prefix, write data, then a repeated START, address+R and the read data.
+ *
+ * \param[in]   i2c_num: I2C port number.
+ * \param[in]   address: I2C address of the device.
+ * \param[in]   prefix: Pointer to the bytes sent before the data, may be NULL.
+ * \param[in]   prefix_len: Length of the prefix.
+ * \param[in]   write_data: Pointer to the data to write, may be NULL.
+ * \param[in]   write_len: Length of the data to write.
+ * \param[out]  read_data: Pointer to the buffer for the read data, may be NULL.
+ * \param[in]   read_len: Length of the data to read.
+ * \param[in]   transfer_ticks: Time the transaction may take.
+ * \return      ESP_OK, ESP_FAIL on a NACK or ESP_ERR_TIMEOUT.
+ */
+esp_err_t i2c_simulator_transfer(i2c_port_t i2c_num, uint8_t address,
+                                 const uint8_t *prefix, size_t prefix_len,
+                                 const uint8_t *write_data, size_t write_len,
+                                 uint8_t *read_data, size_t read_len,
+                                 TickType_t transfer_ticks);
+
+/** 
+ * \brief Check whether SDA of a simulated bus is held low.
+ *
+ * \param[in]   i2c_num: I2C port number.
+ * \return      True when the bus is stuck.
+ */
+bool i2c_simulator_bus_stuck(i2c_port_t i2c_num);
+
+/** 
+ * \brief Run the bus clear sequence on a simulated bus.
+ *
+ * \param[in]   i2c_num: I2C port number.
+ * \param[in]   pulses: SCL pulses of the sequence.
+ * \return      ESP_OK when SDA was released, ESP_FAIL otherwise.
+ */
+esp_err_t i2c_simulator_bus_clear(i2c_port_t i2c_num, uint8_t pulses);
+
+#endif // !INC_I2C_SIMULATOR_H
@@ -19,7 +19,7 @@
 #include "mqtt_client.h"
 
 #define MQTT_CONTROLLER_BROKER_ADDRESS_URI  ("mqtt://192.168.235.80:1883")
-#define MQTT_CONTROLLER_MESSAGE_MAX_SIZE    (256)
+#define MQTT_CONTROLLER_MESSAGE_MAX_SIZE    (384)
 
 /** 
  * \brief Function pointer type for MQTT event handler.
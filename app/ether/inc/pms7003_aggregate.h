@@ -0,0 +1,58 @@
+#ifndef INC_PMS7003_AGGREGATE_H
+#define INC_PMS7003_AGGREGATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pms7003.h"
+#include "pms7003_scheduler.h"
+
+#define PMS7003_AGGREGATE_SIZE        (PMS7003_SCHEDULER_READ_MS / PMS7003_ACTIVE_INTERVAL_MIN_MS)   /*!< Frames of a whole reading window at the fastest active rate. */
+#define PMS7003_AGGREGATE_MIN_FRAMES  (3)     /*!< Frames needed for a result. */
+
+/** 
+ * \brief Ways to reduce the frames of a window to one measurement.
+ */
+typedef enum {
+  PMS7003_AGGREGATE_MEDIAN = 0,   /*!< Per field median, ignores single outliers. */
+  PMS7003_AGGREGATE_MEAN,         /*!< Per field mean, rounded. */
+} pms7003_aggregate_method_t;
+
+/** 
+ * \brief Structure for the measurements of one awake window.
+ */
+typedef struct {
+  pms7003_measurements_t samples[PMS7003_AGGREGATE_SIZE];   /*!< Measurements of the valid frames. */
+  uint8_t count;                                            /*!< Measurements stored. */
+  uint32_t dropped;                                         /*!< Frames past PMS7003_AGGREGATE_SIZE. */
+} pms7003_aggregate_t;
+
+_Static_assert(PMS7003_AGGREGATE_SIZE <= UINT8_MAX, "pms7003_aggregate_t counts its frames in a uint8_t");
+
+/** 
+ * \brief Empty the window.
+ *
+ * \param[out]  aggregate: Pointer to the window.
+ */
+void pms7003_aggregate_reset(pms7003_aggregate_t *aggregate);
+
+/** 
+ * \brief Add a checked frame to the window.
+ *
+ * \param[in]   aggregate: Pointer to the window.
+ * \param[in]   frame: Pointer to the frame answer structure.
+ * \return      True when the frame was stored, false when the window is full.
+ */
+bool pms7003_aggregate_add(pms7003_aggregate_t *aggregate, const pms7003_frame_answer_t *frame);
+
+/** 
+ * \brief Reduce the window to one measurement.
+ *
+ * \param[in]   aggregate: Pointer to the window.
+ * \param[in]   method: Reduction of each field.
+ * \param[out]  measurements: Pointer to the measurements.
+ * \return      True when the window had PMS7003_AGGREGATE_MIN_FRAMES frames or more.
+ */
+bool pms7003_aggregate_result(const pms7003_aggregate_t *aggregate, pms7003_aggregate_method_t method,
+                              pms7003_measurements_t *measurements);
+
+#endif // !INC_PMS7003_AGGREGATE_H
@@ -0,0 +1,80 @@
+#ifndef INC_PMS7003_DECODER_H
+#define INC_PMS7003_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pms7003_frame.h"
+
+#define PMS7003_DECODER_HEADER_SIZE   (0x04)    /*!< Start characters and the length field. */
+#define PMS7003_DECODER_DATA_LENGTH   (PMS7003_FRAME_ANSWER_SIZE - PMS7003_DECODER_HEADER_SIZE)   /*!< Length field of a data frame. */
+
+/** 
+ * \brief States of the PMS7003 frame decoder.
+ */
+typedef enum {
+  PMS7003_DECODER_STATE_START_1 = 0,    /*!< Waiting for the first start character. */
+  PMS7003_DECODER_STATE_START_2,        /*!< Waiting for the second start character. */
+  PMS7003_DECODER_STATE_LENGTH_H,       /*!< Waiting for the length high byte. */
+  PMS7003_DECODER_STATE_LENGTH_L,       /*!< Waiting for the length low byte. */
+  PMS7003_DECODER_STATE_PAYLOAD,        /*!< Collecting data words and the check code. */
+} pms7003_decoder_state_t;
+
+/** 
+ * \brief Structure for the incremental PMS7003 frame decoder.
+ *
+ * The bytes go straight into the frame they belong to, a complete frame is
+ * handed out from there. The decoder does not touch the UART, any byte
+ * stream can be fed to it.
+ */
+typedef struct {
+  pms7003_frame_answer_t frame;     /*!< Frame being decoded, the emitted frame until the next feed. */
+  pms7003_decoder_state_t state;    /*!< Decoder state. */
+  uint8_t index;                    /*!< Bytes of the frame stored so far. */
+  uint16_t length;                  /*!< Length field of the frame. */
+  uint16_t sum;                     /*!< Sum of the bytes before the check code. */
+  uint32_t frames;                  /*!< Valid data frames emitted. */
+  uint32_t ignored;                 /*!< Valid frames of another length, e.g. command answers. */
+  uint32_t check_code_errors;       /*!< Frames with a wrong check code. */
+  uint32_t length_errors;           /*!< Headers with an impossible length. */
+  uint32_t skipped;                 /*!< Bytes outside any frame. */
+} pms7003_decoder_t;
+
+#define PMS7003_DECODER_DEFAULT {             \
+  .frame = { .buffer_answer = { 0 } },        \
+  .state = PMS7003_DECODER_STATE_START_1,     \
+  .index = 0,                                 \
+  .length = 0,                                \
+  .sum = 0,                                   \
+  .frames = 0,                                \
+  .ignored = 0,                               \
+  .check_code_errors = 0,                     \
+  .length_errors = 0,                         \
+  .skipped = 0,                               \
+}
+
+/** 
+ * \brief Drop the partial frame, the counters are kept.
+ *
+ * \param[in]   decoder: Pointer to the decoder.
+ */
+void pms7003_decoder_reset(pms7003_decoder_t *decoder);
+
+/** 
+ * \brief Decode a chunk of the byte stream.
+ *
+ * The chunk may end anywhere, the next call continues the frame. Decoding
+ * stops right after a data frame with a valid length and check code, the
+ * caller feeds the rest of the chunk again. A false start inside a frame
+ * that fails is searched again for the next start characters, so no real
+ * frame is lost to it.
+ *
+ * \param[in]   decoder: Pointer to the decoder.
+ * \param[in]   data: Pointer to the bytes.
+ * \param[in]   size: Number of bytes.
+ * \param[out]  frame: Set to the decoded frame, valid until the next feed, or NULL.
+ * \return      Number of bytes consumed.
+ */
+size_t pms7003_decoder_feed(pms7003_decoder_t *decoder, const uint8_t *data, size_t size,
+                            const pms7003_frame_answer_t **frame);
+
+#endif // !INC_PMS7003_DECODER_H
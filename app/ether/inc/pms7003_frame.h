@@ -0,0 +1,41 @@
+#ifndef INC_PMS7003_FRAME_H
+#define INC_PMS7003_FRAME_H
+
+#include <stdint.h>
+
+#define PMS7003_START_CHARACTER_1 (0x42)
+#define PMS7003_START_CHARACTER_2 (0x4d)
+
+#define PMS7003_FRAME_REQUEST_SIZE    (0x07)
+#define PMS7003_FRAME_ANSWER_SIZE     (0x20)
+#define PMS7003_FRAME_CHECK_CODE_SIZE (0x1e)
+#define PMS7003_FRAME_DATA_OFFSET     (0x04)
+#define PMS7003_DATA_WORDS            (0x0c)
+
+/** 
+ * \brief Union representing a PMS7003 frame answer.
+ */
+typedef union {
+  struct {
+    uint8_t start_byte_1;                             /*!< Start byte 1. */
+    uint8_t start_byte_2;                             /*!< Start byte 2. */
+    uint16_t length;                                  /*!< Length of the frame. */
+    uint16_t data_pm1_standard;                       /*!< PM1.0 concentration (standard particles). */
+    uint16_t data_pm25_standard;                      /*!< PM2.5 concentration (standard particles). */
+    uint16_t data_pm10_standard;                      /*!< PM10 concentration (standard particles). */
+    uint16_t data_pm1_atmospheric;                    /*!< PM1.0 concentration (atmospheric particles). */
+    uint16_t data_pm25_atmospheric;                   /*!< PM2.5 concentration (atmospheric particles). */
+    uint16_t data_pm10_atmospheric;                   /*!< PM10 concentration (atmospheric particles). */
+    uint16_t data_particles_300nm;                    /*!< Particles count for 0.3µm. */
+    uint16_t data_particles_500nm;                    /*!< Particles count for 0.5µm. */
+    uint16_t data_particles_1000nm;                   /*!< Particles count for 1.0µm. */
+    uint16_t data_particles_2500nm;                   /*!< Particles count for 2.5µm. */
+    uint16_t data_particles_5000nm;                   /*!< Particles count for 5.0µm. */
+    uint16_t data_particles_10000nm;                  /*!< Particles count for 10µm. */
+    uint16_t reserved;                                /*!< Reserved bytes. */
+    uint16_t check_code;                              /*!< Checksum code. */
+  } __attribute__((packed));  /* Ensure no padding between members. */
+  uint8_t buffer_answer[PMS7003_FRAME_ANSWER_SIZE];   /*!< Buffer for answer frame. */
+} pms7003_frame_answer_t;
+
+#endif // !INC_PMS7003_FRAME_H
@@ -0,0 +1,85 @@
+#ifndef INC_PMS7003_RECEIVER_H
+#define INC_PMS7003_RECEIVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+#include "pms7003.h"
+#include "pms7003_decoder.h"
+
+#define PMS7003_RECEIVER_TASK_STACK_SIZE  (3072)                      /*!< Receiver task stack size. */
+#define PMS7003_RECEIVER_TASK_PRIORITY    (configMAX_PRIORITIES - 2)  /*!< Receiver task priority. */
+#define PMS7003_RECEIVER_CHUNK_SIZE       (64)                        /*!< Bytes taken from the UART ring at once. */
+#define PMS7003_RECEIVER_QUEUE_SIZE       (4)                         /*!< Frames kept for the reader, the oldest goes first. */
+#define PMS7003_RECEIVER_DEADLINE_MS      (2500)                      /*!< Longest wait for a frame, active frames come every 0.2...2.3 s. */
+
+/** 
+ * \brief Result codes for PMS7003 receiver operations.
+ */
+typedef enum {
+  PMS7003_RECEIVER_RESULT_SUCCESS = 0,   /*!< Operation was successful. */
+  PMS7003_RECEIVER_RESULT_ERROR,         /*!< Operation encountered an error. */
+  PMS7003_RECEIVER_RESULT_TIMEOUT,       /*!< No frame before the deadline. */
+} pms7003_receiver_result_t;
+
+/** 
+ * \brief Structure for the UART event driven PMS7003 frame receiver.
+ */
+typedef struct {
+  uart_port_t uart_num;                             /*!< UART port of the sensor. */
+  QueueHandle_t events;                             /*!< UART driver events. */
+  QueueHandle_t frames;                             /*!< Validated frames, oldest first. */
+  TaskHandle_t task;                                /*!< Receiver task. */
+  pms7003_decoder_t decoder;                        /*!< Frame decoder, holds the frame statistics. */
+  uint32_t overflows;                               /*!< FIFO or ring buffer overflows. */
+  uint32_t dropped;                                 /*!< Frames pushed out of a full queue. */
+} pms7003_receiver_t;
+
+#define PMS7003_RECEIVER_DEFAULT {    \
+  .uart_num = UART_NUM_2,             \
+  .events = NULL,                     \
+  .frames = NULL,                     \
+  .task = NULL,                       \
+  .decoder = PMS7003_DECODER_DEFAULT, \
+  .overflows = 0,                     \
+  .dropped = 0,                       \
+}
+
+/** 
+ * \brief Start receiving frames from the UART driver events.
+ *
+ * The receiver task blocks on the event queue, so waiting for the sensor
+ * costs no CPU. It takes all the bytes the driver reports through the
+ * decoder and queues the valid data frames, a full queue loses its oldest.
+ *
+ * \param[out]  receiver: Pointer to the receiver.
+ * \param[in]   uart_num: UART port of the sensor.
+ * \param[in]   events: Event queue of the installed UART driver.
+ * \return      Result of the start.
+ */
+pms7003_receiver_result_t pms7003_receiver_start(pms7003_receiver_t *receiver, uart_port_t uart_num,
+                                                 QueueHandle_t events);
+
+/** 
+ * \brief Drop the frames received so far, the next wait returns a newer one.
+ *
+ * \param[in]   receiver: Pointer to the receiver.
+ * \return      Result of the operation.
+ */
+pms7003_receiver_result_t pms7003_receiver_flush(pms7003_receiver_t *receiver);
+
+/** 
+ * \brief Wait for the oldest validated frame.
+ *
+ * \param[in]   receiver: Pointer to the receiver.
+ * \param[out]  frame: Pointer to the frame answer structure.
+ * \param[in]   timeout: Ticks to wait, a silent sensor returns PMS7003_RECEIVER_RESULT_TIMEOUT.
+ * \return      Result of the wait.
+ */
+pms7003_receiver_result_t pms7003_receiver_wait(pms7003_receiver_t *receiver, pms7003_frame_answer_t *frame,
+                                                TickType_t timeout);
+
+#endif // !INC_PMS7003_RECEIVER_H
@@ -0,0 +1,141 @@
+#ifndef INC_PMS7003_SCHEDULER_H
+#define INC_PMS7003_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PMS7003_SCHEDULER_WARMUP_MS       (30000)     /*!< Fan run time before the readings are stable. */
+#define PMS7003_SCHEDULER_READ_MS         (10000)     /*!< Length of the reading window. */
+#define PMS7003_SCHEDULER_SLEEP_MIN_MS    (10000)     /*!< Fan off time that makes a sleep worth the extra fan start. */
+#define PMS7003_SCHEDULER_FAN_RATED_H     (8000)      /*!< Rated fan lifetime. */
+#define PMS7003_SCHEDULER_SAVE_S          (3600)      /*!< Fan on-time between two NVS writes. */
+#define PMS7003_SCHEDULER_NVS_NAMESPACE   ("pms7003")
+#define PMS7003_SCHEDULER_NVS_KEY         ("fan_on_s")
+
+/** 
+ * \brief Structure for the PMS7003 fan duty cycle scheduler.
+ *
+ * The times are in milliseconds of a monotonic clock, the scheduler does
+ * not read it itself.
+ */
+typedef struct {
+  uint32_t period_ms;         /*!< Wanted time between two readings, 0 for as often as the cycle allows. */
+  uint32_t service_h;         /*!< Wanted fan service life, 0 for no limit. */
+  bool awake;                 /*!< True while the fan runs. */
+  int64_t wake_ms;            /*!< Time of the last wakeup. */
+  int64_t read_ms;            /*!< Start of the last reading, -1 before the first one. */
+  uint32_t cycle_ms;          /*!< Measured time between the last two readings. */
+  int64_t counted_ms;         /*!< Time up to which the fan on-time is in on_ms. */
+  uint64_t on_ms;             /*!< Fan on-time up to counted_ms, restored ones included. */
+  uint32_t saved_s;           /*!< Fan on-time in NVS. */
+  uint32_t warmups;           /*!< Wakeups that needed a warmup. */
+  uint32_t warm_reads;        /*!< Wakeups that found the fan running, no warmup. */
+} pms7003_scheduler_t;
+
+#define PMS7003_SCHEDULER_DEFAULT {   \
+  .period_ms = 0,                     \
+  .service_h = 0,                     \
+  .awake = false,                     \
+  .wake_ms = 0,                       \
+  .read_ms = -1,                      \
+  .cycle_ms = 0,                      \
+  .counted_ms = 0,                    \
+  .on_ms = 0,                         \
+  .saved_s = 0,                       \
+  .warmups = 0,                       \
+  .warm_reads = 0,                    \
+}
+
+/** 
+ * \brief Load the fan on-time kept in NVS.
+ *
+ * \param[in]   scheduler: Pointer to the scheduler.
+ */
+void pms7003_scheduler_restore(pms7003_scheduler_t *scheduler);
+
+/** 
+ * \brief Time between two readings the scheduler aims for.
+ *
+ * The wanted period, stretched when the fan would otherwise wear out
+ * before service_h: a sleeping cycle runs the fan for the warmup and the
+ * reading, which may take only PMS7003_SCHEDULER_FAN_RATED_H / service_h
+ * of the period.
+ *
+ * \param[in]   scheduler: Pointer to the scheduler.
+ * \return      Period in milliseconds.
+ */
+uint32_t pms7003_scheduler_period(const pms7003_scheduler_t *scheduler);
+
+/** 
+ * \brief Whether the sensor has to be woken up in this cycle.
+ *
+ * Due one warmup before a period has passed since the last reading. A
+ * cycle that comes earlier skips the sensor rather than wait for it, the
+ * BME280 and MQTT tasks are chained behind.
+ *
+ * \param[in]   scheduler: Pointer to the scheduler.
+ * \param[in]   now_ms: Current time.
+ * \return      True when the cycle reads the sensor.
+ */
+bool pms7003_scheduler_due(const pms7003_scheduler_t *scheduler, int64_t now_ms);
+
+/** 
+ * \brief Warmup still needed before a reading, 0 when the fan ran long enough.
+ *
+ * \param[in]   scheduler: Pointer to the scheduler.
+ * \param[in]   now_ms: Current time.
+ * \return      Milliseconds of warmup left.
+ */
+uint32_t pms7003_scheduler_warmup_left(const pms7003_scheduler_t *scheduler, int64_t now_ms);
+
+/** 
+ * \brief Record a wakeup, a running fan is left as it is.
+ *
+ * \param[in]   scheduler: Pointer to the scheduler.
+ * \param[in]   now_ms: Current time.
+ */
+void pms7003_scheduler_wakeup(pms7003_scheduler_t *scheduler, int64_t now_ms);
+
+/** 
+ * \brief Record a reading and keep the on-time, as pms7003_scheduler_sleep().
+ *
+ * Called once the window gave a result, a failed window is not a reading
+ * and the next cycle tries again.
+ *
+ * \param[in]   scheduler: Pointer to the scheduler.
+ * \param[in]   now_ms: Start of the window.
+ */
+void pms7003_scheduler_read(pms7003_scheduler_t *scheduler, int64_t now_ms);
+
+/** 
+ * \brief Decide whether the fan keeps running after a reading.
+ *
+ * The next reading is a period away, or a measured cycle when the rest of
+ * the firmware is slower. When the fan could not be off for more than
+ * PMS7003_SCHEDULER_SLEEP_MIN_MS before its warmup, it stays on and the
+ * next reading skips the warmup.
+ *
+ * \param[in]   scheduler: Pointer to the scheduler.
+ * \param[in]   now_ms: Current time.
+ * \return      True when the sensor should stay awake.
+ */
+bool pms7003_scheduler_keep_awake(const pms7003_scheduler_t *scheduler, int64_t now_ms);
+
+/** 
+ * \brief Record a sleep and keep the on-time, NVS is written once per PMS7003_SCHEDULER_SAVE_S.
+ *
+ * \param[in]   scheduler: Pointer to the scheduler.
+ * \param[in]   now_ms: Current time.
+ */
+void pms7003_scheduler_sleep(pms7003_scheduler_t *scheduler, int64_t now_ms);
+
+/** 
+ * \brief Total fan on-time.
+ *
+ * \param[in]   scheduler: Pointer to the scheduler.
+ * \param[in]   now_ms: Current time.
+ * \return      Fan on-time in milliseconds.
+ */
+uint64_t pms7003_scheduler_on_time(const pms7003_scheduler_t *scheduler, int64_t now_ms);
+
+#endif // !INC_PMS7003_SCHEDULER_H
@@ -0,0 +1,46 @@
+#ifndef INC_PSYCHROMETRICS_H
+#define INC_PSYCHROMETRICS_H
+
+#include <stdint.h>
+#include "bme280.h"
+
+#define PSYCHROMETRICS_TABLE_MIN    (-40)   /*!< First table temperature in degC, the BME280 range. */
+#define PSYCHROMETRICS_TABLE_MAX    (85)    /*!< Last table temperature in degC. */
+
+/** 
+ * \brief Result codes for psychrometrics operations.
+ */
+typedef enum {
+  PSYCHROMETRICS_RESULT_SUCCESS = 0,   /*!< Operation was successful. */
+  PSYCHROMETRICS_RESULT_ERROR,         /*!< Operation encountered an error. */
+} psychrometrics_result_t;
+
+/** 
+ * \brief Structure for the quantities derived from one BME280 sample.
+ */
+typedef struct {
+  int32_t dew_point;              /*!< Dew point in 0.01 degC. */
+  int32_t absolute_humidity;      /*!< Water vapour density in 0.01 g/m3. */
+  int32_t heat_index;             /*!< Apparent temperature in 0.01 degC. */
+  int32_t sea_level_pressure;     /*!< Pressure reduced to sea level in Pa, Q24.8 (Pa * 256). */
+} psychrometrics_t;
+
+#define PSYCHROMETRICS_CELSIUS(value)   ((float)(value) / 100.0f)
+#define PSYCHROMETRICS_GRAMS(value)     ((float)(value) / 100.0f)
+#define PSYCHROMETRICS_PASCALS(value)   ((float)(value) / 256.0f)
+
+/** 
+ * \brief Derive dew point, absolute humidity, heat index and sea level pressure.
+ *
+ * The vapour pressure comes from a Magnus (over water) table at 1 degC steps,
+ * interpolated both ways, so neither log nor exp is evaluated.
+ * 
+ * \param[in]   sample: Pointer to the compensated sample.
+ * \param[in]   altitude_m: Altitude of the sensor above sea level.
+ * \param[out]  psychrometrics: Pointer to the derived quantities.
+ * \return      Result of the computation.
+ */
+psychrometrics_result_t psychrometrics_compute(const bme280_sample_t *sample, int32_t altitude_m, 
+                                               psychrometrics_t *psychrometrics);
+
+#endif // !INC_PSYCHROMETRICS_H
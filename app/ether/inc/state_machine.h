@@ -35,6 +35,14 @@ bme280_result_t state_machine_bme280_id(ether_t *ether);
  */
 bme280_result_t state_machine_bme280_force_mode(ether_t *ether);
 
+/** 
+ * \brief Wait for the BME280 conversion within the state machine.
+ * 
+ * \param[out]  ether: Pointer to the ether structure.
+ * \return      Result of the wait operation.
+ */
+bme280_result_t state_machine_bme280_wait(ether_t *ether);
+
 /** 
  * \brief Measure humidity with the BME280 sensor within the state machine.
  * 
@@ -60,35 +68,27 @@ bme280_result_t state_machine_bme280_measure_temperature(ether_t *ether);
 bme280_result_t state_machine_bme280_measure_pressure(ether_t *ether);
 
 /** 
- * \brief Get compensation data from the BME280 sensor within the state machine.
- * 
- * \param[out]  ether: Pointer to the ether structure.
- * \return      Result of the get compensation data operation.
- */
-bme280_result_t state_machine_bme280_get_compensation_data(ether_t *ether);
-
-/** 
- * \brief Compensate humidity measurement from the BME280 sensor within the state machine.
+ * \brief Measure pressure, temperature and humidity in one burst within the state machine.
  * 
  * \param[out]  ether: Pointer to the ether structure.
- * \return      Result of the humidity compensation operation.
+ * \return      Result of the burst measurement operation.
  */
-bme280_result_t state_machine_bme280_compensate_humidity(ether_t *ether);
+bme280_result_t state_machine_bme280_measure_all(ether_t *ether);
 
 /** 
- * \brief Compensate temperature measurement from the BME280 sensor within the state machine.
+ * \brief Get compensation data from the BME280 sensor within the state machine.
  * 
  * \param[out]  ether: Pointer to the ether structure.
- * \return      Result of the temperature compensation operation.
+ * \return      Result of the get compensation data operation.
  */
-bme280_result_t state_machine_bme280_compensate_temperature(ether_t *ether);
+bme280_result_t state_machine_bme280_get_compensation_data(ether_t *ether);
 
 /** 
- * \brief Compensate pressure measurement from the BME280 sensor within the state machine.
+ * \brief Compensate all BME280 measurements in a single pass within the state machine.
  * 
  * \param[out]  ether: Pointer to the ether structure.
- * \return      Result of the pressure compensation operation.
+ * \return      Result of the compensation operation.
  */
-bme280_result_t state_machine_bme280_compensate_pressure(ether_t *ether);
+bme280_result_t state_machine_bme280_compensate(ether_t *ether);
 
 #endif // !INC_STATE_MACHINE_H
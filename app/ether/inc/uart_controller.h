@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "driver/uart.h"
 #include "hal/gpio_types.h"
 #include "hal/uart_types.h"
@@ -11,6 +13,10 @@
 #define UART_CONTROLLER_TX_PIN      (GPIO_NUM_17)
 #define UART_CONTROLLER_RX_PIN      (GPIO_NUM_16)
 
+#define UART_CONTROLLER_EVENT_QUEUE_SIZE  (16)    /*!< UART driver events kept for the reader. */
+#define UART_CONTROLLER_RX_FULL_THRESHOLD (32)    /*!< FIFO bytes that raise an UART_DATA event. */
+#define UART_CONTROLLER_RX_TIMEOUT        (10)    /*!< Idle symbols after which the FIFO rest is reported. */
+
 /** 
  * \brief Result codes for UART controller operations.
  */
@@ -25,6 +31,7 @@ typedef enum {
 typedef struct {
   uart_config_t uart_config;      /*!< UART configuration. */
   uart_port_t uart_port;          /*!< UART port number. */
+  QueueHandle_t event_queue;      /*!< UART driver events, set by uart_controller_init(). */
 } uart_controller_descriptor_t;
 
 /** 
@@ -45,14 +52,18 @@ typedef struct {
 #define UART_CONTROLLER_DESCRIPTOR_DEFAULT  {     \
   .uart_config = UART_CONTROLLER_CONFIG_DEFAULT,  \
   .uart_port = UART_NUM_2,                        \
+  .event_queue = NULL,                            \
 }
 
 /** 
  * \brief Initialize the UART controller.
  * 
- * \param[in]   uart_controller_descriptor: Pointer to the UART controller descriptor.
+ * Installs the driver with an event queue, a reader blocks on the queue
+ * instead of polling the receive buffer.
+ * 
+ * \param[in,out] uart_controller_descriptor: Pointer to the UART controller descriptor, gets the event queue.
  * \return      Result of the initialization operation.
  */
-uart_controller_result_t uart_controller_init(const uart_controller_descriptor_t *uart_controller_descriptor);
+uart_controller_result_t uart_controller_init(uart_controller_descriptor_t *uart_controller_descriptor);
 
 #endif // !INC_UART_CONTROLLER_H
@@ -7,12 +7,22 @@ const TickType_t ether_delay_10s    = pdMS_TO_TICKS(10000);
 const TickType_t ether_delay_1s     = pdMS_TO_TICKS(1000);
 const TickType_t ether_delay_500ms  = pdMS_TO_TICKS(500);
 const TickType_t ether_delay_200ms  = pdMS_TO_TICKS(200);
-const TickType_t ether_delay_15ms   = pdMS_TO_TICKS(15);
+const TickType_t ether_delay_100ms  = pdMS_TO_TICKS(100);
 
 SemaphoreHandle_t ether_pms7003_semaphore;
 SemaphoreHandle_t ether_mqtt_semaphore; 
 SemaphoreHandle_t ether_bme280_semaphore;
 
+/* Without the UART or the receiver the chain starts at the BME280. */
+static bool ether_pms7003_enabled;
+
+#if defined(ETHER_CAPTURE)
+#define ETHER_CAPTURE_SUMMARY_WINDOWS (60)   /*!< Quiet windows between two published summaries. */
+
+static bme280_capture_t ether_capture;
+QueueHandle_t ether_capture_queue;
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 /* BEGIN OF STATIC FUNCTIONS                                                 */
 ///////////////////////////////////////////////////////////////////////////////
@@ -20,6 +30,8 @@ SemaphoreHandle_t ether_bme280_semaphore;
 /* The ether pointer can't be const because of the mqtt_descriptor. */
 static void controller_init(ether_t *ether) 
 {
+  static const char *CONTROLLER_INIT_TAG = "CONTROLLER_INIT";
+
   if (!ether) {
     return;
   }
@@ -27,19 +39,35 @@ static void controller_init(ether_t *ether)
   wifi_controller_init(&ether->descriptor.wifi_controller);
   vTaskDelay(ether_delay_1s);
 
-  uart_controller_init(&ether->descriptor.uart_controller);
+  if (uart_controller_init(&ether->descriptor.uart_controller) != UART_CONTROLLER_RESULT_SUCCESS) {
+    ESP_LOGE(CONTROLLER_INIT_TAG, "uart_controller_init failed, PMS7003 disabled");
+  } else if (pms7003_receiver_start(&ether->descriptor.pms7003_receiver, ether->descriptor.uart_controller.uart_port,
+                                    ether->descriptor.uart_controller.event_queue) != PMS7003_RECEIVER_RESULT_SUCCESS) {
+    ESP_LOGE(CONTROLLER_INIT_TAG, "pms7003_receiver_start failed, PMS7003 disabled");
+  } else {
+    ether_pms7003_enabled = true;
+  }
   vTaskDelay(ether_delay_1s);
 
-  i2c_controller_init(&ether->descriptor.i2c_controller);
+#if defined(I2C_CONTROLLER_SIMULATOR)
+  i2c_simulator_attach_bme280(ether->descriptor.bme280.device.i2c_num, ether->descriptor.bme280.device.address);
+#endif
+  if (i2c_controller_init(&ether->descriptor.i2c_controller) != I2C_CONTROLLER_RESULT_SUCCESS) {
+    ESP_LOGE(CONTROLLER_INIT_TAG, "i2c_controller_init failed, BME280 unreachable");
+  } else if (i2c_controller_device_register(&ether->descriptor.bme280.device) != I2C_CONTROLLER_RESULT_SUCCESS) {
+    ESP_LOGE(CONTROLLER_INIT_TAG, "i2c_controller_device_register failed, BME280 unreachable");
+  } else if (i2c_controller_probe(ether->descriptor.i2c_controller.i2c_num) != I2C_CONTROLLER_RESULT_SUCCESS) {
+    ESP_LOGE(CONTROLLER_INIT_TAG, "i2c_controller_probe failed, bus kept at %d Hz", I2C_CONTROLLER_MASTER_FREQ_HZ);
+  }
   vTaskDelay(ether_delay_1s);
 
   mqtt_controller_init(&ether->descriptor.mqtt_controller);
   vTaskDelay(ether_delay_1s);
 }
 
-static uint16_t convert_to_little_endian(uint16_t data) 
+static int64_t ether_time_ms(void)
 {
-  return ((data & 0x00ff) << 8 | (data & 0xff00) >> 8);
+  return esp_timer_get_time() / 1000;
 }
 
 static void create_mqtt_message(const ether_t *ether, char *mqtt_message)
@@ -48,15 +76,55 @@ static void create_mqtt_message(const ether_t *ether, char *mqtt_message)
     return;
   }
 
+#if defined(ETHER_CAPTURE)
+  /* The capture settings skip humidity, neither it nor what is derived from it is current. */
   snprintf(mqtt_message, MQTT_CONTROLLER_MESSAGE_MAX_SIZE, 
-           "ether measurements:\n\rpm1 = %d\n\rpm2.5 = %d\n\rpm10 = %d\n\rtemp = %f\n\rhum = %f\n\rpress = %f\n\r", 
+           "ether measurements:\n\rpm1 = %d\n\rpm2.5 = %d\n\rpm10 = %d\n\rtemp = %f\n\rpress = %f\n\r"
+           "sea_press = %.1f\n\r", 
            ether->measurements.pms7003.pm1, 
            ether->measurements.pms7003.pm25, 
            ether->measurements.pms7003.pm10,
-           ether->measurements.bme280.temperature.compensated,
-           ether->measurements.bme280.humidity.compensated,
-           ether->measurements.bme280.pressure.compensated);
+           BME280_TEMPERATURE_CELSIUS(ether->measurements.bme280.temperature.compensated),
+           BME280_PRESSURE_PASCALS(ether->measurements.bme280.pressure.compensated),
+           PSYCHROMETRICS_PASCALS(ether->measurements.psychrometrics.sea_level_pressure));
+#else
+  snprintf(mqtt_message, MQTT_CONTROLLER_MESSAGE_MAX_SIZE, 
+           "ether measurements:\n\rpm1 = %d\n\rpm2.5 = %d\n\rpm10 = %d\n\rtemp = %f\n\rhum = %f\n\rpress = %f\n\r"
+           "dew = %.2f\n\rabs_hum = %.2f\n\rheat = %.2f\n\rsea_press = %.1f\n\r", 
+           ether->measurements.pms7003.pm1, 
+           ether->measurements.pms7003.pm25, 
+           ether->measurements.pms7003.pm10,
+           BME280_TEMPERATURE_CELSIUS(ether->measurements.bme280.temperature.compensated),
+           BME280_HUMIDITY_PERCENT(ether->measurements.bme280.humidity.compensated),
+           BME280_PRESSURE_PASCALS(ether->measurements.bme280.pressure.compensated),
+           PSYCHROMETRICS_CELSIUS(ether->measurements.psychrometrics.dew_point),
+           PSYCHROMETRICS_GRAMS(ether->measurements.psychrometrics.absolute_humidity),
+           PSYCHROMETRICS_CELSIUS(ether->measurements.psychrometrics.heat_index),
+           PSYCHROMETRICS_PASCALS(ether->measurements.psychrometrics.sea_level_pressure));
+#endif
+}
+
+#if defined(ETHER_CAPTURE)
+static void create_capture_message(const bme280_capture_summary_t *summary, char *mqtt_message)
+{
+  if ((!summary) || (!mqtt_message)) {
+    return;
+  }
+
+  snprintf(mqtt_message, MQTT_CONTROLLER_MESSAGE_MAX_SIZE, 
+           "ether capture:\n\rtriggered = %d\n\rstart = %lu\n\rpeak = %lu\n\rcount = %lu\n\roverruns = %lu\n\r"
+           "mean = %f\n\rmin = %f\n\rmax = %f\n\rbaseline = %f\n\r", 
+           summary->triggered,
+           (unsigned long)summary->start_us,
+           (unsigned long)summary->peak_us,
+           (unsigned long)summary->count,
+           (unsigned long)summary->overruns,
+           summary->mean,
+           summary->min,
+           summary->max,
+           summary->baseline);
 }
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 /* END OF STATIC FUNCTIONS                                                   */
@@ -76,7 +144,10 @@ void ether_mqtt_task(void *arg)
 
   ether_t *ether = arg;
   char mqtt_message[MQTT_CONTROLLER_MESSAGE_MAX_SIZE];
+  uint8_t pms7003_record[PMS7003_RECORD_SIZE];
   const char *mqtt_topic = "/topic/ether";
+  const char *mqtt_topic_pms7003 = "/topic/ether/pms7003";
+  size_t pms7003_record_size = 0;
   int result = 0;
 
   while (1) {
@@ -99,8 +170,22 @@ void ether_mqtt_task(void *arg)
     ESP_LOGI(MQTT_TASK_TAG, "result: %d", result);
 #endif
 
+    /* The whole PMS7003 data set, size distribution included, as a binary record. */
+    pms7003_record_size = (ether_pms7003_enabled) ?
+                          pms7003_record_encode(&ether->measurements.pms7003, pms7003_record, sizeof(pms7003_record)) : 0;
+
+    /* A length of 0 makes esp_mqtt_client_publish() take strlen() of the binary record. */
+    if (pms7003_record_size > 0) {
+      result = esp_mqtt_client_publish(ether->descriptor.mqtt_controller.client_handle, mqtt_topic_pms7003, 
+                                       (const char *)pms7003_record, (int)pms7003_record_size, 0, 0);
+
+#if defined(ETHER_DEBUG)
+      ESP_LOGI(MQTT_TASK_TAG, "result: %d", result);
+#endif
+    }
+
     vTaskDelay(ether_delay_60s);
-    xSemaphoreGive(ether_pms7003_semaphore);
+    xSemaphoreGive((ether_pms7003_enabled) ? ether_pms7003_semaphore : ether_bme280_semaphore);
   }
 }
 
@@ -118,8 +203,16 @@ void ether_bme280_task(void *arg)
   ether_t *ether = arg;
   uint8_t retry = 0;
   bme280_result_t result;
-
-  ether->state_machine.bme280 = BME280_STATE_RESET;
+  bme280_sample_t sample;
+
+  /* Woken from deep sleep the sensor kept its settings, only the calibration went with the RAM. */
+  if ((esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED) &&
+      (bme280_cache_load(&ether->descriptor.bme280, BME280_DATA_ID) == BME280_CACHE_RESULT_SUCCESS)) {
+    ether->state_machine.bme280 = (bme280_continuous(&ether->descriptor.bme280)) ? 
+                                  BME280_STATE_MEASURE_ALL : BME280_STATE_FORCE_MODE;
+  } else {
+    ether->state_machine.bme280 = BME280_STATE_RESET;
+  }
 
   while (1) {
     xSemaphoreTake(ether_bme280_semaphore, portMAX_DELAY);
@@ -137,6 +230,11 @@ void ether_bme280_task(void *arg)
           result = state_machine_bme280_init(ether);
           if (result != BME280_RESULT_SUCCESS) {
             ++retry;
+            break;
+          }
+          /* In normal mode the data registers hold the reset values until the first conversion is done. */
+          if (bme280_continuous(&ether->descriptor.bme280)) {
+            vTaskDelay(pdMS_TO_TICKS(bme280_measurement_time_us(&ether->descriptor.bme280.settings, true) / 1000) + 1);
           }
           break;
         }
@@ -158,17 +256,14 @@ void ether_bme280_task(void *arg)
           result = state_machine_bme280_force_mode(ether);
           if (result != BME280_RESULT_SUCCESS) {
             ++retry;
-            break;
           }
-          /* 
-           * time_measure[max_in_ms] = 1.25 + (2.3 * temp_oversampling) + 
-           *                           (2.3 * press_oversampling + 0.575) +
-           *                           (2.3 * hum_oversampling + 0.575)
-           *
-           * time_measure[max_in_ms] = 1.25 + 2.3 + (2.3 + 0.575) + (2.3 + 0.575)
-           * time_measure[max_in_ms] = 9.3ms
-           */
-          vTaskDelay(ether_delay_15ms);
+          break;
+        }
+        case BME280_STATE_WAIT: {
+          result = state_machine_bme280_wait(ether);
+          if (result != BME280_RESULT_SUCCESS) {
+            ++retry;
+          }
           break;
         }
         case BME280_STATE_MEASURE_HUMIDITY: {
@@ -192,22 +287,15 @@ void ether_bme280_task(void *arg)
           }
           break;
         }
-        case BME280_STATE_COMPENSATE_HUMIDITY: {
-          result = state_machine_bme280_compensate_humidity(ether);
-          if (result != BME280_RESULT_SUCCESS) {
-            ++retry;
-          }
-          break;
-        }
-        case BME280_STATE_COMPENSATE_TEMPERATURE: {
-          result = state_machine_bme280_compensate_temperature(ether);
+        case BME280_STATE_MEASURE_ALL: {
+          result = state_machine_bme280_measure_all(ether);
           if (result != BME280_RESULT_SUCCESS) {
             ++retry;
           }
           break;
         }
-        case BME280_STATE_COMPENSATE_PRESSURE: {
-          result = state_machine_bme280_compensate_pressure(ether);
+        case BME280_STATE_COMPENSATE: {
+          result = state_machine_bme280_compensate(ether);
           if (result != BME280_RESULT_SUCCESS) {
             ++retry;
           }
@@ -220,13 +308,49 @@ void ether_bme280_task(void *arg)
       }
     }
 
-    ether->state_machine.bme280 = BME280_STATE_FORCE_MODE;
+#if defined(ETHER_CAPTURE)
+    bme280_capture_summary_t summary;
+
+    /* Once the sensor is up the capture owns it, the cycle reports the latest window. */
+    if ((retry < 5) && (!ether_capture.task)) {
+      bme280_capture_start(&ether_capture, &ether->descriptor.bme280);
+    }
+
+    if (xQueuePeek(ether_capture_queue, &summary, 0) == pdTRUE) {
+      bme280_measurements_t latest;
+
+      bme280_sample_unpack(&summary.latest, &latest);
+      ether->measurements.bme280.pressure = latest.pressure;
+      ether->measurements.bme280.temperature = latest.temperature;
+    }
+
+    ether->state_machine.bme280 = (ether_capture.task) ? BME280_STATE_UNSET : BME280_STATE_MEASURE_ALL;
+#else
+    ether->state_machine.bme280 = (bme280_continuous(&ether->descriptor.bme280)) ? 
+                                  BME280_STATE_MEASURE_ALL : BME280_STATE_FORCE_MODE;
+#endif
+    /* A failed cycle left the last sample in place, it is neither derived nor profiled again. */
+    bool measured = (retry < 5);
     retry = 0;
 
+    if (measured) {
+      /* Derived once here, every consumer of the message gets the same definitions. */
+      bme280_sample_pack(&ether->measurements.bme280, (uint32_t)(esp_timer_get_time() / 1000), &sample);
+      psychrometrics_compute(&sample, ETHER_ALTITUDE_M, &ether->measurements.psychrometrics);
+
+#if !defined(ETHER_CAPTURE)
+      /* A new profile reaches the sensor through bme280_init() at the start of the next cycle. */
+      if (bme280_profile_update(&ether->descriptor.bme280_profile, &ether->descriptor.bme280, 
+                                &ether->measurements.bme280)) {
+        ether->state_machine.bme280 = BME280_STATE_INIT;
+      }
+#endif
+    }
+
 #if defined(ETHER_DEBUG)
-    ESP_LOGI(BME280_TASK_TAG, "humidity = %f", ether->measurements.bme280.humidity.compensated);
-    ESP_LOGI(BME280_TASK_TAG, "pressure = %f", ether->measurements.bme280.pressure.compensated);
-    ESP_LOGI(BME280_TASK_TAG, "temperature = %f\n\r", ether->measurements.bme280.temperature.compensated);
+    ESP_LOGI(BME280_TASK_TAG, "humidity = %f", BME280_HUMIDITY_PERCENT(ether->measurements.bme280.humidity.compensated));
+    ESP_LOGI(BME280_TASK_TAG, "pressure = %f", BME280_PRESSURE_PASCALS(ether->measurements.bme280.pressure.compensated));
+    ESP_LOGI(BME280_TASK_TAG, "temperature = %f\n\r", BME280_TEMPERATURE_CELSIUS(ether->measurements.bme280.temperature.compensated));
 #endif
 
     vTaskDelay(ether_delay_500ms);
@@ -235,6 +359,56 @@ void ether_bme280_task(void *arg)
   }
 }
 
+#if defined(ETHER_CAPTURE)
+void ether_capture_task(void *arg)
+{
+  static const char *CAPTURE_TASK_TAG = "CAPTURE_TASK";
+  esp_log_level_set(CAPTURE_TASK_TAG, ESP_LOG_INFO);
+
+  if (!arg) {
+    ESP_LOGE(CAPTURE_TASK_TAG, "Received null pointer argument");
+    vTaskDelete(xTaskGetCurrentTaskHandle());
+    return;
+  }
+
+  ether_t *ether = arg;
+  bme280_capture_detector_t detector = { 0 };
+  bme280_capture_summary_t summary;
+  bme280_capture_sample_t sample;
+  char mqtt_message[MQTT_CONTROLLER_MESSAGE_MAX_SIZE];
+  const char *mqtt_topic = "/topic/ether/capture";
+  uint32_t windows = 0;
+
+  while (1) {
+    vTaskDelay(ether_delay_100ms);
+
+    while (bme280_capture_pop(&ether_capture.ring, &sample)) {
+      if (!bme280_capture_process(&detector, &ether_capture, &sample, &summary)) {
+        continue;
+      }
+
+      xQueueOverwrite(ether_capture_queue, &summary);
+
+      /* Quiet windows only feed the 60 s report, a summary of them goes out now and then. */
+      if ((!summary.triggered) && (++windows < ETHER_CAPTURE_SUMMARY_WINDOWS)) {
+        continue;
+      }
+
+      windows = 0;
+      create_capture_message(&summary, mqtt_message);
+
+      /* Enqueued for the MQTT client task, the capture never waits for the network. */
+      esp_mqtt_client_enqueue(ether->descriptor.mqtt_controller.client_handle, 
+                              mqtt_topic, mqtt_message, 0, 0, 0, true);
+
+#if defined(ETHER_DEBUG)
+      ESP_LOGI(CAPTURE_TASK_TAG, "triggered = %d mean = %f", summary.triggered, summary.mean);
+#endif
+    }
+  }
+}
+#endif
+
 void ether_pms7003_task(void *arg)
 {
   static const char *PMS7003_TASK_TAG = "PMS7003_TASK";
@@ -247,35 +421,28 @@ void ether_pms7003_task(void *arg)
   }
 
   ether_t *ether = arg;
+  pms7003_scheduler_t *scheduler = &ether->descriptor.pms7003_scheduler;
   pms7003_frame_answer_t frame = { 0 };
+  pms7003_aggregate_t aggregate;
+  uint32_t wait_ms;
   uint8_t retry = 0;
   pms7003_result_t result;
+  pms7003_receiver_result_t receiver_result;
 
-  ether->state_machine.pms7003 = PMS7003_STATE_CHANGE_MODE_PASSIVE;
+  ether->state_machine.pms7003 = PMS7003_STATE_CHANGE_MODE_ACTIVE;
+  pms7003_scheduler_restore(scheduler);
 
   while (1) {
     xSemaphoreTake(ether_pms7003_semaphore, portMAX_DELAY);
-    
-    while ((ether->state_machine.pms7003 != PMS7003_STATE_UNSET) && (retry < 5)) {
-      switch (ether->state_machine.pms7003) {
-        case PMS7003_STATE_CHANGE_MODE_PASSIVE: {
-          result = pms7003_frame_send(&pms7003_change_mode_passive,
-                                      ether->descriptor.uart_controller.uart_port);
-
-#if defined(ETHER_DEBUG)
-          ESP_LOGI(PMS7003_TASK_TAG, "PMS7003_STATE_CHANGE_MODE_PASSIVE");
-          ESP_LOGI(PMS7003_TASK_TAG, "RESULT: %d", result);
-#endif
 
-          if (result != PMS7003_RESULT_SUCCESS) {
-            ++retry;
-            break;
-          }
+    /* Too early for the period or the fan life, the last reading stands and BME280 goes on. */
+    if (!pms7003_scheduler_due(scheduler, ether_time_ms())) {
+      xSemaphoreGive(ether_bme280_semaphore);
+      continue;
+    }
 
-          ether->state_machine.pms7003 = PMS7003_STATE_WAKEUP;
-          vTaskDelay(ether_delay_500ms);
-          break;
-        }
+    while ((ether->state_machine.pms7003 != PMS7003_STATE_UNSET) && (retry < 5)) {
+      switch (ether->state_machine.pms7003) {
         case PMS7003_STATE_CHANGE_MODE_ACTIVE: {
           result = pms7003_frame_send(&pms7003_change_mode_active,
                                       ether->descriptor.uart_controller.uart_port);
@@ -294,7 +461,9 @@ void ether_pms7003_task(void *arg)
           break;
         }
         case PMS7003_STATE_WAKEUP: {
-          result = pms7003_frame_send(&pms7003_wakeup, ether->descriptor.uart_controller.uart_port);
+          /* Still running from the previous cycle, nothing to wake up. */
+          result = scheduler->awake ? PMS7003_RESULT_SUCCESS :
+                   pms7003_frame_send(&pms7003_wakeup, ether->descriptor.uart_controller.uart_port);
 
 #if defined(ETHER_DEBUG)
           ESP_LOGI(PMS7003_TASK_TAG, "PMS7003_STATE_WAKEUP");
@@ -305,47 +474,54 @@ void ether_pms7003_task(void *arg)
             break;
           }
 
-          ether->state_machine.pms7003 = PMS7003_STATE_READ_REQUEST;
-          /* Wait at least 30s to get stable data. */
-          vTaskDelay(ether_delay_30s);
-          break;
-        }
-        case PMS7003_STATE_READ_REQUEST: {
-          for (uint8_t i = 0; i < 5; i++) {
-            /* Avoid getting unstable data. */
-            uart_flush(ether->descriptor.uart_controller.uart_port);
-            result = pms7003_frame_send(&pms7003_read_request, ether->descriptor.uart_controller.uart_port);
-            vTaskDelay(ether_delay_500ms);
-          }
+          pms7003_scheduler_wakeup(scheduler, ether_time_ms());
+          ether->state_machine.pms7003 = PMS7003_STATE_READ;
 
-#if defined(ETHER_DEBUG)
-          ESP_LOGI(PMS7003_TASK_TAG, "PMS7003_STATE_READ_REQUEST");
-          ESP_LOGI(PMS7003_TASK_TAG, "RESULT: %d", result);
-#endif
+          /* Wait until the fan has run 30s to get stable data. */
+          wait_ms = pms7003_scheduler_warmup_left(scheduler, ether_time_ms());
 
-          if (result != PMS7003_RESULT_SUCCESS) {
-            ++retry;
-            break;
+          if (wait_ms > 0) {
+            vTaskDelay(pdMS_TO_TICKS(wait_ms));
           }
-
-          ether->state_machine.pms7003 = PMS7003_STATE_READ;
           break;
         }
         case PMS7003_STATE_READ: {
-          result = pms7003_frame_receive(&pms7003_read, ether->descriptor.uart_controller.uart_port, &frame);
+          TickType_t start = xTaskGetTickCount();
+          int64_t start_ms = ether_time_ms();
+
+          /* Frames from before the warmup ended are not stable. */
+          pms7003_receiver_flush(&ether->descriptor.pms7003_receiver);
+          pms7003_aggregate_reset(&aggregate);
+
+          /* Active mode, the sensor sends a frame every 0.2...2.3 s on its own. */
+          do {
+            receiver_result = pms7003_receiver_wait(&ether->descriptor.pms7003_receiver, &frame,
+                                                    pdMS_TO_TICKS(PMS7003_RECEIVER_DEADLINE_MS));
+
+            if (receiver_result != PMS7003_RECEIVER_RESULT_SUCCESS) {
+              break;
+            }
+
+            pms7003_aggregate_add(&aggregate, &frame);
+          } while ((xTaskGetTickCount() - start) < pdMS_TO_TICKS(PMS7003_SCHEDULER_READ_MS));
 
 #if defined(ETHER_DEBUG)
           ESP_LOGI(PMS7003_TASK_TAG, "PMS7003_STATE_READ");
-          ESP_LOGI(PMS7003_TASK_TAG, "RESULT: %d", result);
+          ESP_LOGI(PMS7003_TASK_TAG, "RESULT: %d, FRAMES: %d", receiver_result, aggregate.count);
 #endif
 
-          if (result != PMS7003_RESULT_SUCCESS) {
+          if (!pms7003_aggregate_result(&aggregate, PMS7003_AGGREGATE_MEDIAN, &ether->measurements.pms7003)) {
+            ESP_LOGI(PMS7003_TASK_TAG, "pms7003_receiver_wait result = 0x%x", receiver_result);
             ++retry;
             break;
           }
 
-          ether->state_machine.pms7003 = PMS7003_STATE_SLEEP;
-          vTaskDelay(ether_delay_500ms);
+          /* Only a window with a result is a reading, a failed one is retried without a period. */
+          pms7003_scheduler_read(scheduler, start_ms);
+
+          /* A sleep shorter than the next warmup would not save any fan time. */
+          ether->state_machine.pms7003 = pms7003_scheduler_keep_awake(scheduler, ether_time_ms()) ?
+                                         PMS7003_STATE_UNSET : PMS7003_STATE_SLEEP;
           break;
         }
         case PMS7003_STATE_SLEEP: {
@@ -361,6 +537,7 @@ void ether_pms7003_task(void *arg)
             break;
           }
 
+          pms7003_scheduler_sleep(scheduler, ether_time_ms());
           ether->state_machine.pms7003 = PMS7003_STATE_UNSET;
           vTaskDelay(ether_delay_500ms);
           break;
@@ -376,9 +553,12 @@ void ether_pms7003_task(void *arg)
       }
     }
     
-    ether->measurements.pms7003.pm1   = convert_to_little_endian(frame.data_pm1_standard);
-    ether->measurements.pms7003.pm25  = convert_to_little_endian(frame.data_pm25_standard);
-    ether->measurements.pms7003.pm10  = convert_to_little_endian(frame.data_pm10_standard);
+#if defined(ETHER_DEBUG)
+    ESP_LOGI(PMS7003_TASK_TAG, "fan on = %llu s, warmups = %lu, warm = %lu, period = %lu ms",
+             (unsigned long long)(pms7003_scheduler_on_time(scheduler, ether_time_ms()) / 1000),
+             (unsigned long)scheduler->warmups, (unsigned long)scheduler->warm_reads,
+             (unsigned long)pms7003_scheduler_period(scheduler));
+#endif
 
     ether->state_machine.pms7003 = PMS7003_STATE_WAKEUP;
 
@@ -401,6 +581,15 @@ void app_main(void)
   }
   ESP_ERROR_CHECK(ret);
 
+#if defined(BME280_SELFTEST)
+  static const char *APP_MAIN_TAG = "APP_MAIN";
+  bme280_selftest_report_t selftest;
+
+  if (bme280_selftest_run(&selftest) != BME280_SELFTEST_RESULT_SUCCESS) {
+    ESP_LOGE(APP_MAIN_TAG, "BME280 compensation self test failed");
+  }
+#endif
+
   ether_init(&ether);
   controller_init(&ether);
 
@@ -408,11 +597,24 @@ void app_main(void)
   ether_mqtt_semaphore    = xSemaphoreCreateBinary();
   ether_bme280_semaphore  = xSemaphoreCreateBinary();
 
-  xSemaphoreGive(ether_pms7003_semaphore);
+#if defined(ETHER_CAPTURE)
+  /* The BME280 task peeks at it from its first cycle on. */
+  ether_capture_queue = xQueueCreate(1, sizeof(bme280_capture_summary_t));
+#endif
+
+  if (ether_pms7003_enabled) {
+    xSemaphoreGive(ether_pms7003_semaphore);
+    xTaskCreate(ether_pms7003_task, "pms7003_task", 4096 * 2, &ether, configMAX_PRIORITIES - 1, NULL);
+  } else {
+    xSemaphoreGive(ether_bme280_semaphore);
+  }
 
-  xTaskCreate(ether_pms7003_task, "pms7003_task", 4096 * 2, &ether, configMAX_PRIORITIES - 1, NULL);
   xTaskCreate(ether_mqtt_task, "mqtt_task", 4096 * 2, &ether, configMAX_PRIORITIES - 1, NULL);
   xTaskCreate(ether_bme280_task, "bme280_task", 4096 * 2, &ether, configMAX_PRIORITIES - 1, NULL);
 
+#if defined(ETHER_CAPTURE)
+  xTaskCreate(ether_capture_task, "capture_task", 4096 * 2, &ether, tskIDLE_PRIORITY + 1, NULL);
+#endif
+
   while(1);
 }
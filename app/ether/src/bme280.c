@@ -1,37 +1,196 @@
 #include "bme280.h"
+#include <math.h>
+
+#if defined(BME280_COMPENSATION_FLOAT)
+typedef float bme280_real_t;                /*!< Single precision, the one the ESP32 FPU computes. */
+#define BME280_REAL(constant)   (constant##f)
+#define BME280_ROUND(value)     lroundf(value)
+#elif !defined(BME280_COMPENSATION_INTEGER)
+typedef double bme280_real_t;               /*!< Double precision, computed in software on the ESP32. */
+#define BME280_REAL(constant)   (constant)
+#define BME280_ROUND(value)     lround(value)
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+/* Oversampling setting to number of samples: skipped, 1, 2, 4, 8, 16 (and above). */
+static uint32_t bme280_samples(uint8_t osrs)
+{
+  osrs &= 0x07;
 
-static int32_t t_fine;
+  return ((osrs == 0) ? 0 : (1u << ((osrs > 5 ? 5 : osrs) - 1)));
+}
 
-bme280_result_t bme280_init(i2c_port_t i2c_num, const bme280_settings_t *settings) 
+static TickType_t bme280_us_to_ticks(uint32_t time_us)
 {
-  if (!settings) {
+  const uint32_t tick_us = portTICK_PERIOD_MS * 1000;
+
+  return (TickType_t)((time_us + tick_us - 1) / tick_us);
+}
+
+static void bme280_compensate_humidity(bme280_dev_t *dev, bme280_humidity_t *humidity) 
+{
+  const bme280_compensator_t *compensator = &dev->compensator;
+  int32_t t_fine = dev->t_fine;
+
+  int32_t adc_h = (((humidity->msb) << 8 ) | humidity->lsb);
+
+#if defined(BME280_COMPENSATION_INTEGER)
+  int32_t var_h;
+
+  var_h = (t_fine - ((int32_t)76800));
+  var_h = (((((adc_h << 14) - (((int32_t)compensator->dig_h4) << 20) - (((int32_t)compensator->dig_h5) * var_h)) + 
+          ((int32_t)16384)) >> 15) * (((((((var_h * ((int32_t)compensator->dig_h6)) >> 10) * 
+          (((var_h * ((int32_t)compensator->dig_h3)) >> 11) + ((int32_t)32768))) >> 10) + ((int32_t)2097152)) * 
+          ((int32_t)compensator->dig_h2) + 8192) >> 14));
+  var_h = (var_h - (((((var_h >> 15) * (var_h >> 15)) >> 7) * ((int32_t)compensator->dig_h1)) >> 4));
+  var_h = (var_h < 0) ? 0 : var_h;
+  var_h = (var_h > 419430400) ? 419430400 : var_h;
+
+  humidity->compensated = (uint32_t)(var_h >> 12);
+#else
+  bme280_real_t var_h;
+
+  var_h = (((bme280_real_t)t_fine) - BME280_REAL(76800.0));
+  var_h = (adc_h - (((bme280_real_t)compensator->dig_h4) * BME280_REAL(64.0) + 
+          ((bme280_real_t)compensator->dig_h5) / BME280_REAL(16384.0) * var_h)) * 
+          (((bme280_real_t)compensator->dig_h2) / BME280_REAL(65536.0) * 
+          (BME280_REAL(1.0) + ((bme280_real_t)compensator->dig_h6) / BME280_REAL(67108864.0) * var_h * 
+          (BME280_REAL(1.0) + ((bme280_real_t)compensator->dig_h3) / BME280_REAL(67108864.0) * var_h)));
+  var_h = var_h * (BME280_REAL(1.0) - ((bme280_real_t)compensator->dig_h1) * var_h / BME280_REAL(524288.0));
+
+  if (var_h > BME280_REAL(100.0)) {
+    var_h = BME280_REAL(100.0);
+  } 
+  else if (var_h < BME280_REAL(0.0)) {
+    var_h = BME280_REAL(0.0);
+  }
+
+  humidity->compensated = var_h;
+#endif
+}
+
+/* Leaves t_fine in the sensor instance for the pressure and humidity compensation. */
+static void bme280_compensate_temperature(bme280_dev_t *dev, bme280_temperature_t *temperature) 
+{
+  const bme280_compensator_t *compensator = &dev->compensator;
+
+  int32_t adc_t = (((temperature->msb) << 12) | ((temperature->lsb) << 4) | ((temperature->xlsb) >> 4));
+
+#if defined(BME280_COMPENSATION_INTEGER)
+  int32_t var_1, var_2;
+
+  var_1 = ((((adc_t >> 3) - ((int32_t)compensator->dig_t1 << 1))) * ((int32_t)compensator->dig_t2)) >> 11;
+  var_2 = (((((adc_t >> 4) - ((int32_t)compensator->dig_t1)) * ((adc_t >> 4) - ((int32_t)compensator->dig_t1))) >> 12) * 
+          ((int32_t)compensator->dig_t3)) >> 14;
+
+  dev->t_fine = var_1 + var_2;
+  temperature->compensated = (dev->t_fine * 5 + 128) >> 8;
+#else
+  bme280_real_t var_1, var_2;
+
+  var_1 = (((bme280_real_t)adc_t) / BME280_REAL(16384.0) - ((bme280_real_t)compensator->dig_t1) / BME280_REAL(1024.0)) * 
+          ((bme280_real_t)compensator->dig_t2);
+  var_2 = ((((bme280_real_t)adc_t) / BME280_REAL(131072.0) - ((bme280_real_t)compensator->dig_t1) / BME280_REAL(8192.0)) * 
+          (((bme280_real_t)adc_t) / BME280_REAL(131072.0) - ((bme280_real_t)compensator->dig_t1) / BME280_REAL(8192.0))) * 
+          ((bme280_real_t)compensator->dig_t3);
+
+  dev->t_fine = (int32_t)(var_1 + var_2);
+  temperature->compensated = (var_1 + var_2) / BME280_REAL(5120.0);
+#endif
+}
+
+static bme280_result_t bme280_compensate_pressure(bme280_dev_t *dev, bme280_pressure_t *pressure) 
+{
+  const bme280_compensator_t *compensator = &dev->compensator;
+  int32_t t_fine = dev->t_fine;
+
+  int32_t adc_p = (((pressure->msb) << 12) | ((pressure->lsb) << 4) | ((pressure->xlsb) >> 4));
+
+#if defined(BME280_COMPENSATION_INTEGER)
+  int64_t var_1, var_2, var_p;
+
+  var_1 = ((int64_t)t_fine) - 128000;
+  var_2 = var_1 * var_1 * (int64_t)compensator->dig_p6;
+  var_2 = var_2 + ((var_1 * (int64_t)compensator->dig_p5) << 17);
+  var_2 = var_2 + (((int64_t)compensator->dig_p4) << 35);
+  var_1 = ((var_1 * var_1 * (int64_t)compensator->dig_p3) >> 8) + ((var_1 * (int64_t)compensator->dig_p2) << 12);
+  var_1 = (((((int64_t)1) << 47) + var_1)) * ((int64_t)compensator->dig_p1) >> 33;
+
+  if (var_1 == 0) {
     return BME280_RESULT_ERROR;
   }
 
-  i2c_controller_result_t result;
+  var_p = 1048576 - adc_p;
+  var_p = (((var_p << 31) - var_2) * 3125) / var_1;
+  var_1 = (((int64_t)compensator->dig_p9) * (var_p >> 13) * (var_p >> 13)) >> 25;
+  var_2 = (((int64_t)compensator->dig_p8) * var_p) >> 19;
+  var_p = ((var_p + var_1 + var_2) >> 8) + (((int64_t)compensator->dig_p7) << 4);
 
-  /* CTRL_HUM Register settings. */
-  result = i2c_controller_send(i2c_num, BME280_I2C_ADDRESS, 
-                               BME280_REGISTER_CTRL_HUM, &settings->ctrl_hum, 
-                               sizeof(settings->ctrl_hum));
+  pressure->compensated = (uint32_t)var_p;
+#else
+  bme280_real_t var_1, var_2;
 
-  if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
+  var_1 = ((bme280_real_t)t_fine / BME280_REAL(2.0)) - BME280_REAL(64000.0);
+  var_2 = var_1 * var_1 * ((bme280_real_t)compensator->dig_p6) / BME280_REAL(32768.0);
+  var_2 = var_2 + var_1 * ((bme280_real_t)compensator->dig_p5) * BME280_REAL(2.0);
+  var_2 = (var_2 / BME280_REAL(4.0)) + (((bme280_real_t)compensator->dig_p4) * BME280_REAL(65536.0));
+  var_1 = (((bme280_real_t)compensator->dig_p3) * var_1 * var_1 / BME280_REAL(524288.0) + 
+           ((bme280_real_t)compensator->dig_p2) * var_1) / BME280_REAL(524288.0);
+  var_1 = (BME280_REAL(1.0) + var_1 / BME280_REAL(32768.0)) * ((bme280_real_t)compensator->dig_p1);
+
+  if (var_1 == 0) {
     return BME280_RESULT_ERROR;
   }
 
-  /* CTRL_MEAS Register settings. */
-  result = i2c_controller_send(i2c_num, BME280_I2C_ADDRESS, 
-                               BME280_REGISTER_CTRL_MEAS, &settings->ctrl_meas, 
-                               sizeof(settings->ctrl_meas));
+  pressure->compensated = BME280_REAL(1048576.0) - (bme280_real_t)adc_p;
+  pressure->compensated = (pressure->compensated - (var_2 / BME280_REAL(4096.0))) * BME280_REAL(6250.0) / var_1;
 
-  if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
+  var_1 = ((bme280_real_t)compensator->dig_p9) * pressure->compensated * pressure->compensated / 
+          BME280_REAL(2147483648.0);
+  var_2 = pressure->compensated * ((bme280_real_t)compensator->dig_p8) / BME280_REAL(32768.0);
+
+  pressure->compensated = pressure->compensated + 
+                          (var_1 + var_2 + ((bme280_real_t)compensator->dig_p7)) / BME280_REAL(16.0);
+#endif
+
+  return BME280_RESULT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+bme280_result_t bme280_init(bme280_dev_t *dev) 
+{
+  if (!dev) {
     return BME280_RESULT_ERROR;
   }
 
-  /* CONFIG Register settings. */
-  result = i2c_controller_send(i2c_num, BME280_I2C_ADDRESS, 
-                               BME280_REGISTER_CONFIG, &settings->config, 
-                               sizeof(settings->config));
+  i2c_controller_result_t result;
+  const bme280_settings_t *settings = &dev->settings;
+
+  /* 
+   * CTRL_HUM takes effect only after the CTRL_MEAS write and CONFIG writes 
+   * may be ignored in normal mode, so CTRL_MEAS (the mode) goes last. When
+   * a new filter or standby time goes to a sensor in normal mode, it is put
+   * to sleep first, in the same transaction, so that CONFIG is not ignored.
+   * Without the sleep pair an unchanged configuration matches the register
+   * shadow and no transaction is sent.
+   */
+  const i2c_controller_pair_t pairs[] = {
+    { .reg = BME280_REGISTER_CTRL_MEAS, .value = (uint8_t)(settings->ctrl_meas & ~BME280_SETTINGS_MODE_MASK) },
+    { .reg = BME280_REGISTER_CTRL_HUM,  .value = settings->ctrl_hum },
+    { .reg = BME280_REGISTER_CONFIG,    .value = settings->config },
+    { .reg = BME280_REGISTER_CTRL_MEAS, .value = settings->ctrl_meas },
+  };
+  size_t skip = ((bme280_continuous(dev)) && 
+                 (!i2c_controller_device_shadowed(&dev->device, BME280_REGISTER_CONFIG, settings->config))) ? 0 : 1;
+
+  result = i2c_controller_device_send_pairs(&dev->device, &pairs[skip], 
+                                            ((sizeof(pairs) / sizeof(pairs[0])) - skip));
 
   if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
@@ -40,14 +199,20 @@ bme280_result_t bme280_init(i2c_port_t i2c_num, const bme280_settings_t *setting
   return BME280_RESULT_SUCCESS;
 }
 
-bme280_result_t bme280_reset(i2c_port_t i2c_num) 
+bme280_result_t bme280_reset(bme280_dev_t *dev) 
 {
+  if (!dev) {
+    return BME280_RESULT_ERROR;
+  }
+
   i2c_controller_result_t result;
   uint8_t data = BME280_DATA_RESET;
 
-  result = i2c_controller_send(i2c_num, BME280_I2C_ADDRESS, 
-                               BME280_REGISTER_RESET, &data, 
-                               sizeof(data));
+  result = i2c_controller_device_send(&dev->device, BME280_REGISTER_RESET, &data, 
+                                      sizeof(data));
+
+  /* All the registers are back at their reset values. */
+  i2c_controller_device_invalidate(&dev->device);
 
   if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
@@ -56,17 +221,16 @@ bme280_result_t bme280_reset(i2c_port_t i2c_num)
   return BME280_RESULT_SUCCESS;
 }
 
-bme280_result_t bme280_id(i2c_port_t i2c_num, uint8_t *data, size_t data_len) 
+bme280_result_t bme280_id(bme280_dev_t *dev, uint8_t *data, size_t data_len) 
 {
-  if ((!data) || (data_len == 0)) {
+  if ((!dev) || (!data) || (data_len == 0)) {
     return BME280_RESULT_ERROR; 
   }
   
   i2c_controller_result_t result;
 
-  result = i2c_controller_receive(i2c_num, BME280_I2C_ADDRESS, 
-                                  BME280_REGISTER_ID, data, 
-                                  data_len);
+  result = i2c_controller_device_receive(&dev->device, BME280_REGISTER_ID, data, 
+                                         data_len);
 
   if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
@@ -75,17 +239,25 @@ bme280_result_t bme280_id(i2c_port_t i2c_num, uint8_t *data, size_t data_len)
   return BME280_RESULT_SUCCESS;
 }
 
-bme280_result_t bme280_force_mode(i2c_port_t i2c_num, const bme280_settings_t *settings) 
+bme280_result_t bme280_force_mode(bme280_dev_t *dev) 
 {
-  if (!settings) {
+  if (!dev) {
     return BME280_RESULT_ERROR;
   }
 
   i2c_controller_result_t result;
+  const bme280_settings_t *settings = &dev->settings;
 
-  result = i2c_controller_send(i2c_num, BME280_I2C_ADDRESS, 
-                               BME280_REGISTER_CTRL_MEAS, &settings->ctrl_meas, 
-                               sizeof(settings->ctrl_meas));
+  uint8_t mode = settings->ctrl_meas & BME280_SETTINGS_MODE_MASK;
+
+  if ((mode != BME280_SETTINGS_MODE_SLEEP) && (mode != BME280_SETTINGS_MODE_NORMAL)) {
+    /* In force mode the write itself starts the conversion, it is never redundant. */
+    result = i2c_controller_device_send(&dev->device, BME280_REGISTER_CTRL_MEAS, &settings->ctrl_meas, 
+                                        sizeof(settings->ctrl_meas));
+  } else {
+    result = i2c_controller_device_send_cached(&dev->device, BME280_REGISTER_CTRL_MEAS, 
+                                               settings->ctrl_meas);
+  }
 
   if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
@@ -94,18 +266,148 @@ bme280_result_t bme280_force_mode(i2c_port_t i2c_num, const bme280_settings_t *s
   return BME280_RESULT_SUCCESS;
 }
 
-bme280_result_t bme280_measure_humidity(i2c_port_t i2c_num, bme280_humidity_t *humidity) 
+uint32_t bme280_measurement_time_us(const bme280_settings_t *settings, bool max)
 {
-  if (!humidity) {
+  if (!settings) {
+    return 0;
+  }
+
+  uint32_t osrs_t = bme280_samples(settings->ctrl_meas >> 5);
+  uint32_t osrs_p = bme280_samples(settings->ctrl_meas >> 2);
+  uint32_t osrs_h = bme280_samples(settings->ctrl_hum);
+  uint32_t step_us = (max) ? 2300 : 2000;
+  uint32_t settle_us = (max) ? 575 : 500;
+  uint32_t time_us = ((max) ? 1250 : 1000) + (step_us * osrs_t);
+
+  time_us += (osrs_p) ? ((step_us * osrs_p) + settle_us) : 0;
+  time_us += (osrs_h) ? ((step_us * osrs_h) + settle_us) : 0;
+
+  return time_us;
+}
+
+bme280_result_t bme280_sample_pack(const bme280_measurements_t *measurements, uint32_t timestamp_ms, 
+                                   bme280_sample_t *sample)
+{
+  if ((!measurements) || (!sample)) {
+    return BME280_RESULT_ERROR;
+  }
+
+  const bme280_pressure_t *pressure = &measurements->pressure;
+  const bme280_temperature_t *temperature = &measurements->temperature;
+  const bme280_humidity_t *humidity = &measurements->humidity;
+
+  sample->adc_p = ((uint32_t)pressure->msb << 12) | ((uint32_t)pressure->lsb << 4) | (pressure->xlsb >> 4);
+  sample->adc_t = ((uint32_t)temperature->msb << 12) | ((uint32_t)temperature->lsb << 4) | (temperature->xlsb >> 4);
+  sample->adc_h = ((uint32_t)humidity->msb << 8) | humidity->lsb;
+  sample->reserved = 0;
+  sample->timestamp_ms = timestamp_ms;
+
+#if defined(BME280_COMPENSATION_INTEGER)
+  sample->temperature = temperature->compensated;
+  sample->pressure = (int32_t)pressure->compensated;
+  sample->humidity = (int32_t)humidity->compensated;
+#else
+  sample->temperature = (int32_t)BME280_ROUND(temperature->compensated * BME280_REAL(100.0));
+  sample->pressure = (int32_t)BME280_ROUND(pressure->compensated * BME280_REAL(256.0));
+  sample->humidity = (int32_t)BME280_ROUND(humidity->compensated * BME280_REAL(1024.0));
+#endif
+
+  return BME280_RESULT_SUCCESS;
+}
+
+bme280_result_t bme280_sample_unpack(const bme280_sample_t *sample, bme280_measurements_t *measurements)
+{
+  if ((!sample) || (!measurements)) {
+    return BME280_RESULT_ERROR;
+  }
+
+  measurements->pressure.msb      = (uint8_t)(sample->adc_p >> 12);
+  measurements->pressure.lsb      = (uint8_t)(sample->adc_p >> 4);
+  measurements->pressure.xlsb     = (uint8_t)(sample->adc_p << 4);
+
+  measurements->temperature.msb   = (uint8_t)(sample->adc_t >> 12);
+  measurements->temperature.lsb   = (uint8_t)(sample->adc_t >> 4);
+  measurements->temperature.xlsb  = (uint8_t)(sample->adc_t << 4);
+
+  measurements->humidity.msb      = (uint8_t)(sample->adc_h >> 8);
+  measurements->humidity.lsb      = (uint8_t)(sample->adc_h);
+
+#if defined(BME280_COMPENSATION_INTEGER)
+  measurements->temperature.compensated = sample->temperature;
+  measurements->pressure.compensated = (uint32_t)sample->pressure;
+  measurements->humidity.compensated = (uint32_t)sample->humidity;
+#else
+  measurements->temperature.compensated = sample->temperature / BME280_REAL(100.0);
+  measurements->pressure.compensated = sample->pressure / BME280_REAL(256.0);
+  measurements->humidity.compensated = sample->humidity / BME280_REAL(1024.0);
+#endif
+
+  return BME280_RESULT_SUCCESS;
+}
+
+uint32_t bme280_standby_time_us(const bme280_settings_t *settings)
+{
+  static const uint32_t standby_us[] = {
+    500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000,
+  };
+
+  if (!settings) {
+    return 0;
+  }
+
+  return standby_us[(settings->config >> 5) & 0x07];
+}
+
+bme280_result_t bme280_wait(bme280_dev_t *dev)
+{
+  if (!dev) {
+    return BME280_RESULT_ERROR;
+  }
+
+  i2c_controller_result_t result;
+  uint8_t status = 0;
+  TickType_t start = xTaskGetTickCount();
+  /* One extra tick, the conversion starts somewhere within the tick of the trigger. */
+  TickType_t deadline = bme280_us_to_ticks(bme280_measurement_time_us(&dev->settings, true)) + 1;
+
+  vTaskDelay(bme280_us_to_ticks(bme280_measurement_time_us(&dev->settings, false)));
+
+  while (1) {
+    result = i2c_controller_device_receive(&dev->device, BME280_REGISTER_STATUS, &status, 
+                                           sizeof(status));
+
+    if ((result == I2C_CONTROLLER_RESULT_SUCCESS) && (!(status & BME280_STATUS_MEASURING))) {
+      return BME280_RESULT_SUCCESS;
+    }
+
+    if ((TickType_t)(xTaskGetTickCount() - start) >= deadline) {
+      return BME280_RESULT_ERROR;
+    }
+
+    vTaskDelay(1);
+  }
+}
+
+bool bme280_continuous(const bme280_dev_t *dev)
+{
+  if (!dev) {
+    return false;
+  }
+
+  return ((dev->settings.ctrl_meas & BME280_SETTINGS_MODE_MASK) == BME280_SETTINGS_MODE_NORMAL);
+}
+
+bme280_result_t bme280_measure_humidity(bme280_dev_t *dev, bme280_humidity_t *humidity) 
+{
+  if ((!dev) || (!humidity)) {
     return BME280_RESULT_ERROR;
   }
 
   i2c_controller_result_t result;
   uint8_t data[BME280_SIZE_HUM];
 
-  result = i2c_controller_receive(i2c_num, BME280_I2C_ADDRESS, 
-                                  BME280_REGISTER_HUM_MSB, data, 
-                                  sizeof(data));
+  result = i2c_controller_device_receive(&dev->device, BME280_REGISTER_HUM_MSB, data, 
+                                         sizeof(data));
 
   if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
@@ -117,19 +419,17 @@ bme280_result_t bme280_measure_humidity(i2c_port_t i2c_num, bme280_humidity_t *h
   return BME280_RESULT_SUCCESS;
 }
 
-bme280_result_t bme280_measure_temperature(i2c_port_t i2c_num, 
-                                           bme280_temperature_t *temperature) 
+bme280_result_t bme280_measure_temperature(bme280_dev_t *dev, bme280_temperature_t *temperature) 
 {
-  if (!temperature) {
+  if ((!dev) || (!temperature)) {
     return BME280_RESULT_ERROR;
   }
 
   i2c_controller_result_t result;
   uint8_t data[BME280_SIZE_TEMP];
 
-  result = i2c_controller_receive(i2c_num, BME280_I2C_ADDRESS, 
-                                  BME280_REGISTER_TEMP_MSB, data, 
-                                  sizeof(data));
+  result = i2c_controller_device_receive(&dev->device, BME280_REGISTER_TEMP_MSB, data, 
+                                         sizeof(data));
 
   if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
@@ -142,18 +442,17 @@ bme280_result_t bme280_measure_temperature(i2c_port_t i2c_num,
   return BME280_RESULT_SUCCESS;
 }
 
-bme280_result_t bme280_measure_pressure(i2c_port_t i2c_num, bme280_pressure_t *pressure) 
+bme280_result_t bme280_measure_pressure(bme280_dev_t *dev, bme280_pressure_t *pressure) 
 {
-  if (!pressure) {
+  if ((!dev) || (!pressure)) {
     return BME280_RESULT_ERROR;
   }
 
   i2c_controller_result_t result;
   uint8_t data[BME280_SIZE_PRESS];
 
-  result = i2c_controller_receive(i2c_num, BME280_I2C_ADDRESS, 
-                                  BME280_REGISTER_PRESS_MSB, data, 
-                                  sizeof(data));
+  result = i2c_controller_device_receive(&dev->device, BME280_REGISTER_PRESS_MSB, data, 
+                                         sizeof(data));
 
   if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
@@ -166,43 +465,72 @@ bme280_result_t bme280_measure_pressure(i2c_port_t i2c_num, bme280_pressure_t *p
   return BME280_RESULT_SUCCESS;
 }
 
-bme280_result_t bme280_get_compensation_data(i2c_port_t i2c_num, 
-                                             bme280_compensator_t *compensator) 
+bme280_result_t bme280_measure_all(bme280_dev_t *dev, bme280_measurements_t *measurements) 
 {
-  if (!compensator) {
+  if ((!dev) || (!measurements)) {
     return BME280_RESULT_ERROR;
   }
 
   i2c_controller_result_t result;
-  uint8_t data[BME280_SIZE_COMP];
-  uint8_t first_part = 24;
-  uint8_t second_part = 1;
-  uint8_t third_part = 7;
+  uint8_t data[BME280_SIZE_DATA];
 
-  result = i2c_controller_receive(i2c_num, BME280_I2C_ADDRESS, 
-                                  BME280_REGISTER_CALIB00, data, 
-                                  first_part);
+  /* Burst read guarantees that all the values belong to the same measurement. */
+  result = i2c_controller_device_receive(&dev->device, BME280_REGISTER_PRESS_MSB, data, 
+                                         sizeof(data));
 
   if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
   }
 
-  result = i2c_controller_receive(i2c_num, BME280_I2C_ADDRESS, 
-                                  BME280_REGISTER_CALIB25, (data + first_part), 
-                                  second_part);
-  
+  measurements->pressure.msb      = data[0];
+  measurements->pressure.lsb      = data[1];
+  measurements->pressure.xlsb     = data[2] & 0xf0;
+
+  measurements->temperature.msb   = data[3];
+  measurements->temperature.lsb   = data[4];
+  measurements->temperature.xlsb  = data[5] & 0xf0;
+
+  measurements->humidity.msb      = data[6];
+  measurements->humidity.lsb      = data[7];
+
+  return BME280_RESULT_SUCCESS;
+}
+
+bme280_result_t bme280_read_calibration(bme280_dev_t *dev, uint8_t *data, size_t data_len) 
+{
+  if ((!dev) || (!data) || (data_len < BME280_SIZE_COMP)) {
+    return BME280_RESULT_ERROR;
+  }
+
+  i2c_controller_result_t result;
+  uint8_t first_part = BME280_REGISTER_CALIB25 - BME280_REGISTER_CALIB00 + 1;
+  uint8_t second_part = BME280_SIZE_COMP - first_part;
+
+  /* 0x88...0xa1 in one burst, the reserved 0xa0 included, then 0xe1...0xe7. */
+  result = i2c_controller_device_receive(&dev->device, BME280_REGISTER_CALIB00, data, 
+                                         first_part);
+
   if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
   }
 
-  result = i2c_controller_receive(i2c_num, BME280_I2C_ADDRESS, 
-                                  BME280_REGISTER_CALIB26, (data + first_part + second_part), 
-                                  third_part);
+  result = i2c_controller_device_receive(&dev->device, BME280_REGISTER_CALIB26, (data + first_part), 
+                                         second_part);
 
   if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
   }
 
+  return BME280_RESULT_SUCCESS;
+}
+
+bme280_result_t bme280_parse_calibration(const uint8_t *data, size_t data_len, 
+                                         bme280_compensator_t *compensator) 
+{
+  if ((!data) || (data_len < BME280_SIZE_COMP) || (!compensator)) {
+    return BME280_RESULT_ERROR;
+  }
+
   compensator->dig_t1 = ((data[1]   << 8) | data[0]);
   compensator->dig_t2 = ((data[3]   << 8) | data[2]);
   compensator->dig_t3 = ((data[5]   << 8) | data[4]);
@@ -216,90 +544,45 @@ bme280_result_t bme280_get_compensation_data(i2c_port_t i2c_num,
   compensator->dig_p8 = ((data[21]  << 8) | data[20]);
   compensator->dig_p9 = ((data[23]  << 8) | data[22]);
 
-  compensator->dig_h1 = (data[24]   << 8);
-  compensator->dig_h2 = ((data[26]  << 8) | data[25]);
-  compensator->dig_h3 = (data[27]   << 8);
-  compensator->dig_h4 = (((data[28] << 4) | (data[29] & 0x0f)) & 0x0fff);
-  compensator->dig_h5 = (((data[30] << 4) | (data[29] & 0xf0)) & 0x0fff);
-  compensator->dig_h6 = data[31];
+  /* 0xe4...0xe6 hold two signed 12-bit values, 0xe5 is shared: [3:0] to H4, [7:4] to H5. */
+  compensator->dig_h1 = data[25];
+  compensator->dig_h2 = (int16_t)((data[27] << 8) | data[26]);
+  compensator->dig_h3 = data[28];
+  compensator->dig_h4 = (int16_t)((((int8_t)data[29]) * 16) | (data[30] & 0x0f));
+  compensator->dig_h5 = (int16_t)((((int8_t)data[31]) * 16) | (data[30] >> 4));
+  compensator->dig_h6 = (int8_t)data[32];
 
   return BME280_RESULT_SUCCESS;
 }
 
-bme280_result_t bme280_compensate_humidity(bme280_compensator_t *compensator, 
-                                           bme280_humidity_t *humidity) 
+bme280_result_t bme280_get_compensation_data(bme280_dev_t *dev) 
 {
-  if ((!compensator) || (!humidity)) {
+  if (!dev) {
     return BME280_RESULT_ERROR;
   }
 
-  int32_t adc_h = (((humidity->msb) << 8 ) | humidity->lsb);
-  double var_h;
-
-  var_h = (((double)t_fine) - 76800.0);
-  var_h = (adc_h - (((double)compensator->dig_h4) * 64.0 + ((double)compensator->dig_h5) / 16384.0 * var_h)) * 
-          (((double)compensator->dig_h2) / 65536.0 * (1.0 + ((double)compensator->dig_h6) / 67108864.0 * var_h * 
-          (1.0 + ((double)compensator->dig_h3) / 67108864.0 * var_h)));
-  var_h = var_h * (1.0 - ((double)compensator->dig_h1) * var_h / 524288.0);
-
-  if (var_h > 100.0) {
-    var_h = 100.0;
-  } 
-  else if (var_h < 0.0) {
-    var_h = 0.0;
-  }
-
-  humidity->compensated = var_h;
-
-  return BME280_RESULT_SUCCESS;
-}
+  uint8_t data[BME280_SIZE_COMP];
 
-bme280_result_t bme280_compensate_temperature(bme280_compensator_t *compensator, 
-                                              bme280_temperature_t *temperature) {
-  if ((!compensator) || (!temperature)) {
+  if (bme280_read_calibration(dev, data, sizeof(data)) != BME280_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
   }
 
-  int32_t adc_t = (((temperature->msb) << 12) | ((temperature->lsb) << 4) | ((temperature->xlsb) >> 4));
-  double var_1, var_2;
-
-  var_1 = (((double)adc_t) / 16384.0 - ((double)compensator->dig_t1) / 1024.0) * ((double)compensator->dig_t2);
-  var_2 = ((((double)adc_t) / 131072.0 - ((double)compensator->dig_t1) / 8192.0) * 
-          (((double)adc_t) / 131072.0 - ((double)compensator->dig_t1) / 8192.0)) * ((double)compensator->dig_t3);
-
-  t_fine = (int32_t)(var_1 + var_2);
-  temperature->compensated = (var_1 + var_2) / 5120.0;
-
-  return BME280_RESULT_SUCCESS;
+  return bme280_parse_calibration(data, sizeof(data), &dev->compensator);
 }
 
-bme280_result_t bme280_compensate_pressure(bme280_compensator_t *compensator, 
-                                           bme280_pressure_t *pressure) {
-  if ((!compensator) || (!pressure)) {
+bme280_result_t bme280_compensate(bme280_dev_t *dev, bme280_measurements_t *measurements)
+{
+  if ((!dev) || (!measurements)) {
     return BME280_RESULT_ERROR;
   }
 
-  int32_t adc_p = (((pressure->msb) << 12) | ((pressure->lsb) << 4) | ((pressure->xlsb) >> 4));
-  double var_1, var_2;
+  bme280_compensate_temperature(dev, &measurements->temperature);
 
-  var_1 = ((double)t_fine / 2.0) - 64000.0;
-  var_2 = var_1 * var_1 * ((double)compensator->dig_p6) / 32768.0;
-  var_2 = var_2 + var_1 * ((double)compensator->dig_p5) * 2.0;
-  var_2 = (var_2 / 4.0) + (((double)compensator->dig_p4) * 65536.0);
-  var_1 = (((double)compensator->dig_p3) * var_1 * var_1 / 524288.0 + ((double)compensator->dig_p2) * var_1) / 524288.0;
-  var_1 = (1.0 + var_1 / 32768.0) * ((double)compensator->dig_p1);
-
-  if (var_1 == 0) {
+  if (bme280_compensate_pressure(dev, &measurements->pressure) != BME280_RESULT_SUCCESS) {
     return BME280_RESULT_ERROR;
   }
 
-  pressure->compensated = 1048576.0 - (double)adc_p;
-  pressure->compensated = (pressure->compensated - (var_2 / 4096.0)) * 6250.0 / var_1;
-
-  var_1 = ((double)compensator->dig_p9) * pressure->compensated * pressure->compensated / 2147483648.0;
-  var_2 = pressure->compensated * ((double)compensator->dig_p8) / 32768.0;
-
-  pressure->compensated = pressure->compensated + (var_1 + var_2 + ((double)compensator->dig_p7)) / 16.0;
+  bme280_compensate_humidity(dev, &measurements->humidity);
 
   return BME280_RESULT_SUCCESS;
 }
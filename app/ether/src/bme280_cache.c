@@ -0,0 +1,196 @@
+#include "bme280_cache.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+
+/* Survives deep sleep, lost on a power cycle. */
+static RTC_DATA_ATTR bme280_cache_entry_t bme280_cache_rtc[BME280_CACHE_ENTRIES];
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+static uint32_t bme280_cache_crc(const uint8_t *raw, size_t raw_len)
+{
+  return esp_rom_crc32_le(0, raw, raw_len);
+}
+
+static bool bme280_cache_match(const bme280_cache_entry_t *entry, const bme280_dev_t *dev,
+                               uint8_t chip_id)
+{
+  return ((entry->magic == BME280_CACHE_MAGIC) &&
+          (entry->chip_id == chip_id) &&
+          (entry->address == dev->device.address) &&
+          (entry->i2c_num == dev->device.i2c_num) &&
+          (entry->raw_crc == bme280_cache_crc(entry->raw, sizeof(entry->raw))));
+}
+
+static bme280_cache_entry_t *bme280_cache_slot(const bme280_dev_t *dev)
+{
+  bme280_cache_entry_t *free_slot = NULL;
+
+  for (size_t i = 0; i < BME280_CACHE_ENTRIES; ++i) {
+    bme280_cache_entry_t *entry = &bme280_cache_rtc[i];
+
+    if ((entry->magic == BME280_CACHE_MAGIC) &&
+        (entry->address == dev->device.address) &&
+        (entry->i2c_num == dev->device.i2c_num)) {
+      return entry;
+    }
+
+    if ((!free_slot) && (entry->magic != BME280_CACHE_MAGIC)) {
+      free_slot = entry;
+    }
+  }
+
+  /* All slots taken by other sensors, the first one gets evicted. */
+  return (free_slot) ? free_slot : &bme280_cache_rtc[0];
+}
+
+static void bme280_cache_key(const bme280_dev_t *dev, char *key, size_t key_len)
+{
+  snprintf(key, key_len, "calib_%u_%02x", (unsigned)dev->device.i2c_num, dev->device.address);
+}
+
+static bme280_cache_result_t bme280_cache_nvs_read(const bme280_dev_t *dev,
+                                                   bme280_cache_entry_t *entry)
+{
+  nvs_handle_t handle;
+  char key[NVS_KEY_NAME_MAX_SIZE];
+  size_t length = sizeof(*entry);
+  esp_err_t result;
+
+  if (nvs_open(BME280_CACHE_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+    return BME280_CACHE_RESULT_ERROR;
+  }
+
+  bme280_cache_key(dev, key, sizeof(key));
+  result = nvs_get_blob(handle, key, entry, &length);
+  nvs_close(handle);
+
+  if ((result != ESP_OK) || (length != sizeof(*entry))) {
+    return BME280_CACHE_RESULT_ERROR;
+  }
+
+  return BME280_CACHE_RESULT_SUCCESS;
+}
+
+static bme280_cache_result_t bme280_cache_nvs_write(const bme280_dev_t *dev,
+                                                    const bme280_cache_entry_t *entry)
+{
+  static const char *BME280_CACHE_NVS_WRITE_TAG = "BME280_CACHE_NVS_WRITE";
+  nvs_handle_t handle;
+  char key[NVS_KEY_NAME_MAX_SIZE];
+  esp_err_t result;
+
+  result = nvs_open(BME280_CACHE_NVS_NAMESPACE, NVS_READWRITE, &handle);
+
+  if (result != ESP_OK) {
+    ESP_LOGI(BME280_CACHE_NVS_WRITE_TAG, "nvs_open result = 0x%x", result);
+    return BME280_CACHE_RESULT_ERROR;
+  }
+
+  bme280_cache_key(dev, key, sizeof(key));
+  result = nvs_set_blob(handle, key, entry, sizeof(*entry));
+
+  if (result == ESP_OK) {
+    result = nvs_commit(handle);
+  }
+
+  nvs_close(handle);
+
+  if (result != ESP_OK) {
+    ESP_LOGI(BME280_CACHE_NVS_WRITE_TAG, "nvs_set_blob result = 0x%x", result);
+    return BME280_CACHE_RESULT_ERROR;
+  }
+
+  return BME280_CACHE_RESULT_SUCCESS;
+}
+
+/*
+ * The key and the CRC only say the blob came from a sensor at that address,
+ * the one there now may be another. dig_T of two parts is very unlikely to
+ * be the same, so one short burst tells them apart.
+ */
+static bme280_cache_result_t bme280_cache_verify(const bme280_dev_t *dev,
+                                                 const bme280_cache_entry_t *entry)
+{
+  uint8_t data[BME280_CACHE_VERIFY_SIZE];
+
+  if (i2c_controller_device_receive(&dev->device, BME280_REGISTER_CALIB00, data,
+                                    sizeof(data)) != I2C_CONTROLLER_RESULT_SUCCESS) {
+    return BME280_CACHE_RESULT_ERROR;
+  }
+
+  if (memcmp(data, entry->raw, sizeof(data)) != 0) {
+    return BME280_CACHE_RESULT_ERROR;
+  }
+
+  return BME280_CACHE_RESULT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+bme280_cache_result_t bme280_cache_load(bme280_dev_t *dev, uint8_t chip_id)
+{
+  if (!dev) {
+    return BME280_CACHE_RESULT_ERROR;
+  }
+
+  bme280_cache_entry_t *slot = bme280_cache_slot(dev);
+
+  if (!bme280_cache_match(slot, dev, chip_id)) {
+    bme280_cache_entry_t entry;
+
+    /* Power cycle, the sensor may have been replaced while the device was off. */
+    if ((bme280_cache_nvs_read(dev, &entry) != BME280_CACHE_RESULT_SUCCESS) ||
+        (!bme280_cache_match(&entry, dev, chip_id)) ||
+        (bme280_cache_verify(dev, &entry) != BME280_CACHE_RESULT_SUCCESS)) {
+      return BME280_CACHE_RESULT_ERROR;
+    }
+
+    /* The next wake from deep sleep does not need the flash nor the bus. */
+    *slot = entry;
+  }
+
+  if (bme280_parse_calibration(slot->raw, sizeof(slot->raw), &dev->compensator) != BME280_RESULT_SUCCESS) {
+    return BME280_CACHE_RESULT_ERROR;
+  }
+
+  return BME280_CACHE_RESULT_SUCCESS;
+}
+
+bme280_cache_result_t bme280_cache_store(const bme280_dev_t *dev, uint8_t chip_id,
+                                         const uint8_t *raw, size_t raw_len)
+{
+  if ((!dev) || (!raw) || (raw_len != BME280_SIZE_COMP)) {
+    return BME280_CACHE_RESULT_ERROR;
+  }
+
+  bme280_cache_entry_t entry;
+  bme280_cache_entry_t stored;
+
+  /* Zeroed padding keeps the blob comparable byte by byte. */
+  memset(&entry, 0, sizeof(entry));
+  entry.magic = BME280_CACHE_MAGIC;
+  entry.chip_id = chip_id;
+  entry.address = dev->device.address;
+  entry.i2c_num = (uint8_t)dev->device.i2c_num;
+  entry.raw_crc = bme280_cache_crc(raw, raw_len);
+  memcpy(entry.raw, raw, raw_len);
+  *bme280_cache_slot(dev) = entry;
+
+  /* The calibration is fixed in the factory, the flash sees one write per sensor. */
+  if ((bme280_cache_nvs_read(dev, &stored) == BME280_CACHE_RESULT_SUCCESS) &&
+      (memcmp(&stored, &entry, sizeof(entry)) == 0)) {
+    return BME280_CACHE_RESULT_SUCCESS;
+  }
+
+  return bme280_cache_nvs_write(dev, &entry);
+}
@@ -0,0 +1,246 @@
+#include "bme280_capture.h"
+#include <math.h>
+#include <string.h>
+#include "esp_log.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+static void bme280_capture_timer(void *arg)
+{
+  bme280_capture_t *capture = arg;
+
+  xTaskNotifyGive(capture->task);
+}
+
+static void bme280_capture_task(void *arg)
+{
+  bme280_capture_t *capture = arg;
+  bme280_capture_sample_t sample;
+
+  while (1) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    if (!atomic_load_explicit(&capture->running, memory_order_acquire)) {
+      break;
+    }
+
+    if (bme280_capture_read(capture->dev, &sample) != BME280_CAPTURE_RESULT_SUCCESS) {
+      atomic_fetch_add_explicit(&capture->errors, 1, memory_order_relaxed);
+      continue;
+    }
+
+    /* Never waits on the consumer, a full ring costs the sample and nothing else. */
+    bme280_capture_push(&capture->ring, &sample);
+  }
+
+  capture->task = NULL;
+  vTaskDelete(NULL);
+}
+
+static void bme280_capture_open(bme280_capture_detector_t *detector, uint32_t timestamp_us)
+{
+  memset(&detector->window, 0, sizeof(detector->window));
+  detector->window.start_us = timestamp_us;
+  detector->window.peak_us = timestamp_us;
+  detector->window.baseline = detector->baseline;
+  detector->sum = 0.0;
+  detector->peak = 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+bool bme280_capture_push(bme280_capture_ring_t *ring, const bme280_capture_sample_t *sample)
+{
+  uint_fast32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint_fast32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+  if ((uint32_t)(head - tail) >= BME280_CAPTURE_SIZE) {
+    atomic_fetch_add_explicit(&ring->overruns, 1, memory_order_relaxed);
+    return false;
+  }
+
+  ring->samples[head & (BME280_CAPTURE_SIZE - 1)] = *sample;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+  return true;
+}
+
+bool bme280_capture_pop(bme280_capture_ring_t *ring, bme280_capture_sample_t *sample)
+{
+  uint_fast32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint_fast32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+  if (head == tail) {
+    return false;
+  }
+
+  *sample = ring->samples[tail & (BME280_CAPTURE_SIZE - 1)];
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+  return true;
+}
+
+bme280_capture_result_t bme280_capture_read(bme280_dev_t *dev, bme280_capture_sample_t *sample)
+{
+  if ((!dev) || (!sample)) {
+    return BME280_CAPTURE_RESULT_ERROR;
+  }
+
+  uint8_t data[6];
+
+  /* Humidity is skipped in capture mode, its two registers are not read. */
+  if (i2c_controller_device_receive(&dev->device, BME280_REGISTER_PRESS_MSB, data,
+                                    sizeof(data)) != I2C_CONTROLLER_RESULT_SUCCESS) {
+    return BME280_CAPTURE_RESULT_ERROR;
+  }
+
+  sample->timestamp_us = (uint32_t)esp_timer_get_time();
+  memcpy(sample->pressure, &data[0], sizeof(sample->pressure));
+  memcpy(sample->temperature, &data[3], sizeof(sample->temperature));
+
+  return BME280_CAPTURE_RESULT_SUCCESS;
+}
+
+bme280_capture_result_t bme280_capture_start(bme280_capture_t *capture, bme280_dev_t *dev)
+{
+  static const char *BME280_CAPTURE_START_TAG = "BME280_CAPTURE_START";
+
+  if ((!capture) || (!dev)) {
+    return BME280_CAPTURE_RESULT_ERROR;
+  }
+
+  esp_err_t result;
+  /* One read per conversion, the sensor has nothing new to say in between. */
+  uint64_t period_us = bme280_measurement_time_us(&dev->settings, true) +
+                       bme280_standby_time_us(&dev->settings);
+  const esp_timer_create_args_t timer_args = {
+    .callback = bme280_capture_timer,
+    .arg = capture,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "bme280_capture",
+  };
+
+  capture->dev = dev;
+  atomic_init(&capture->ring.head, 0);
+  atomic_init(&capture->ring.tail, 0);
+  atomic_init(&capture->ring.overruns, 0);
+  atomic_init(&capture->errors, 0);
+  atomic_init(&capture->running, true);
+
+  if (xTaskCreate(bme280_capture_task, "bme280_capture", BME280_CAPTURE_TASK_STACK_SIZE,
+                  capture, BME280_CAPTURE_TASK_PRIORITY, &capture->task) != pdPASS) {
+    ESP_LOGI(BME280_CAPTURE_START_TAG, "xTaskCreate failed");
+    return BME280_CAPTURE_RESULT_ERROR;
+  }
+
+  result = esp_timer_create(&timer_args, &capture->timer);
+
+  if (result == ESP_OK) {
+    result = esp_timer_start_periodic(capture->timer, period_us);
+  }
+
+  if (result != ESP_OK) {
+    ESP_LOGI(BME280_CAPTURE_START_TAG, "esp_timer result = 0x%x", result);
+    bme280_capture_stop(capture);
+    return BME280_CAPTURE_RESULT_ERROR;
+  }
+
+  return BME280_CAPTURE_RESULT_SUCCESS;
+}
+
+bme280_capture_result_t bme280_capture_stop(bme280_capture_t *capture)
+{
+  if (!capture) {
+    return BME280_CAPTURE_RESULT_ERROR;
+  }
+
+  if (capture->timer) {
+    esp_timer_stop(capture->timer);
+    esp_timer_delete(capture->timer);
+    capture->timer = NULL;
+  }
+
+  /* The task leaves on its own, never in the middle of a bus transaction. */
+  atomic_store_explicit(&capture->running, false, memory_order_release);
+
+  if (capture->task) {
+    xTaskNotifyGive(capture->task);
+  }
+
+  return BME280_CAPTURE_RESULT_SUCCESS;
+}
+
+bool bme280_capture_process(bme280_capture_detector_t *detector, bme280_capture_t *capture,
+                            const bme280_capture_sample_t *sample, bme280_capture_summary_t *summary)
+{
+  if ((!detector) || (!capture) || (!sample) || (!summary)) {
+    return false;
+  }
+
+  bool closed = false;
+  bme280_measurements_t measurements = {
+    .pressure = { .msb = sample->pressure[0], .lsb = sample->pressure[1],
+                  .xlsb = sample->pressure[2] & 0xf0 },
+    .temperature = { .msb = sample->temperature[0], .lsb = sample->temperature[1],
+                     .xlsb = sample->temperature[2] & 0xf0 },
+    .humidity = { .msb = 0x80, .lsb = 0x00 },
+  };
+
+  if (bme280_compensate(capture->dev, &measurements) != BME280_RESULT_SUCCESS) {
+    return false;
+  }
+
+  double pressure = BME280_PRESSURE_PASCALS(measurements.pressure.compensated);
+
+  if (detector->window.count == 0) {
+    /* The very first sample seeds the baseline. */
+    if (detector->baseline == 0.0) {
+      detector->baseline = pressure;
+    }
+
+    bme280_capture_open(detector, sample->timestamp_us);
+    detector->window.min = pressure;
+    detector->window.max = pressure;
+  }
+
+  /* Unsigned difference, correct across the timestamp wrap. */
+  if ((uint32_t)(sample->timestamp_us - detector->window.start_us) >= BME280_CAPTURE_WINDOW_US) {
+    uint32_t overruns = atomic_load_explicit(&capture->ring.overruns, memory_order_relaxed);
+
+    *summary = detector->window;
+    summary->mean = detector->sum / summary->count;
+    summary->overruns = overruns - detector->overruns;
+    detector->overruns = overruns;
+
+    /* A step change becomes the new baseline after a few dozen windows. */
+    detector->baseline += BME280_CAPTURE_BASELINE_WEIGHT * (summary->mean - detector->baseline);
+
+    bme280_capture_open(detector, sample->timestamp_us);
+    detector->window.min = pressure;
+    detector->window.max = pressure;
+    closed = true;
+  }
+
+  double deviation = fabs(pressure - detector->baseline);
+
+  detector->window.count++;
+  detector->sum += pressure;
+  detector->window.min = (pressure < detector->window.min) ? pressure : detector->window.min;
+  detector->window.max = (pressure > detector->window.max) ? pressure : detector->window.max;
+  bme280_sample_pack(&measurements, (uint32_t)(esp_timer_get_time() / 1000), &detector->window.latest);
+
+  if (deviation > detector->peak) {
+    detector->peak = deviation;
+    detector->window.peak_us = sample->timestamp_us;
+  }
+
+  if (deviation > BME280_CAPTURE_THRESHOLD_PA) {
+    detector->window.triggered = true;
+  }
+
+  return closed;
+}
@@ -0,0 +1,121 @@
+#include "bme280_profile.h"
+#include <math.h>
+
+/** 
+ * \brief Structure for the register values and noise reduction of a profile.
+ */
+typedef struct {
+  uint8_t osrs_h;         /*!< CTRL_HUM oversampling bits. */
+  uint8_t osrs_tp;        /*!< CTRL_MEAS temperature and pressure oversampling bits. */
+  uint8_t filter;         /*!< CONFIG filter bits. */
+  float attenuation;      /*!< Noise left, 1 / sqrt(osrs_p) * sqrt(1 / (2 * c - 1)) for IIR coefficient c. */
+} bme280_profile_entry_t;
+
+static const bme280_profile_entry_t bme280_profiles[BME280_PROFILE_COUNT] = {
+  [BME280_PROFILE_LOW] = {
+    .osrs_h = BME280_SETTINGS_OSRS_H_1,
+    .osrs_tp = (BME280_SETTINGS_OSRS_T_1 | BME280_SETTINGS_OSRS_P_1),
+    .filter = BME280_SETTINGS_FILTER_OFF,
+    .attenuation = 1.0f,
+  },
+  [BME280_PROFILE_STANDARD] = {
+    .osrs_h = BME280_SETTINGS_OSRS_H_1,
+    .osrs_tp = (BME280_SETTINGS_OSRS_T_2 | BME280_SETTINGS_OSRS_P_4),
+    .filter = BME280_SETTINGS_FILTER_4,
+    .attenuation = 0.189f,
+  },
+  [BME280_PROFILE_HIGH] = {
+    .osrs_h = BME280_SETTINGS_OSRS_H_1,
+    .osrs_tp = (BME280_SETTINGS_OSRS_T_2 | BME280_SETTINGS_OSRS_P_16),
+    .filter = BME280_SETTINGS_FILTER_4,
+    .attenuation = 0.094f,
+  },
+  [BME280_PROFILE_ULTRA] = {
+    .osrs_h = BME280_SETTINGS_OSRS_H_1,
+    .osrs_tp = (BME280_SETTINGS_OSRS_T_2 | BME280_SETTINGS_OSRS_P_16),
+    .filter = BME280_SETTINGS_FILTER_16,
+    .attenuation = 0.045f,
+  },
+};
+
+#define BME280_PROFILE_OSRS_TP_MASK   (0xfc)
+#define BME280_PROFILE_FILTER_MASK    (0x1c)
+
+bme280_result_t bme280_profile_apply(bme280_dev_t *dev, bme280_profile_level_t level)
+{
+  if ((!dev) || (level >= BME280_PROFILE_COUNT)) {
+    return BME280_RESULT_ERROR;
+  }
+
+  const bme280_profile_entry_t *entry = &bme280_profiles[level];
+  bme280_settings_t *settings = &dev->settings;
+
+  settings->ctrl_hum = entry->osrs_h;
+  settings->ctrl_meas = (uint8_t)((settings->ctrl_meas & ~BME280_PROFILE_OSRS_TP_MASK) | entry->osrs_tp);
+  settings->config = (uint8_t)((settings->config & ~BME280_PROFILE_FILTER_MASK) | entry->filter);
+
+  return BME280_RESULT_SUCCESS;
+}
+
+bool bme280_profile_update(bme280_profile_t *profile, bme280_dev_t *dev,
+                           const bme280_measurements_t *measurements)
+{
+  if ((!profile) || (!dev) || (!measurements)) {
+    return false;
+  }
+
+  profile->pressure[profile->count++] = BME280_PRESSURE_PASCALS(measurements->pressure.compensated);
+
+  if (profile->count < BME280_PROFILE_WINDOW) {
+    return false;
+  }
+
+  float sum = 0.0f;
+  float square = 0.0f;
+  float attenuation = bme280_profiles[profile->level].attenuation;
+
+  for (uint8_t i = 1; i < BME280_PROFILE_WINDOW; ++i) {
+    float difference = profile->pressure[i] - profile->pressure[i - 1];
+
+    sum += difference;
+    square += difference * difference;
+  }
+
+  /* Var(x[i] - x[i-1]) = 2 * var(x) for uncorrelated noise; the mean difference is the trend. */
+  float rate = sum / (BME280_PROFILE_WINDOW - 1);
+  float variance = (square / (BME280_PROFILE_WINDOW - 1)) - (rate * rate);
+
+  /* Back to the noise before the current profile, so windows of different profiles average. */
+  variance = ((variance > 0.0f) ? variance : 0.0f) / (2.0f * attenuation * attenuation);
+  profile->variance = (profile->variance == 0.0f) ? variance : 
+                      (profile->variance + (BME280_PROFILE_SMOOTHING * (variance - profile->variance)));
+  profile->count = 0;
+
+  float noise = sqrtf(profile->variance);
+  bme280_profile_level_t highest = (fabsf(rate) > BME280_PROFILE_RATE_FAST_PA) ?
+                                   BME280_PROFILE_HIGH : BME280_PROFILE_ULTRA;
+  bme280_profile_level_t level = highest;
+
+  for (bme280_profile_level_t i = BME280_PROFILE_LOW; i < highest; ++i) {
+    float target = (i < profile->level) ? (BME280_PROFILE_NOISE_TARGET_PA / 2.0f) :
+                                          BME280_PROFILE_NOISE_TARGET_PA;
+
+    if ((noise * bme280_profiles[i].attenuation) <= target) {
+      level = i;
+      break;
+    }
+  }
+
+  if (level == profile->level) {
+    return false;
+  }
+
+  if (bme280_profile_apply(dev, level) != BME280_RESULT_SUCCESS) {
+    return false;
+  }
+
+  profile->level = level;
+  profile->changes++;
+
+  return true;
+}
@@ -0,0 +1,253 @@
+#include "bme280_selftest.h"
+
+#if defined(BME280_SELFTEST)
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bme280.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+
+#if defined(BME280_COMPENSATION_INTEGER)
+#define BME280_SELFTEST_COMPENSATION  "integer"
+#define BME280_SELFTEST_T_FINE_DELTA        (0)
+#elif defined(BME280_COMPENSATION_FLOAT)
+#define BME280_SELFTEST_COMPENSATION  "float"
+#define BME280_SELFTEST_T_FINE_DELTA        (1)         /*!< t_fine is truncated from a single precision sum. */
+#define BME280_SELFTEST_TEMPERATURE_DELTA   (0.0001)    /*!< Tolerated temperature error in degC. */
+#define BME280_SELFTEST_PRESSURE_DELTA      (0.05)      /*!< Tolerated pressure error in Pa, the float step at 1e5 is 0.008. */
+#define BME280_SELFTEST_HUMIDITY_DELTA      (0.0001)    /*!< Tolerated humidity error in %RH. */
+#else
+#define BME280_SELFTEST_COMPENSATION  "double"
+#define BME280_SELFTEST_T_FINE_DELTA        (0)
+#define BME280_SELFTEST_TEMPERATURE_DELTA   (0.00001)
+#define BME280_SELFTEST_PRESSURE_DELTA      (0.001)
+#define BME280_SELFTEST_HUMIDITY_DELTA      (0.00001)
+#endif
+
+/** 
+ * \brief Structure for a calibration reference: the raw block and what it parses to.
+ */
+typedef struct {
+  uint8_t raw[BME280_SIZE_COMP];      /*!< 0x88...0xa1 and 0xe1...0xe7 as read from the sensor. */
+  bme280_compensator_t compensator;   /*!< Datasheet trimming parameters. */
+} bme280_selftest_calibration_t;
+
+/** 
+ * \brief Structure for a compensation reference.
+ */
+typedef struct {
+  uint8_t calibration;      /*!< Index into bme280_selftest_calibrations. */
+  int32_t adc_t;            /*!< Raw temperature. */
+  int32_t adc_p;            /*!< Raw pressure. */
+  int32_t adc_h;            /*!< Raw humidity. */
+  int32_t t_fine;           /*!< Expected t_fine. */
+  int32_t temperature;      /*!< Expected integer temperature, 0.01 degC. */
+  uint32_t pressure;        /*!< Expected integer pressure, Q24.8. */
+  uint32_t humidity;        /*!< Expected integer humidity, Q22.10. */
+  double temperature_d;     /*!< Expected double temperature, degC. */
+  double pressure_d;        /*!< Expected double pressure, Pa. */
+  double humidity_d;        /*!< Expected double humidity, %RH. */
+} bme280_selftest_vector_t;
+
+/*
+ * The first set is the datasheet example (T and P trimming, adc_T = 519888,
+ * adc_P = 415148 give 25.08 degC and 100653.27 Pa); the second one has a
+ * negative dig_H5, which the shared 0xe5 nibbles have to sign extend.
+ */
+static const bme280_selftest_calibration_t bme280_selftest_calibrations[] = {
+  {
+    .raw = {
+      0x70, 0x6b, 0x43, 0x67, 0x18, 0xfc, 0x7d, 0x8e, 0x43, 0xd6, 0xd0, 0x0b, 0x27, 0x0b, 0x8c, 0x00,
+      0xf9, 0xff, 0x8c, 0x3c, 0xf8, 0xc6, 0x70, 0x17, 0x00, 0x4b, 0x6a, 0x01, 0x00, 0x13, 0x29, 0x03,
+      0x1e,
+    },
+    .compensator = {
+      .dig_t1 = 27504, .dig_t2 = 26435, .dig_t3 = -1000,
+      .dig_p1 = 36477, .dig_p2 = -10685, .dig_p3 = 3024, .dig_p4 = 2855, .dig_p5 = 140,
+      .dig_p6 = -7, .dig_p7 = 15500, .dig_p8 = -14600, .dig_p9 = 6000,
+      .dig_h1 = 75, .dig_h2 = 362, .dig_h3 = 0, .dig_h4 = 313, .dig_h5 = 50, .dig_h6 = 30,
+    },
+  },
+  {
+    .raw = {
+      0x45, 0x6f, 0x6f, 0x68, 0x32, 0x00, 0xd9, 0x94, 0x98, 0xd6, 0xd0, 0x0b, 0x32, 0x1f, 0x6e, 0xff,
+      0xf9, 0xff, 0xac, 0x26, 0x0a, 0xd8, 0xbd, 0x10, 0x00, 0x4b, 0x61, 0x01, 0x00, 0x15, 0xa4, 0xff,
+      0x1e,
+    },
+    .compensator = {
+      .dig_t1 = 28485, .dig_t2 = 26735, .dig_t3 = 50,
+      .dig_p1 = 38105, .dig_p2 = -10600, .dig_p3 = 3024, .dig_p4 = 7986, .dig_p5 = -146,
+      .dig_p6 = -7, .dig_p7 = 9900, .dig_p8 = -10230, .dig_p9 = 4285,
+      .dig_h1 = 75, .dig_h2 = 353, .dig_h3 = 0, .dig_h4 = 340, .dig_h5 = -6, .dig_h6 = 30,
+    },
+  },
+};
+
+/*
+ * Expected values from the datasheet formulas, section 4.2.3 and 8.1. The
+ * integer and double expectations of a vector are at most 0.0042 degC,
+ * 0.0042 Pa and 0.0036 %RH apart; a build runs only one path, so this is
+ * checked when the table changes, not at run time.
+ */
+static const bme280_selftest_vector_t bme280_selftest_vectors[] = {
+  {
+    .calibration = 0, .adc_t = 519888, .adc_p = 415148, .adc_h = 30000, .t_fine = 128422,
+    .temperature = 2508, .pressure = 25767233, .humidity = 56317,
+    .temperature_d = 25.082478, .pressure_d = 100653.258145, .humidity_d = 55.000713,
+  },
+  {
+    .calibration = 1, .adc_t = 528432, .adc_p = 336880, .adc_h = 31100, .t_fine = 118599,
+    .temperature = 2316, .pressure = 24416296, .humidity = 52182,
+    .temperature_d = 23.164007, .pressure_d = 95376.160192, .humidity_d = 50.955625,
+  },
+  {
+    .calibration = 1, .adc_t = 480000, .adc_p = 380000, .adc_h = 24000, .t_fine = 39555,
+    .temperature = 773, .pressure = 22024404, .humidity = 12052,
+    .temperature_d = 7.725768, .pressure_d = 86032.831549, .humidity_d = 11.772406,
+  },
+};
+
+#define BME280_SELFTEST_CALIBRATIONS  (sizeof(bme280_selftest_calibrations) / sizeof(bme280_selftest_calibrations[0]))
+#define BME280_SELFTEST_VECTORS       (sizeof(bme280_selftest_vectors) / sizeof(bme280_selftest_vectors[0]))
+
+static const char *BME280_SELFTEST_TAG = "BME280_SELFTEST";
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+static void bme280_selftest_raw(const bme280_selftest_vector_t *vector, bme280_measurements_t *measurements)
+{
+  memset(measurements, 0, sizeof(*measurements));
+
+  measurements->temperature.msb   = (uint8_t)(vector->adc_t >> 12);
+  measurements->temperature.lsb   = (uint8_t)(vector->adc_t >> 4);
+  measurements->temperature.xlsb  = (uint8_t)(vector->adc_t << 4);
+
+  measurements->pressure.msb      = (uint8_t)(vector->adc_p >> 12);
+  measurements->pressure.lsb      = (uint8_t)(vector->adc_p >> 4);
+  measurements->pressure.xlsb     = (uint8_t)(vector->adc_p << 4);
+
+  measurements->humidity.msb      = (uint8_t)(vector->adc_h >> 8);
+  measurements->humidity.lsb      = (uint8_t)(vector->adc_h);
+}
+
+static void bme280_selftest_check(bme280_selftest_report_t *report, const char *name, uint32_t index,
+                                  bool passed, double value, double expected)
+{
+  report->checks++;
+
+  if (!passed) {
+    report->failures++;
+    ESP_LOGI(BME280_SELFTEST_TAG, "%s[%lu] = %f, expected %f", name, (unsigned long)index, value, expected);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+bme280_selftest_result_t bme280_selftest_run(bme280_selftest_report_t *report)
+{
+  if (!report) {
+    return BME280_SELFTEST_RESULT_ERROR;
+  }
+
+  bme280_dev_t dev = BME280_DEV_DEFAULT;
+  bme280_measurements_t measurements;
+
+  memset(report, 0, sizeof(*report));
+
+  for (uint32_t i = 0; i < BME280_SELFTEST_CALIBRATIONS; ++i) {
+    const bme280_selftest_calibration_t *calibration = &bme280_selftest_calibrations[i];
+    bme280_compensator_t compensator;
+
+    memset(&compensator, 0, sizeof(compensator));
+    bme280_parse_calibration(calibration->raw, sizeof(calibration->raw), &compensator);
+
+    /* Field by field, the padding of the structure is not compared. */
+    bme280_selftest_check(report, "dig_t", i, (compensator.dig_t1 == calibration->compensator.dig_t1) &&
+                          (compensator.dig_t2 == calibration->compensator.dig_t2) &&
+                          (compensator.dig_t3 == calibration->compensator.dig_t3), 0, 0);
+    bme280_selftest_check(report, "dig_p", i, (compensator.dig_p1 == calibration->compensator.dig_p1) &&
+                          (compensator.dig_p2 == calibration->compensator.dig_p2) &&
+                          (compensator.dig_p3 == calibration->compensator.dig_p3) &&
+                          (compensator.dig_p4 == calibration->compensator.dig_p4) &&
+                          (compensator.dig_p5 == calibration->compensator.dig_p5) &&
+                          (compensator.dig_p6 == calibration->compensator.dig_p6) &&
+                          (compensator.dig_p7 == calibration->compensator.dig_p7) &&
+                          (compensator.dig_p8 == calibration->compensator.dig_p8) &&
+                          (compensator.dig_p9 == calibration->compensator.dig_p9), 0, 0);
+    bme280_selftest_check(report, "dig_h1", i, compensator.dig_h1 == calibration->compensator.dig_h1,
+                          compensator.dig_h1, calibration->compensator.dig_h1);
+    bme280_selftest_check(report, "dig_h2", i, compensator.dig_h2 == calibration->compensator.dig_h2,
+                          compensator.dig_h2, calibration->compensator.dig_h2);
+    bme280_selftest_check(report, "dig_h3", i, compensator.dig_h3 == calibration->compensator.dig_h3,
+                          compensator.dig_h3, calibration->compensator.dig_h3);
+    bme280_selftest_check(report, "dig_h4", i, compensator.dig_h4 == calibration->compensator.dig_h4,
+                          compensator.dig_h4, calibration->compensator.dig_h4);
+    bme280_selftest_check(report, "dig_h5", i, compensator.dig_h5 == calibration->compensator.dig_h5,
+                          compensator.dig_h5, calibration->compensator.dig_h5);
+    bme280_selftest_check(report, "dig_h6", i, compensator.dig_h6 == calibration->compensator.dig_h6,
+                          compensator.dig_h6, calibration->compensator.dig_h6);
+  }
+
+  for (uint32_t i = 0; i < BME280_SELFTEST_VECTORS; ++i) {
+    const bme280_selftest_vector_t *vector = &bme280_selftest_vectors[i];
+
+    dev.compensator = bme280_selftest_calibrations[vector->calibration].compensator;
+    bme280_selftest_raw(vector, &measurements);
+    bme280_compensate(&dev, &measurements);
+
+    bme280_selftest_check(report, "t_fine", i, abs(dev.t_fine - vector->t_fine) <= BME280_SELFTEST_T_FINE_DELTA,
+                          dev.t_fine, vector->t_fine);
+
+#if defined(BME280_COMPENSATION_INTEGER)
+    bme280_selftest_check(report, "temperature", i, measurements.temperature.compensated == vector->temperature,
+                          measurements.temperature.compensated, vector->temperature);
+    bme280_selftest_check(report, "pressure", i, measurements.pressure.compensated == vector->pressure,
+                          measurements.pressure.compensated, vector->pressure);
+    bme280_selftest_check(report, "humidity", i, measurements.humidity.compensated == vector->humidity,
+                          measurements.humidity.compensated, vector->humidity);
+#else
+    bme280_selftest_check(report, "temperature", i, 
+                          fabs(measurements.temperature.compensated - vector->temperature_d) < BME280_SELFTEST_TEMPERATURE_DELTA,
+                          measurements.temperature.compensated, vector->temperature_d);
+    bme280_selftest_check(report, "pressure", i, 
+                          fabs(measurements.pressure.compensated - vector->pressure_d) < BME280_SELFTEST_PRESSURE_DELTA,
+                          measurements.pressure.compensated, vector->pressure_d);
+    bme280_selftest_check(report, "humidity", i, 
+                          fabs(measurements.humidity.compensated - vector->humidity_d) < BME280_SELFTEST_HUMIDITY_DELTA,
+                          measurements.humidity.compensated, vector->humidity_d);
+#endif
+  }
+
+  uint64_t total = 0;
+
+  report->cycles_min = UINT32_MAX;
+  dev.compensator = bme280_selftest_calibrations[0].compensator;
+  bme280_selftest_raw(&bme280_selftest_vectors[0], &measurements);
+
+  for (uint32_t i = 0; i < BME280_SELFTEST_ITERATIONS; ++i) {
+    uint32_t start = esp_cpu_get_cycle_count();
+
+    bme280_compensate(&dev, &measurements);
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+
+    total += cycles;
+    report->cycles_min = (cycles < report->cycles_min) ? cycles : report->cycles_min;
+  }
+
+  report->cycles_mean = (uint32_t)(total / BME280_SELFTEST_ITERATIONS);
+
+  ESP_LOGI(BME280_SELFTEST_TAG, "%s: %lu checks, %lu failures, compensation %lu cycles (min %lu)",
+           BME280_SELFTEST_COMPENSATION, (unsigned long)report->checks, (unsigned long)report->failures,
+           (unsigned long)report->cycles_mean, (unsigned long)report->cycles_min);
+
+  return (report->failures == 0) ? BME280_SELFTEST_RESULT_SUCCESS : BME280_SELFTEST_RESULT_ERROR;
+}
+
+#endif
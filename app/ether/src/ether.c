@@ -16,9 +16,9 @@ ether_result_t ether_init(ether_t *ether)
    *
    * MADE FOR FUN.
    */
-  ether->measurements.pms7003.pm1  = 0;
-  ether->measurements.pms7003.pm25 = 0;
-  ether->measurements.pms7003.pm10 = 0;
+  for (uint8_t i = 0; i < PMS7003_DATA_WORDS; ++i) {
+    ether->measurements.pms7003.data[i] = 0;
+  }
 
   ether->measurements.bme280.humidity.msb = 0;
   ether->measurements.bme280.humidity.lsb = 0;
@@ -34,31 +34,27 @@ ether_result_t ether_init(ether_t *ether)
   ether->measurements.bme280.temperature.xlsb = 0;
   ether->measurements.bme280.temperature.compensated = 0;
 
-  ether->measurements.bme280.compensator.dig_t1 = 0;
-  ether->measurements.bme280.compensator.dig_t2 = 0;
-  ether->measurements.bme280.compensator.dig_t3 = 0;
-  ether->measurements.bme280.compensator.dig_p1 = 0;
-  ether->measurements.bme280.compensator.dig_p2 = 0;
-  ether->measurements.bme280.compensator.dig_p3 = 0;
-  ether->measurements.bme280.compensator.dig_p4 = 0;
-  ether->measurements.bme280.compensator.dig_p5 = 0;
-  ether->measurements.bme280.compensator.dig_p6 = 0;
-  ether->measurements.bme280.compensator.dig_p7 = 0;
-  ether->measurements.bme280.compensator.dig_p8 = 0;
-  ether->measurements.bme280.compensator.dig_p9 = 0;
-  ether->measurements.bme280.compensator.dig_h1 = 0;
-  ether->measurements.bme280.compensator.dig_h2 = 0;
-  ether->measurements.bme280.compensator.dig_h3 = 0;
-  ether->measurements.bme280.compensator.dig_h4 = 0;
-  ether->measurements.bme280.compensator.dig_h5 = 0;
-  ether->measurements.bme280.compensator.dig_h6 = 0;
+  ether->measurements.psychrometrics.dew_point = 0;
+  ether->measurements.psychrometrics.absolute_humidity = 0;
+  ether->measurements.psychrometrics.heat_index = 0;
+  ether->measurements.psychrometrics.sea_level_pressure = 0;
 
   ether->descriptor.i2c_controller  = (i2c_controller_descriptor_t)I2C_CONTROLLER_DESCRIPTOR_DEFAULT;
+  ether->descriptor.bme280          = (bme280_dev_t)BME280_DEV_DEFAULT;
+  ether->descriptor.bme280_profile  = (bme280_profile_t)BME280_PROFILE_DEFAULT;
   ether->descriptor.mqtt_controller = (mqtt_controller_descriptor_t)MQTT_CONTROLLER_DESCRIPTOR_DEFAULT;
   ether->descriptor.uart_controller = (uart_controller_descriptor_t)UART_CONTROLLER_DESCRIPTOR_DEFAULT;
+  ether->descriptor.pms7003_receiver = (pms7003_receiver_t)PMS7003_RECEIVER_DEFAULT;
+  ether->descriptor.pms7003_scheduler = (pms7003_scheduler_t)PMS7003_SCHEDULER_DEFAULT;
+  ether->descriptor.pms7003_scheduler.period_ms = ETHER_PMS7003_PERIOD_S * 1000;
+  ether->descriptor.pms7003_scheduler.service_h = ETHER_PMS7003_SERVICE_H;
   ether->descriptor.wifi_controller = (wifi_controller_descriptor_t)WIFI_CONTROLLER_DESCRIPTOR_DEFAULT;
 
-  ether->settings.bme280 = (bme280_settings_t)BME280_SETTINGS_DEFAULT;
+#if defined(ETHER_CAPTURE)
+  ether->descriptor.bme280.settings = (bme280_settings_t)BME280_SETTINGS_CAPTURE;
+#else
+  ether->descriptor.bme280.settings = (bme280_settings_t)BME280_SETTINGS_NORMAL;
+#endif
 
   ether->state_machine.bme280 = BME280_STATE_UNSET;
   ether->state_machine.pms7003 = PMS7003_STATE_UNSET;
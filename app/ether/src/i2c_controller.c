@@ -1,30 +1,656 @@
 #include "i2c_controller.h"
 
-static const TickType_t ticks = pdMS_TO_TICKS(10000);
+/** 
+ * \brief Structure for a shadowed register value.
+ */
+typedef struct {
+  uint8_t reg;      /*!< Register address. */
+  uint8_t value;    /*!< Last value written. */
+  bool valid;       /*!< Entry holds a value known to be in the device. */
+} i2c_controller_shadow_entry_t;
 
-i2c_controller_result_t i2c_controller_init(const i2c_controller_descriptor_t *descriptor) 
+/** 
+ * \brief Structure for the register shadow of a device.
+ */
+typedef struct {
+  i2c_controller_shadow_entry_t entries[I2C_CONTROLLER_SHADOW_SIZE];  /*!< Shadowed registers. */
+  uint8_t next;                                                       /*!< Entry replaced when full. */
+} i2c_controller_shadow_t;
+
+/** 
+ * \brief How a device transfer interacts with the register shadow.
+ */
+typedef enum {
+  I2C_CONTROLLER_ACCESS_RAW = 0,    /*!< Always executed, keeps the shadow up to date. */
+  I2C_CONTROLLER_ACCESS_CACHED,     /*!< Single register write skipped when the shadow matches. */
+  I2C_CONTROLLER_ACCESS_PAIRS,      /*!< Register/value pairs, skipped when all of them match. */
+} i2c_controller_access_t;
+
+/** 
+ * \brief Structure for the state of an I2C bus.
+ */
+typedef struct {
+  SemaphoreHandle_t lock;                                           /*!< Bus arbiter. */
+  StaticSemaphore_t lock_buffer;                                    /*!< Bus arbiter storage. */
+  i2c_config_t config;                                              /*!< Configuration, clk_speed is the current clock. */
+  const i2c_controller_device_t *devices[I2C_CONTROLLER_DEVICES_MAX];  /*!< Registered devices. */
+  size_t devices_count;                                             /*!< Number of registered devices. */
+  i2c_controller_shadow_t shadows[I2C_CONTROLLER_DEVICES_MAX];      /*!< Register shadows of the devices. */
+  uint32_t clk_limit;                                               /*!< Fastest clock the bus is trusted with. */
+  uint32_t window_transfers;                                        /*!< Transfers in the current health window. */
+  uint32_t window_errors;                                           /*!< Errors in the current health window. */
+  i2c_controller_health_t health;                                   /*!< Bus health counters. */
+} i2c_controller_bus_t;
+
+static i2c_controller_bus_t buses[I2C_NUM_MAX];
+
+/* Clock steps tried by the probe and used for the fallback, fastest first. */
+static const uint32_t clk_steps[] = {
+  I2C_CONTROLLER_FAST_FREQ_HZ,
+  I2C_CONTROLLER_MEDIUM_FREQ_HZ,
+  I2C_CONTROLLER_MASTER_FREQ_HZ,
+};
+
+static QueueHandle_t async_queue;
+static SemaphoreHandle_t async_lock;
+static StaticSemaphore_t async_lock_buffer;
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+#if !defined(I2C_CONTROLLER_SIMULATOR)
+/* 
+ * Fills the command link with: START, address + W, prefix, write data, 
+ * (repeated) START, address + R, read data, STOP. Any phase may be empty. 
+ */
+static esp_err_t i2c_controller_build(i2c_cmd_handle_t cmd, uint8_t address, 
+                                      const uint8_t *prefix, size_t prefix_len, 
+                                      const uint8_t *write_data, size_t write_len, 
+                                      uint8_t *read_data, size_t read_len)
 {
-  if (!descriptor) {
-    return I2C_CONTROLLER_RESULT_ERROR;
+  esp_err_t result;
+  static const char *I2C_CONTROLLER_BUILD_TAG = "I2C_CONTROLLER_BUILD";
+
+  if ((prefix_len > 0) || (write_len > 0)) {
+    result = i2c_master_start(cmd);
+    if (result != ESP_OK) {
+      ESP_LOGI(I2C_CONTROLLER_BUILD_TAG, "i2c_master_start result = 0x%x", result); 
+      return result;
+    }
+
+    /* Send device address. */
+    result = i2c_master_write_byte(cmd, ((address << 1) | I2C_MASTER_WRITE), I2C_CONTROLLER_I2C_ACK_ENABLE);
+    if (result != ESP_OK) {
+      ESP_LOGI(I2C_CONTROLLER_BUILD_TAG, "i2c_master_write_byte result = 0x%x", result); 
+      return result;
+    }
+
+    if (prefix_len > 0) {
+      result = i2c_master_write(cmd, prefix, prefix_len, I2C_CONTROLLER_I2C_ACK_ENABLE);
+      if (result != ESP_OK) {
+        ESP_LOGI(I2C_CONTROLLER_BUILD_TAG, "i2c_master_write result = 0x%x", result); 
+        return result;
+      }
+    }
+
+    if (write_len > 0) {
+      result = i2c_master_write(cmd, write_data, write_len, I2C_CONTROLLER_I2C_ACK_ENABLE);
+      if (result != ESP_OK) {
+        ESP_LOGI(I2C_CONTROLLER_BUILD_TAG, "i2c_master_write result = 0x%x", result); 
+        return result;
+      }
+    }
+  }
+
+  if (read_len > 0) {
+    /* Repeated start when preceded by the write phase, the bus is not released. */
+    result = i2c_master_start(cmd);
+    if (result != ESP_OK) {
+      ESP_LOGI(I2C_CONTROLLER_BUILD_TAG, "i2c_master_start result = 0x%x", result); 
+      return result;
+    }
+
+    /* Send device address. */
+    result = i2c_master_write_byte(cmd, ((address << 1) | I2C_MASTER_READ), I2C_CONTROLLER_I2C_ACK_ENABLE);
+    if (result != ESP_OK) {
+      ESP_LOGI(I2C_CONTROLLER_BUILD_TAG, "i2c_master_write_byte result = 0x%x", result); 
+      return result;
+    }
+
+    if (read_len > 1) {
+      result = i2c_master_read(cmd, read_data, read_len - 1, I2C_CONTROLLER_I2C_ACK);
+      if (result != ESP_OK) {
+        ESP_LOGI(I2C_CONTROLLER_BUILD_TAG, "i2c_master_read result = 0x%x", result); 
+        return result;
+      }
+    }
+
+    result = i2c_master_read_byte(cmd, read_data + (read_len - 1), I2C_CONTROLLER_I2C_NACK);
+    if (result != ESP_OK) {
+      ESP_LOGI(I2C_CONTROLLER_BUILD_TAG, "i2c_master_read_byte result = 0x%x", result); 
+      return result;
+    }
+  }
+
+  result = i2c_master_stop(cmd);
+  if (result != ESP_OK) {
+    ESP_LOGI(I2C_CONTROLLER_BUILD_TAG, "i2c_master_stop result = 0x%x", result); 
+    return result;
   }
 
+  return ESP_OK;
+}
+
+#endif // !I2C_CONTROLLER_SIMULATOR
+
+/* 
+ * The command link lives in a buffer on the caller's stack, so the bus path
+ * never touches the heap and there is nothing to leak on the error paths.
+ */
+static esp_err_t i2c_controller_transfer(i2c_port_t i2c_num, uint8_t address, 
+                                         const uint8_t *prefix, size_t prefix_len, 
+                                         const uint8_t *write_data, size_t write_len, 
+                                         uint8_t *read_data, size_t read_len, 
+                                         TickType_t transfer_ticks)
+{
+#if defined(I2C_CONTROLLER_SIMULATOR)
+  return i2c_simulator_transfer(i2c_num, address, prefix, prefix_len, 
+                                write_data, write_len, read_data, read_len, transfer_ticks);
+#else
   esp_err_t result;
-  static const char *I2C_CONTROLLER_CONFIG_TAG = "I2C_CONTROLLER_CONFIG";
+  uint8_t buffer[I2C_CONTROLLER_CMD_LINK_SIZE] = { 0 };
+  static const char *I2C_CONTROLLER_TRANSFER_TAG = "I2C_CONTROLLER_TRANSFER";
+
+  i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(buffer, sizeof(buffer));
+  if (!cmd) {
+    ESP_LOGI(I2C_CONTROLLER_TRANSFER_TAG, "i2c_cmd_link_create_static failed"); 
+    return ESP_ERR_NO_MEM;
+  }
+
+  result = i2c_controller_build(cmd, address, prefix, prefix_len, 
+                                write_data, write_len, read_data, read_len);
+
+  if (result == ESP_OK) {
+    result = i2c_master_cmd_begin(i2c_num, cmd, transfer_ticks);
+    if (result != ESP_OK) {
+      ESP_LOGI(I2C_CONTROLLER_TRANSFER_TAG, "i2c_master_cmd_begin result = 0x%x", result); 
+    }
+  }
 
-  result = i2c_param_config(descriptor->i2c_num, &descriptor->config);
+  /* The only exit point, the link is released whatever the outcome. */
+  i2c_cmd_link_delete_static(cmd);
+
+  return result;
+#endif // I2C_CONTROLLER_SIMULATOR
+}
+
+/* Switch the bus clock only when the device needs a different one, 0 keeps the current clock. */
+static esp_err_t i2c_controller_bus_set_clock(i2c_port_t i2c_num, uint32_t clk_speed)
+{
+  esp_err_t result;
+  i2c_config_t config = buses[i2c_num].config;
+  static const char *I2C_CONTROLLER_CLOCK_TAG = "I2C_CONTROLLER_CLOCK";
+
+  if ((clk_speed == 0) || (clk_speed == config.master.clk_speed)) {
+    return ESP_OK;
+  }
+
+  config.master.clk_speed = clk_speed;
+
+#if defined(I2C_CONTROLLER_SIMULATOR)
+  result = i2c_simulator_set_clock(i2c_num, clk_speed);
+#else
+  result = i2c_param_config(i2c_num, &config);
+#endif
   if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_CONFIG_TAG, "i2c_param_config result = 0x%x", result); 
-    return I2C_CONTROLLER_RESULT_ERROR;
+    ESP_LOGI(I2C_CONTROLLER_CLOCK_TAG, "i2c_param_config result = 0x%x", result); 
+    return result;
+  }
+
+  buses[i2c_num].config = config;
+
+  return ESP_OK;
+}
+
+/* The registered device at the address, or the controller defaults in the scratch device. */
+static const i2c_controller_device_t *i2c_controller_device_lookup(i2c_port_t i2c_num, uint8_t address, 
+                                                                   i2c_controller_device_t *scratch)
+{
+  if ((i2c_num >= 0) && (i2c_num < I2C_NUM_MAX)) {
+    for (size_t i = 0; i < buses[i2c_num].devices_count; ++i) {
+      if (buses[i2c_num].devices[i]->address == address) {
+        return buses[i2c_num].devices[i];
+      }
+    }
   }
 
-  result = i2c_driver_install(descriptor->i2c_num, descriptor->config.mode, 
+  *scratch = (i2c_controller_device_t)I2C_CONTROLLER_DEVICE_DEFAULT(i2c_num, address);
+
+  return scratch;
+}
+
+/* Registered devices only, an unregistered address runs without a shadow. */
+static i2c_controller_shadow_t *i2c_controller_shadow_find(const i2c_controller_device_t *device)
+{
+  i2c_controller_bus_t *bus = &buses[device->i2c_num];
+
+  for (size_t i = 0; i < bus->devices_count; ++i) {
+    if (bus->devices[i] == device) {
+      return &bus->shadows[i];
+    }
+  }
+
+  return NULL;
+}
+
+static bool i2c_controller_shadow_match(const i2c_controller_shadow_t *shadow, uint8_t reg, uint8_t value)
+{
+  for (size_t i = 0; i < I2C_CONTROLLER_SHADOW_SIZE; ++i) {
+    if ((shadow->entries[i].valid) && (shadow->entries[i].reg == reg)) {
+      return (shadow->entries[i].value == value);
+    }
+  }
+
+  return false;
+}
+
+static void i2c_controller_shadow_store(i2c_controller_shadow_t *shadow, uint8_t reg, uint8_t value)
+{
+  i2c_controller_shadow_entry_t *entry = NULL;
+
+  for (size_t i = 0; (i < I2C_CONTROLLER_SHADOW_SIZE) && (!entry); ++i) {
+    if ((shadow->entries[i].valid) && (shadow->entries[i].reg == reg)) {
+      entry = &shadow->entries[i];
+    }
+  }
+
+  for (size_t i = 0; (i < I2C_CONTROLLER_SHADOW_SIZE) && (!entry); ++i) {
+    if (!shadow->entries[i].valid) {
+      entry = &shadow->entries[i];
+    }
+  }
+
+  if (!entry) {
+    entry = &shadow->entries[shadow->next];
+    shadow->next = (shadow->next + 1) % I2C_CONTROLLER_SHADOW_SIZE;
+  }
+
+  entry->reg = reg;
+  entry->value = value;
+  entry->valid = true;
+}
+
+static void i2c_controller_shadow_invalidate(i2c_controller_shadow_t *shadow)
+{
+  memset(shadow, 0, sizeof(*shadow));
+}
+
+/* Round up, a deadline shorter than one tick must still give the transfer a chance. */
+static TickType_t i2c_controller_ms_to_ticks(uint32_t ms)
+{
+  TickType_t ticks = (TickType_t)((ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+
+  return (ticks > 0) ? ticks : 1;
+}
+
+/* Time left until the deadline, 0 when it has passed. */
+static TickType_t i2c_controller_ticks_left(TickType_t start, TickType_t budget)
+{
+  TickType_t elapsed = xTaskGetTickCount() - start;
+
+  return (elapsed < budget) ? (budget - elapsed) : 0;
+}
+
+/* A slave stuck in the middle of a byte keeps SDA low and the master can't generate START. */
+static bool i2c_controller_bus_stuck(i2c_port_t i2c_num)
+{
+#if defined(I2C_CONTROLLER_SIMULATOR)
+  return i2c_simulator_bus_stuck(i2c_num);
+#else
+  return (gpio_get_level(buses[i2c_num].config.sda_io_num) == 0);
+#endif
+}
+
+/* Apply the configuration and install the driver, or bring up the simulated bus. */
+static esp_err_t i2c_controller_bus_install(i2c_port_t i2c_num, const i2c_config_t *config)
+{
+  esp_err_t result;
+  static const char *I2C_CONTROLLER_INSTALL_TAG = "I2C_CONTROLLER_INSTALL";
+
+#if defined(I2C_CONTROLLER_SIMULATOR)
+  result = i2c_simulator_install(i2c_num, config->master.clk_speed);
+  if (result != ESP_OK) {
+    ESP_LOGI(I2C_CONTROLLER_INSTALL_TAG, "i2c_simulator_install result = 0x%x", result); 
+    return result;
+  }
+#else
+  result = i2c_param_config(i2c_num, config);
+  if (result != ESP_OK) {
+    ESP_LOGI(I2C_CONTROLLER_INSTALL_TAG, "i2c_param_config result = 0x%x", result); 
+    return result;
+  }
+
+  result = i2c_driver_install(i2c_num, config->mode, 
                               I2C_CONTROLLER_MASTER_RX_BUF_DISABLE, 
                               I2C_CONTROLLER_MASTER_TX_BUF_DISABLE, 0);
   if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_CONFIG_TAG, "i2c_driver_install result = 0x%x", result); 
+    ESP_LOGI(I2C_CONTROLLER_INSTALL_TAG, "i2c_driver_install result = 0x%x", result); 
+    return result;
+  }
+#endif
+
+  return ESP_OK;
+}
+
+/* 
+ * Bus clear (I2C specification, 3.1.16): clock SCL up to 9 times until the 
+ * slave releases SDA, then generate STOP. The driver must not own the pins.
+ */
+static void i2c_controller_bus_clear(i2c_port_t i2c_num)
+{
+#if defined(I2C_CONTROLLER_SIMULATOR)
+  i2c_simulator_bus_clear(i2c_num, I2C_CONTROLLER_RECOVER_PULSES);
+#else
+  gpio_num_t sda = (gpio_num_t)buses[i2c_num].config.sda_io_num;
+  gpio_num_t scl = (gpio_num_t)buses[i2c_num].config.scl_io_num;
+
+  gpio_config_t gpio = {
+    .pin_bit_mask = ((1ULL << sda) | (1ULL << scl)),
+    .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+    .pull_up_en = GPIO_PULLUP_ENABLE,
+  };
+  gpio_config(&gpio);
+
+  gpio_set_level(sda, 1);
+  gpio_set_level(scl, 1);
+  esp_rom_delay_us(I2C_CONTROLLER_RECOVER_HALF_PERIOD_US);
+
+  for (uint8_t pulse = 0; (pulse < I2C_CONTROLLER_RECOVER_PULSES) && (gpio_get_level(sda) == 0); ++pulse) {
+    gpio_set_level(scl, 0);
+    esp_rom_delay_us(I2C_CONTROLLER_RECOVER_HALF_PERIOD_US);
+    gpio_set_level(scl, 1);
+    esp_rom_delay_us(I2C_CONTROLLER_RECOVER_HALF_PERIOD_US);
+  }
+
+  /* STOP: SDA rising while SCL is high. */
+  gpio_set_level(scl, 0);
+  esp_rom_delay_us(I2C_CONTROLLER_RECOVER_HALF_PERIOD_US);
+  gpio_set_level(sda, 0);
+  esp_rom_delay_us(I2C_CONTROLLER_RECOVER_HALF_PERIOD_US);
+  gpio_set_level(scl, 1);
+  esp_rom_delay_us(I2C_CONTROLLER_RECOVER_HALF_PERIOD_US);
+  gpio_set_level(sda, 1);
+  esp_rom_delay_us(I2C_CONTROLLER_RECOVER_HALF_PERIOD_US);
+#endif
+}
+
+/* Release the pins, clear the bus and install the driver again. */
+static esp_err_t i2c_controller_bus_recover(i2c_port_t i2c_num)
+{
+  static const char *I2C_CONTROLLER_RECOVER_TAG = "I2C_CONTROLLER_RECOVER";
+
+  ESP_LOGW(I2C_CONTROLLER_RECOVER_TAG, "bus stuck, recovering port %d", i2c_num); 
+
+#if !defined(I2C_CONTROLLER_SIMULATOR)
+  i2c_driver_delete(i2c_num);
+#endif
+
+  i2c_controller_bus_clear(i2c_num);
+
+  ++buses[i2c_num].health.recoveries;
+
+  /* Nothing is known about what the devices received before the bus got stuck. */
+  for (size_t i = 0; i < buses[i2c_num].devices_count; ++i) {
+    i2c_controller_shadow_invalidate(&buses[i2c_num].shadows[i]);
+  }
+
+  return i2c_controller_bus_install(i2c_num, &buses[i2c_num].config);
+}
+
+/* Count the transfer outcome and step the clock down when errors climb. */
+static void i2c_controller_bus_account(i2c_port_t i2c_num, esp_err_t result)
+{
+  i2c_controller_bus_t *bus = &buses[i2c_num];
+  static const char *I2C_CONTROLLER_HEALTH_TAG = "I2C_CONTROLLER_HEALTH";
+
+  ++bus->health.transfers;
+  ++bus->window_transfers;
+
+  if (result == ESP_FAIL) {
+    ++bus->health.nacks;
+    ++bus->window_errors;
+  } else if (result == ESP_ERR_TIMEOUT) {
+    ++bus->health.timeouts;
+    ++bus->window_errors;
+  }
+
+  if (bus->window_errors >= I2C_CONTROLLER_HEALTH_ERRORS_MAX) {
+    for (size_t i = 0; i < (sizeof(clk_steps) / sizeof(clk_steps[0])); ++i) {
+      if (clk_steps[i] < bus->clk_limit) {
+        ESP_LOGW(I2C_CONTROLLER_HEALTH_TAG, "%lu errors, clock %lu -> %lu Hz", 
+                 (unsigned long)bus->window_errors, (unsigned long)bus->clk_limit, 
+                 (unsigned long)clk_steps[i]); 
+        bus->clk_limit = clk_steps[i];
+        ++bus->health.clk_downgrades;
+        break;
+      }
+    }
+  }
+
+  if ((bus->window_errors >= I2C_CONTROLLER_HEALTH_ERRORS_MAX) || 
+      (bus->window_transfers >= I2C_CONTROLLER_HEALTH_WINDOW)) {
+    bus->window_transfers = 0;
+    bus->window_errors = 0;
+  }
+}
+
+/* Read the probe register of every device a few times, all reads must succeed and match. */
+static bool i2c_controller_bus_probe_clock(i2c_port_t i2c_num, uint32_t clk_speed)
+{
+  i2c_controller_bus_t *bus = &buses[i2c_num];
+  TickType_t probe_ticks = i2c_controller_ms_to_ticks(I2C_CONTROLLER_PROBE_TIMEOUT_MS);
+
+  if (i2c_controller_bus_set_clock(i2c_num, clk_speed) != ESP_OK) {
+    return false;
+  }
+
+  for (size_t i = 0; i < bus->devices_count; ++i) {
+    const i2c_controller_device_t *device = bus->devices[i];
+    uint8_t expected = 0;
+    uint8_t data = 0;
+
+    /* Devices slower than the candidate clock keep running at their own clock. */
+    if ((device->clk_speed != 0) && (device->clk_speed < clk_speed)) {
+      continue;
+    }
+
+    for (uint8_t read = 0; read < I2C_CONTROLLER_PROBE_READS; ++read) {
+      if (i2c_controller_transfer(i2c_num, device->address, NULL, 0, &device->probe_reg, 
+                                  sizeof(device->probe_reg), &data, sizeof(data), 
+                                  probe_ticks) != ESP_OK) {
+        return false;
+      }
+
+      if (read == 0) {
+        expected = data;
+      } else if (data != expected) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/* 
+ * Every access goes through here. The bus mutex is the arbiter: the holder
+ * inherits the priority of the waiters and the highest priority waiter 
+ * gets the bus next, so a whole measurement cycle is never serialized.
+ * The device timeout is a deadline for the whole call, waiting for the bus,
+ * retries and a possible bus recovery included. Register writes go
+ * through the device's register shadow, a cached write matching it is 
+ * skipped. Pairs are all written or all skipped, never split, so their 
+ * order and atomicity are kept.
+ */
+static esp_err_t i2c_controller_device_transfer(const i2c_controller_device_t *device, 
+                                                const uint8_t *prefix, size_t prefix_len, 
+                                                const uint8_t *write_data, size_t write_len, 
+                                                uint8_t *read_data, size_t read_len, 
+                                                i2c_controller_access_t access)
+{
+  if ((device->i2c_num < 0) || (device->i2c_num >= I2C_NUM_MAX)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t result;
+  i2c_controller_bus_t *bus = &buses[device->i2c_num];
+  TickType_t start = xTaskGetTickCount();
+  TickType_t budget = i2c_controller_ms_to_ticks(device->timeout_ms);
+  TickType_t ticks_left;
+
+  if (!bus->lock) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  if (xSemaphoreTake(bus->lock, budget) != pdTRUE) {
+    return ESP_ERR_TIMEOUT;
+  }
+
+  i2c_controller_shadow_t *shadow = i2c_controller_shadow_find(device);
+  bool register_write = ((prefix_len == 1) && (write_len == 1) && (read_len == 0));
+  bool skip = false;
+
+  if ((shadow) && (access == I2C_CONTROLLER_ACCESS_CACHED) && (register_write)) {
+    skip = i2c_controller_shadow_match(shadow, prefix[0], write_data[0]);
+  } else if ((shadow) && (access == I2C_CONTROLLER_ACCESS_PAIRS)) {
+    skip = true;
+    for (size_t i = 0; (i + 1 < write_len) && (skip); i += 2) {
+      skip = i2c_controller_shadow_match(shadow, write_data[i], write_data[i + 1]);
+    }
+  }
+
+  if (skip) {
+    ++bus->health.writes_skipped;
+    xSemaphoreGive(bus->lock);
+    return ESP_OK;
+  }
+
+  uint32_t clk_speed = bus->clk_limit;
+  if ((device->clk_speed != 0) && (device->clk_speed < clk_speed)) {
+    clk_speed = device->clk_speed;
+  }
+
+  result = i2c_controller_bus_set_clock(device->i2c_num, clk_speed);
+
+  if (result == ESP_OK) {
+    for (uint8_t attempt = 0; attempt <= device->retries; ++attempt) {
+      ticks_left = i2c_controller_ticks_left(start, budget);
+      if (ticks_left == 0) {
+        result = ESP_ERR_TIMEOUT;
+        break;
+      }
+
+      result = i2c_controller_transfer(device->i2c_num, device->address, prefix, prefix_len, 
+                                       write_data, write_len, read_data, read_len, 
+                                       ticks_left);
+      i2c_controller_bus_account(device->i2c_num, result);
+      if (result == ESP_OK) {
+        break;
+      }
+
+      if ((result == ESP_ERR_TIMEOUT) && (i2c_controller_bus_stuck(device->i2c_num))) {
+        i2c_controller_bus_recover(device->i2c_num);
+      }
+    }
+  }
+
+  if (shadow) {
+    if (result != ESP_OK) {
+      /* A failed write may or may not have reached the register. */
+      i2c_controller_shadow_invalidate(shadow);
+    } else if (access == I2C_CONTROLLER_ACCESS_PAIRS) {
+      for (size_t i = 0; i + 1 < write_len; i += 2) {
+        i2c_controller_shadow_store(shadow, write_data[i], write_data[i + 1]);
+      }
+    } else if (register_write) {
+      i2c_controller_shadow_store(shadow, prefix[0], write_data[0]);
+    } else if ((prefix_len + write_len > 1) && (read_len == 0)) {
+      /* Multi-byte writes are device specific, don't guess what they changed. */
+      i2c_controller_shadow_invalidate(shadow);
+    }
+  }
+
+  xSemaphoreGive(bus->lock);
+
+  return result;
+}
+
+static void i2c_controller_async_task(void *arg)
+{
+  i2c_controller_transaction_t transaction;
+  i2c_controller_device_t scratch;
+  i2c_controller_result_t result;
+  esp_err_t transfer_result;
+
+  while (1) {
+    xQueueReceive(async_queue, &transaction, portMAX_DELAY);
+
+    /* The registered device, so the transfer keeps its register shadow right. */
+    const i2c_controller_device_t *device = i2c_controller_device_lookup(transaction.i2c_num, 
+                                                                         transaction.address, &scratch);
+
+    transfer_result = i2c_controller_device_transfer(device, NULL, 0, 
+                                                     transaction.write_data, transaction.write_len, 
+                                                     transaction.read_data, transaction.read_len, 
+                                                     I2C_CONTROLLER_ACCESS_RAW);
+
+    result = (transfer_result == ESP_OK) ? I2C_CONTROLLER_RESULT_SUCCESS : I2C_CONTROLLER_RESULT_ERROR;
+
+    if (transaction.callback) {
+      transaction.callback(result, transaction.arg);
+    }
+
+    if (transaction.notify_task) {
+      xTaskNotifyIndexed(transaction.notify_task, I2C_CONTROLLER_NOTIFY_INDEX, 
+                         ((result == I2C_CONTROLLER_RESULT_SUCCESS) ? I2C_CONTROLLER_NOTIFY_SUCCESS : 
+                                                                      I2C_CONTROLLER_NOTIFY_ERROR), 
+                         eSetBits);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+i2c_controller_result_t i2c_controller_init(const i2c_controller_descriptor_t *descriptor) 
+{
+  if ((!descriptor) || (descriptor->i2c_num < 0) || (descriptor->i2c_num >= I2C_NUM_MAX)) {
+    return I2C_CONTROLLER_RESULT_ERROR;
+  }
+
+  esp_err_t result;
+  static const char *I2C_CONTROLLER_CONFIG_TAG = "I2C_CONTROLLER_CONFIG";
+
+  result = i2c_controller_bus_install(descriptor->i2c_num, &descriptor->config);
+  if (result != ESP_OK) {
+    ESP_LOGI(I2C_CONTROLLER_CONFIG_TAG, "i2c_controller_bus_install result = 0x%x", result); 
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
+  buses[descriptor->i2c_num].config = descriptor->config;
+  buses[descriptor->i2c_num].clk_limit = descriptor->config.master.clk_speed;
+
+  if (!buses[descriptor->i2c_num].lock) {
+    buses[descriptor->i2c_num].lock = xSemaphoreCreateMutexStatic(&buses[descriptor->i2c_num].lock_buffer);
+  }
+
+  /* Guards the lazy start of the worker, the first submissions may race. */
+  if (!async_lock) {
+    async_lock = xSemaphoreCreateMutexStatic(&async_lock_buffer);
+  }
+
   ESP_LOGI(I2C_CONTROLLER_CONFIG_TAG, "i2c_controller_init: OK"); 
   return I2C_CONTROLLER_RESULT_SUCCESS;
 }
@@ -33,52 +659,76 @@ i2c_controller_result_t i2c_controller_send(i2c_port_t i2c_num, uint8_t address,
                                             uint8_t reg, const uint8_t *data, 
                                             size_t data_len) 
 {
+  if ((!data) || (data_len == 0)) {
+    return I2C_CONTROLLER_RESULT_ERROR;
+  }
+
   esp_err_t result;
   static const char *I2C_CONTROLLER_SEND_TAG = "I2C_CONTROLLER_SEND";
 
-  i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+  i2c_controller_device_t scratch;
+  const i2c_controller_device_t *device = i2c_controller_device_lookup(i2c_num, address, &scratch);
 
-  result = i2c_master_start(cmd);
+  result = i2c_controller_device_transfer(device, &reg, sizeof(reg), data, data_len, NULL, 0, I2C_CONTROLLER_ACCESS_RAW);
   if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_SEND_TAG, "i2c_master_start result = 0x%x", result); 
+    ESP_LOGI(I2C_CONTROLLER_SEND_TAG, "i2c_controller_device_transfer result = 0x%x", result); 
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  /* Send device address. */
-  result = i2c_master_write_byte(cmd, ((address << 1) | I2C_MASTER_WRITE), I2C_CONTROLLER_I2C_ACK_ENABLE);
-  if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_SEND_TAG, "i2c_master_write_byte result = 0x%x", result); 
-    return I2C_CONTROLLER_RESULT_ERROR;
-  }
+  ESP_LOGI(I2C_CONTROLLER_SEND_TAG, "i2c_controller_send: OK"); 
 
-  /* Send register address. */
-  result = i2c_master_write_byte(cmd, reg, I2C_CONTROLLER_I2C_ACK_ENABLE);
-  if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_SEND_TAG, "i2c_master_write_byte result = 0x%x", result); 
+  return I2C_CONTROLLER_RESULT_SUCCESS;
+}
+
+i2c_controller_result_t i2c_controller_send_pairs(i2c_port_t i2c_num, uint8_t address, 
+                                                  const i2c_controller_pair_t *pairs, 
+                                                  size_t pairs_count) 
+{
+  if ((!pairs) || (pairs_count == 0)) {
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  result = i2c_master_write(cmd, data, data_len, I2C_CONTROLLER_I2C_ACK_ENABLE);
+  esp_err_t result;
+  static const char *I2C_CONTROLLER_SEND_PAIRS_TAG = "I2C_CONTROLLER_SEND_PAIRS";
+
+  i2c_controller_device_t scratch;
+  const i2c_controller_device_t *device = i2c_controller_device_lookup(i2c_num, address, &scratch);
+
+  result = i2c_controller_device_transfer(device, NULL, 0, (const uint8_t *)pairs, 
+                                          (pairs_count * sizeof(i2c_controller_pair_t)), 
+                                          NULL, 0, I2C_CONTROLLER_ACCESS_RAW);
   if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_SEND_TAG, "i2c_master_write_byte result = 0x%x", result); 
+    ESP_LOGI(I2C_CONTROLLER_SEND_PAIRS_TAG, "i2c_controller_device_transfer result = 0x%x", result); 
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  result = i2c_master_stop(cmd);
-  if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_SEND_TAG, "i2c_master_stop result = 0x%x", result); 
+  ESP_LOGI(I2C_CONTROLLER_SEND_PAIRS_TAG, "i2c_controller_send_pairs: OK"); 
+
+  return I2C_CONTROLLER_RESULT_SUCCESS;
+}
+
+i2c_controller_result_t i2c_controller_write_read(i2c_port_t i2c_num, uint8_t address, 
+                                                  const uint8_t *write_data, size_t write_len, 
+                                                  uint8_t *read_data, size_t read_len) 
+{
+  if ((!write_data) || (write_len == 0) || (!read_data) || (read_len == 0)) {
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  result = i2c_master_cmd_begin(i2c_num, cmd, ticks);
+  esp_err_t result;
+  static const char *I2C_CONTROLLER_WRITE_READ_TAG = "I2C_CONTROLLER_WRITE_READ";
+
+  i2c_controller_device_t scratch;
+  const i2c_controller_device_t *device = i2c_controller_device_lookup(i2c_num, address, &scratch);
+
+  result = i2c_controller_device_transfer(device, NULL, 0, write_data, write_len, 
+                                          read_data, read_len, I2C_CONTROLLER_ACCESS_RAW);
   if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_SEND_TAG, "i2c_master_cmd_begin result = 0x%x", result); 
+    ESP_LOGI(I2C_CONTROLLER_WRITE_READ_TAG, "i2c_controller_device_transfer result = 0x%x", result); 
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  i2c_cmd_link_delete(cmd);
-
-  ESP_LOGI(I2C_CONTROLLER_SEND_TAG, "i2c_controller_send: OK"); 
+  ESP_LOGI(I2C_CONTROLLER_WRITE_READ_TAG, "i2c_controller_write_read: OK"); 
 
   return I2C_CONTROLLER_RESULT_SUCCESS;
 }
@@ -87,88 +737,311 @@ i2c_controller_result_t i2c_controller_receive(i2c_port_t i2c_num, uint8_t addre
                                                uint8_t reg, uint8_t *data, 
                                                size_t data_len) 
 {
+  return i2c_controller_write_read(i2c_num, address, &reg, sizeof(reg), data, data_len);
+}
+
+i2c_controller_result_t i2c_controller_device_register(const i2c_controller_device_t *device) 
+{
+  if ((!device) || (device->i2c_num < 0) || (device->i2c_num >= I2C_NUM_MAX)) {
+    return I2C_CONTROLLER_RESULT_ERROR;
+  }
+
+  i2c_controller_bus_t *bus = &buses[device->i2c_num];
+  static const char *I2C_CONTROLLER_REGISTER_TAG = "I2C_CONTROLLER_REGISTER";
+
+  if ((!bus->lock) || (bus->devices_count >= I2C_CONTROLLER_DEVICES_MAX)) {
+    ESP_LOGI(I2C_CONTROLLER_REGISTER_TAG, "bus not initialized or full"); 
+    return I2C_CONTROLLER_RESULT_ERROR;
+  }
+
+  for (size_t i = 0; i < bus->devices_count; ++i) {
+    if ((bus->devices[i] == device) || (bus->devices[i]->address == device->address)) {
+      ESP_LOGI(I2C_CONTROLLER_REGISTER_TAG, "address 0x%x already registered", device->address); 
+      return I2C_CONTROLLER_RESULT_ERROR;
+    }
+  }
+
+  i2c_controller_shadow_invalidate(&bus->shadows[bus->devices_count]);
+  bus->devices[bus->devices_count++] = device;
+
+  ESP_LOGI(I2C_CONTROLLER_REGISTER_TAG, "i2c_controller_device_register: 0x%x OK", device->address); 
+  return I2C_CONTROLLER_RESULT_SUCCESS;
+}
+
+i2c_controller_result_t i2c_controller_probe(i2c_port_t i2c_num) 
+{
+  if ((i2c_num < 0) || (i2c_num >= I2C_NUM_MAX) || (!buses[i2c_num].lock)) {
+    return I2C_CONTROLLER_RESULT_ERROR;
+  }
+
+  i2c_controller_bus_t *bus = &buses[i2c_num];
+  i2c_controller_result_t result = I2C_CONTROLLER_RESULT_ERROR;
+  static const char *I2C_CONTROLLER_PROBE_TAG = "I2C_CONTROLLER_PROBE";
+
+  xSemaphoreTake(bus->lock, portMAX_DELAY);
+
+  bus->clk_limit = clk_steps[(sizeof(clk_steps) / sizeof(clk_steps[0])) - 1];
+
+  for (size_t i = 0; i < (sizeof(clk_steps) / sizeof(clk_steps[0])); ++i) {
+    if (i2c_controller_bus_probe_clock(i2c_num, clk_steps[i])) {
+      bus->clk_limit = clk_steps[i];
+      result = I2C_CONTROLLER_RESULT_SUCCESS;
+      break;
+    }
+  }
+
+  /* No step passed, the driver is left at the slowest one and not at the last tried. */
+  if (result != I2C_CONTROLLER_RESULT_SUCCESS) {
+    i2c_controller_bus_set_clock(i2c_num, bus->clk_limit);
+  }
+
+  bus->window_transfers = 0;
+  bus->window_errors = 0;
+
+  xSemaphoreGive(bus->lock);
+
+  ESP_LOGI(I2C_CONTROLLER_PROBE_TAG, "i2c_controller_probe: %lu Hz, result = %d", 
+           (unsigned long)bus->clk_limit, result); 
+  return result;
+}
+
+i2c_controller_result_t i2c_controller_recover(i2c_port_t i2c_num) 
+{
+  if ((i2c_num < 0) || (i2c_num >= I2C_NUM_MAX) || (!buses[i2c_num].lock)) {
+    return I2C_CONTROLLER_RESULT_ERROR;
+  }
+
   esp_err_t result;
-  static const char *I2C_CONTROLLER_RECEIVE_TAG = "I2C_CONTROLLER_RECEIVE";
 
-  i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+  xSemaphoreTake(buses[i2c_num].lock, portMAX_DELAY);
+  result = i2c_controller_bus_recover(i2c_num);
+  xSemaphoreGive(buses[i2c_num].lock);
 
-  result = i2c_master_start(cmd);
-  if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_master_start result = 0x%x", result); 
+  return (result == ESP_OK) ? I2C_CONTROLLER_RESULT_SUCCESS : I2C_CONTROLLER_RESULT_ERROR;
+}
+
+i2c_controller_result_t i2c_controller_health(i2c_port_t i2c_num, i2c_controller_health_t *health) 
+{
+  if ((!health) || (i2c_num < 0) || (i2c_num >= I2C_NUM_MAX) || (!buses[i2c_num].lock)) {
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  /* Send device address. */
-  result = i2c_master_write_byte(cmd, ((address << 1) | I2C_MASTER_WRITE), I2C_CONTROLLER_I2C_ACK_ENABLE);
-  if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_master_write_byte result = 0x%x", result); 
+  xSemaphoreTake(buses[i2c_num].lock, portMAX_DELAY);
+  *health = buses[i2c_num].health;
+  health->clk_speed = buses[i2c_num].clk_limit;
+  xSemaphoreGive(buses[i2c_num].lock);
+
+  return I2C_CONTROLLER_RESULT_SUCCESS;
+}
+
+i2c_controller_result_t i2c_controller_device_send(const i2c_controller_device_t *device, 
+                                                   uint8_t reg, const uint8_t *data, 
+                                                   size_t data_len) 
+{
+  if ((!device) || (!data) || (data_len == 0)) {
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  /* Send register address. */
-  result = i2c_master_write(cmd, &reg, 1, I2C_CONTROLLER_I2C_ACK_ENABLE);
+  esp_err_t result;
+  static const char *I2C_CONTROLLER_DEVICE_SEND_TAG = "I2C_CONTROLLER_DEVICE_SEND";
+
+  result = i2c_controller_device_transfer(device, &reg, sizeof(reg), data, data_len, NULL, 0, I2C_CONTROLLER_ACCESS_RAW);
   if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_master_write_byte result = 0x%x", result); 
+    ESP_LOGI(I2C_CONTROLLER_DEVICE_SEND_TAG, "i2c_controller_device_transfer result = 0x%x", result); 
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  result = i2c_master_stop(cmd);
-  if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_master_stop result = 0x%x", result); 
+  return I2C_CONTROLLER_RESULT_SUCCESS;
+}
+
+i2c_controller_result_t i2c_controller_device_send_cached(const i2c_controller_device_t *device, 
+                                                          uint8_t reg, uint8_t value) 
+{
+  if (!device) {
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  result = i2c_master_cmd_begin(i2c_num, cmd, ticks);
+  esp_err_t result;
+  static const char *I2C_CONTROLLER_DEVICE_SEND_CACHED_TAG = "I2C_CONTROLLER_DEVICE_SEND_CACHED";
+
+  result = i2c_controller_device_transfer(device, &reg, sizeof(reg), &value, sizeof(value), 
+                                          NULL, 0, I2C_CONTROLLER_ACCESS_CACHED);
   if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_master_cmd_begin result = 0x%x", result); 
+    ESP_LOGI(I2C_CONTROLLER_DEVICE_SEND_CACHED_TAG, "i2c_controller_device_transfer result = 0x%x", result); 
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  i2c_cmd_link_delete(cmd);
-  cmd = i2c_cmd_link_create();
+  return I2C_CONTROLLER_RESULT_SUCCESS;
+}
 
-  result = i2c_master_start(cmd);
-  if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_master_start result = 0x%x", result); 
+i2c_controller_result_t i2c_controller_device_send_pairs(const i2c_controller_device_t *device, 
+                                                         const i2c_controller_pair_t *pairs, 
+                                                         size_t pairs_count) 
+{
+  if ((!device) || (!pairs) || (pairs_count == 0)) {
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  /* Send device address. */
-  result = i2c_master_write_byte(cmd, ((address << 1) | I2C_MASTER_READ), I2C_CONTROLLER_I2C_ACK_ENABLE);
+  esp_err_t result;
+  static const char *I2C_CONTROLLER_DEVICE_SEND_PAIRS_TAG = "I2C_CONTROLLER_DEVICE_SEND_PAIRS";
+
+  result = i2c_controller_device_transfer(device, NULL, 0, (const uint8_t *)pairs, 
+                                          (pairs_count * sizeof(i2c_controller_pair_t)), 
+                                          NULL, 0, I2C_CONTROLLER_ACCESS_PAIRS);
   if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_master_write_byte result = 0x%x", result); 
+    ESP_LOGI(I2C_CONTROLLER_DEVICE_SEND_PAIRS_TAG, "i2c_controller_device_transfer result = 0x%x", result); 
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  if (data_len > 1) {
-    result = i2c_master_read(cmd, data, data_len - 1, I2C_CONTROLLER_I2C_ACK);
-    if (result != ESP_OK) {
-      ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_master_read result = 0x%x", result); 
-      return I2C_CONTROLLER_RESULT_ERROR;
-    }
+  return I2C_CONTROLLER_RESULT_SUCCESS;
+}
+
+i2c_controller_result_t i2c_controller_device_invalidate(const i2c_controller_device_t *device) 
+{
+  if ((!device) || (device->i2c_num < 0) || (device->i2c_num >= I2C_NUM_MAX) || 
+      (!buses[device->i2c_num].lock)) {
+    return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  result = i2c_master_read_byte(cmd, data + (data_len - 1), I2C_CONTROLLER_I2C_NACK);
-  if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_master_read_byte result = 0x%x", result); 
+  i2c_controller_shadow_t *shadow;
+
+  xSemaphoreTake(buses[device->i2c_num].lock, portMAX_DELAY);
+
+  shadow = i2c_controller_shadow_find(device);
+  if (shadow) {
+    i2c_controller_shadow_invalidate(shadow);
+  }
+
+  xSemaphoreGive(buses[device->i2c_num].lock);
+
+  return (shadow) ? I2C_CONTROLLER_RESULT_SUCCESS : I2C_CONTROLLER_RESULT_ERROR;
+}
+
+bool i2c_controller_device_shadowed(const i2c_controller_device_t *device, uint8_t reg, uint8_t value) 
+{
+  if ((!device) || (device->i2c_num < 0) || (device->i2c_num >= I2C_NUM_MAX) || 
+      (!buses[device->i2c_num].lock)) {
+    return false;
+  }
+
+  i2c_controller_shadow_t *shadow;
+  bool match = false;
+
+  xSemaphoreTake(buses[device->i2c_num].lock, portMAX_DELAY);
+
+  shadow = i2c_controller_shadow_find(device);
+  if (shadow) {
+    match = i2c_controller_shadow_match(shadow, reg, value);
+  }
+
+  xSemaphoreGive(buses[device->i2c_num].lock);
+
+  return match;
+}
+
+i2c_controller_result_t i2c_controller_device_write_read(const i2c_controller_device_t *device, 
+                                                         const uint8_t *write_data, size_t write_len, 
+                                                         uint8_t *read_data, size_t read_len) 
+{
+  if ((!device) || (!write_data) || (write_len == 0) || (!read_data) || (read_len == 0)) {
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  result = i2c_master_stop(cmd);
+  esp_err_t result;
+  static const char *I2C_CONTROLLER_DEVICE_WRITE_READ_TAG = "I2C_CONTROLLER_DEVICE_WRITE_READ";
+
+  result = i2c_controller_device_transfer(device, NULL, 0, write_data, write_len, 
+                                          read_data, read_len, I2C_CONTROLLER_ACCESS_RAW);
   if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_master_stop result = 0x%x", result); 
+    ESP_LOGI(I2C_CONTROLLER_DEVICE_WRITE_READ_TAG, "i2c_controller_device_transfer result = 0x%x", result); 
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  result = i2c_master_cmd_begin(i2c_num, cmd, ticks);
-  if (result != ESP_OK) {
-    ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_master_cmd_begin result = 0x%x", result); 
+  return I2C_CONTROLLER_RESULT_SUCCESS;
+}
+
+i2c_controller_result_t i2c_controller_device_receive(const i2c_controller_device_t *device, 
+                                                      uint8_t reg, uint8_t *data, 
+                                                      size_t data_len) 
+{
+  return i2c_controller_device_write_read(device, &reg, sizeof(reg), data, data_len);
+}
+
+i2c_controller_result_t i2c_controller_async_init(void) 
+{
+  i2c_controller_result_t result = I2C_CONTROLLER_RESULT_SUCCESS;
+  static const char *I2C_CONTROLLER_ASYNC_TAG = "I2C_CONTROLLER_ASYNC";
+
+  if (!async_lock) {
     return I2C_CONTROLLER_RESULT_ERROR;
   }
 
-  i2c_cmd_link_delete(cmd);
+  xSemaphoreTake(async_lock, portMAX_DELAY);
 
-  ESP_LOGI(I2C_CONTROLLER_RECEIVE_TAG, "i2c_controller_receive: OK"); 
+  if (!async_queue) {
+    QueueHandle_t queue = xQueueCreate(I2C_CONTROLLER_ASYNC_QUEUE_LENGTH, sizeof(i2c_controller_transaction_t));
+
+    if (!queue) {
+      ESP_LOGI(I2C_CONTROLLER_ASYNC_TAG, "xQueueCreate failed"); 
+      result = I2C_CONTROLLER_RESULT_ERROR;
+    } else {
+      /* Published before the task starts, the task reads it. */
+      async_queue = queue;
+
+      if (xTaskCreate(i2c_controller_async_task, "i2c_async_task", I2C_CONTROLLER_ASYNC_TASK_STACK_SIZE, 
+                      NULL, I2C_CONTROLLER_ASYNC_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGI(I2C_CONTROLLER_ASYNC_TAG, "xTaskCreate failed"); 
+        async_queue = NULL;
+        vQueueDelete(queue);
+        result = I2C_CONTROLLER_RESULT_ERROR;
+      } else {
+        ESP_LOGI(I2C_CONTROLLER_ASYNC_TAG, "i2c_controller_async_init: OK"); 
+      }
+    }
+  }
+
+  xSemaphoreGive(async_lock);
+
+  return result;
+}
+
+i2c_controller_result_t i2c_controller_submit(const i2c_controller_transaction_t *transaction, 
+                                              TickType_t ticks) 
+{
+  if (!transaction) {
+    return I2C_CONTROLLER_RESULT_ERROR;
+  }
+
+  if (((transaction->write_len == 0) && (transaction->read_len == 0)) || 
+      ((transaction->write_len > 0) && (!transaction->write_data)) || 
+      ((transaction->read_len > 0) && (!transaction->read_data))) {
+    return I2C_CONTROLLER_RESULT_ERROR;
+  }
+
+  if ((!async_queue) && (i2c_controller_async_init() != I2C_CONTROLLER_RESULT_SUCCESS)) {
+    return I2C_CONTROLLER_RESULT_ERROR;
+  }
+
+  if (xQueueSend(async_queue, transaction, ticks) != pdTRUE) {
+    return I2C_CONTROLLER_RESULT_ERROR;
+  }
 
   return I2C_CONTROLLER_RESULT_SUCCESS;
 }
+
+i2c_controller_result_t i2c_controller_async_wait(TickType_t ticks) 
+{
+  uint32_t notification = 0;
+
+  if (xTaskNotifyWaitIndexed(I2C_CONTROLLER_NOTIFY_INDEX, 0, 
+                             (I2C_CONTROLLER_NOTIFY_SUCCESS | I2C_CONTROLLER_NOTIFY_ERROR), 
+                             &notification, ticks) != pdTRUE) {
+    return I2C_CONTROLLER_RESULT_ERROR;
+  }
+
+  if (notification & I2C_CONTROLLER_NOTIFY_SUCCESS) {
+    return I2C_CONTROLLER_RESULT_SUCCESS;
+  }
+
+  return I2C_CONTROLLER_RESULT_ERROR;
+}
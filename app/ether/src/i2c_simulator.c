@@ -0,0 +1,597 @@
+#include "i2c_simulator.h"
+
+#if defined(I2C_CONTROLLER_SIMULATOR)
+
+#include "bme280.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define I2C_SIMULATOR_BME280_STATUS_MEASURING (1 << 3)
+#define I2C_SIMULATOR_BME280_ADC_20_MAX       (0xfffff)
+#define I2C_SIMULATOR_BME280_ADC_16_MAX       (0xffff)
+#define I2C_SIMULATOR_BME280_ADC_20_SKIPPED   (0x80000)
+#define I2C_SIMULATOR_BME280_ADC_16_SKIPPED   (0x8000)
+
+/** 
+ * \brief Structure for the BME280 trimming parameters, as in the datasheet.
+ */
+typedef struct {
+  uint16_t dig_t1;
+  int16_t dig_t2;
+  int16_t dig_t3;
+  uint16_t dig_p1;
+  int16_t dig_p2;
+  int16_t dig_p3;
+  int16_t dig_p4;
+  int16_t dig_p5;
+  int16_t dig_p6;
+  int16_t dig_p7;
+  int16_t dig_p8;
+  int16_t dig_p9;
+  uint8_t dig_h1;
+  int16_t dig_h2;
+  uint8_t dig_h3;
+  int16_t dig_h4;
+  int16_t dig_h5;
+  int8_t dig_h6;
+} i2c_simulator_bme280_calibration_t;
+
+/** 
+ * \brief Structure for the state of a simulated BME280.
+ */
+typedef struct {
+  bool attached;                                        /*!< Sensor answers on the bus. */
+  uint8_t address;                                      /*!< I2C address of the sensor. */
+  uint8_t registers[I2C_SIMULATOR_REGISTERS_SIZE];      /*!< Register file. */
+  uint8_t pointer;                                      /*!< Register address of the next read. */
+  uint8_t ctrl_hum;                                     /*!< CTRL_HUM latched by the last CTRL_MEAS write. */
+  bool measuring;                                       /*!< Conversion in progress. */
+  int64_t measure_end_us;                               /*!< End of the conversion in progress. */
+  i2c_simulator_environment_t environment;              /*!< Environment being measured. */
+} i2c_simulator_bme280_t;
+
+/** 
+ * \brief Structure for the state of a simulated bus.
+ */
+typedef struct {
+  uint32_t clk_speed;                                   /*!< Bus clock frequency. */
+  i2c_simulator_fault_t fault;                          /*!< Injected faults. */
+  i2c_simulator_stats_t stats;                          /*!< Bus counters. */
+  i2c_simulator_bme280_t bme280[I2C_SIMULATOR_DEVICES_MAX];  /*!< Sensors on the bus. */
+} i2c_simulator_bus_t;
+
+static i2c_simulator_bus_t buses[I2C_NUM_MAX];
+
+/* Trimming parameters of a production sensor, any set within range works. */
+static const i2c_simulator_bme280_calibration_t calibration = {
+  .dig_t1 = 28485, .dig_t2 = 26735, .dig_t3 = 50,
+  .dig_p1 = 36738, .dig_p2 = -10635, .dig_p3 = 3024, .dig_p4 = 6980, .dig_p5 = -4,
+  .dig_p6 = -7, .dig_p7 = 9900, .dig_p8 = -10230, .dig_p9 = 4285,
+  .dig_h1 = 75, .dig_h2 = 353, .dig_h3 = 0, .dig_h4 = 340, .dig_h5 = 0, .dig_h6 = 30,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+static void i2c_simulator_put_u16(uint8_t *registers, uint8_t reg, uint16_t value)
+{
+  registers[reg] = (uint8_t)(value & 0xff);
+  registers[reg + 1] = (uint8_t)(value >> 8);
+}
+
+/* Lay the trimming parameters out the way the sensor's NVM does. */
+static void i2c_simulator_bme280_calibrate(uint8_t *registers)
+{
+  const i2c_simulator_bme280_calibration_t *c = &calibration;
+
+  i2c_simulator_put_u16(registers, 0x88, c->dig_t1);
+  i2c_simulator_put_u16(registers, 0x8a, (uint16_t)c->dig_t2);
+  i2c_simulator_put_u16(registers, 0x8c, (uint16_t)c->dig_t3);
+  i2c_simulator_put_u16(registers, 0x8e, c->dig_p1);
+  i2c_simulator_put_u16(registers, 0x90, (uint16_t)c->dig_p2);
+  i2c_simulator_put_u16(registers, 0x92, (uint16_t)c->dig_p3);
+  i2c_simulator_put_u16(registers, 0x94, (uint16_t)c->dig_p4);
+  i2c_simulator_put_u16(registers, 0x96, (uint16_t)c->dig_p5);
+  i2c_simulator_put_u16(registers, 0x98, (uint16_t)c->dig_p6);
+  i2c_simulator_put_u16(registers, 0x9a, (uint16_t)c->dig_p7);
+  i2c_simulator_put_u16(registers, 0x9c, (uint16_t)c->dig_p8);
+  i2c_simulator_put_u16(registers, 0x9e, (uint16_t)c->dig_p9);
+  registers[0xa1] = c->dig_h1;
+  i2c_simulator_put_u16(registers, 0xe1, (uint16_t)c->dig_h2);
+  registers[0xe3] = c->dig_h3;
+  registers[0xe4] = (uint8_t)(c->dig_h4 >> 4);
+  registers[0xe5] = (uint8_t)((c->dig_h4 & 0x0f) | ((c->dig_h5 & 0x0f) << 4));
+  registers[0xe6] = (uint8_t)(c->dig_h5 >> 4);
+  registers[0xe7] = (uint8_t)c->dig_h6;
+}
+
+/* Power-on and soft reset state of the writable and data registers. */
+static void i2c_simulator_bme280_reset(i2c_simulator_bme280_t *bme280)
+{
+  uint8_t *registers = bme280->registers;
+
+  registers[BME280_REGISTER_ID] = BME280_DATA_ID;
+  registers[BME280_REGISTER_RESET] = 0x00;
+  registers[BME280_REGISTER_CTRL_HUM] = 0x00;
+  registers[BME280_REGISTER_STATUS] = 0x00;
+  registers[BME280_REGISTER_CTRL_MEAS] = 0x00;
+  registers[BME280_REGISTER_CONFIG] = 0x00;
+  registers[BME280_REGISTER_PRESS_MSB] = 0x80;
+  registers[BME280_REGISTER_PRESS_LSB] = 0x00;
+  registers[BME280_REGISTER_PRESS_XLSB] = 0x00;
+  registers[BME280_REGISTER_TEMP_MSB] = 0x80;
+  registers[BME280_REGISTER_TEMP_LSB] = 0x00;
+  registers[BME280_REGISTER_TEMP_XLSB] = 0x00;
+  registers[BME280_REGISTER_HUM_MSB] = 0x80;
+  registers[BME280_REGISTER_HUM_LSB] = 0x00;
+
+  bme280->ctrl_hum = 0x00;
+  bme280->measuring = false;
+}
+
+/* Datasheet floating point compensation, used forward to invert the ADC values. */
+static double i2c_simulator_bme280_temperature(int32_t adc_t, double *t_fine)
+{
+  const i2c_simulator_bme280_calibration_t *c = &calibration;
+  double var1 = (((double)adc_t / 16384.0) - ((double)c->dig_t1 / 1024.0)) * (double)c->dig_t2;
+  double var2 = (((double)adc_t / 131072.0) - ((double)c->dig_t1 / 8192.0));
+
+  var2 = var2 * var2 * (double)c->dig_t3;
+  *t_fine = var1 + var2;
+
+  return (*t_fine / 5120.0);
+}
+
+static double i2c_simulator_bme280_pressure(int32_t adc_p, double t_fine)
+{
+  const i2c_simulator_bme280_calibration_t *c = &calibration;
+  double var1 = (t_fine / 2.0) - 64000.0;
+  double var2 = var1 * var1 * (double)c->dig_p6 / 32768.0;
+  double p;
+
+  var2 = var2 + var1 * (double)c->dig_p5 * 2.0;
+  var2 = (var2 / 4.0) + ((double)c->dig_p4 * 65536.0);
+  var1 = ((double)c->dig_p3 * var1 * var1 / 524288.0 + (double)c->dig_p2 * var1) / 524288.0;
+  var1 = (1.0 + var1 / 32768.0) * (double)c->dig_p1;
+
+  if (var1 == 0.0) {
+    return 0.0;
+  }
+
+  p = 1048576.0 - (double)adc_p;
+  p = (p - (var2 / 4096.0)) * 6250.0 / var1;
+  var1 = (double)c->dig_p9 * p * p / 2147483648.0;
+  var2 = p * (double)c->dig_p8 / 32768.0;
+
+  return (p + (var1 + var2 + (double)c->dig_p7) / 16.0);
+}
+
+static double i2c_simulator_bme280_humidity(int32_t adc_h, double t_fine)
+{
+  const i2c_simulator_bme280_calibration_t *c = &calibration;
+  double h = t_fine - 76800.0;
+
+  h = ((double)adc_h - ((double)c->dig_h4 * 64.0 + (double)c->dig_h5 / 16384.0 * h)) *
+      ((double)c->dig_h2 / 65536.0 * (1.0 + (double)c->dig_h6 / 67108864.0 * h *
+      (1.0 + (double)c->dig_h3 / 67108864.0 * h)));
+  h = h * (1.0 - (double)c->dig_h1 * h / 524288.0);
+
+  return h;
+}
+
+/* The compensation is monotonic in each ADC value, bisect for the closest code. */
+static int32_t i2c_simulator_bme280_adc_temperature(double temperature)
+{
+  int32_t low = 0, high = I2C_SIMULATOR_BME280_ADC_20_MAX;
+  double t_fine;
+
+  while (low < high) {
+    int32_t mid = low + ((high - low) / 2);
+    if (i2c_simulator_bme280_temperature(mid, &t_fine) < temperature) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+static int32_t i2c_simulator_bme280_adc_pressure(double pressure, double t_fine)
+{
+  int32_t low = 0, high = I2C_SIMULATOR_BME280_ADC_20_MAX;
+
+  /* Pressure falls as the ADC value rises. */
+  while (low < high) {
+    int32_t mid = low + ((high - low) / 2);
+    if (i2c_simulator_bme280_pressure(mid, t_fine) > pressure) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+static int32_t i2c_simulator_bme280_adc_humidity(double humidity, double t_fine)
+{
+  int32_t low = 0, high = I2C_SIMULATOR_BME280_ADC_16_MAX;
+
+  while (low < high) {
+    int32_t mid = low + ((high - low) / 2);
+    if (i2c_simulator_bme280_humidity(mid, t_fine) < humidity) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+/* Oversampling setting to number of samples: skipped, 1, 2, 4, 8, 16 (and above). */
+static uint32_t i2c_simulator_bme280_samples(uint8_t osrs)
+{
+  return ((osrs == 0) ? 0 : (1u << ((osrs > 5 ? 5 : osrs) - 1)));
+}
+
+/* Maximum measurement time from the datasheet, appendix B, in microseconds. */
+static int64_t i2c_simulator_bme280_measure_time_us(uint8_t ctrl_meas, uint8_t ctrl_hum)
+{
+  uint32_t osrs_t = i2c_simulator_bme280_samples((ctrl_meas >> 5) & 0x07);
+  uint32_t osrs_p = i2c_simulator_bme280_samples((ctrl_meas >> 2) & 0x07);
+  uint32_t osrs_h = i2c_simulator_bme280_samples(ctrl_hum & 0x07);
+  int64_t time_us = 1250 + (2300 * osrs_t);
+
+  time_us += (osrs_p) ? ((2300 * osrs_p) + 575) : 0;
+  time_us += (osrs_h) ? ((2300 * osrs_h) + 575) : 0;
+
+  return time_us;
+}
+
+/* Convert the environment and latch the result into the data registers. */
+static void i2c_simulator_bme280_sample(i2c_simulator_bme280_t *bme280)
+{
+  uint8_t *registers = bme280->registers;
+  uint8_t ctrl_meas = registers[BME280_REGISTER_CTRL_MEAS];
+  int32_t adc_t = I2C_SIMULATOR_BME280_ADC_20_SKIPPED;
+  int32_t adc_p = I2C_SIMULATOR_BME280_ADC_20_SKIPPED;
+  int32_t adc_h = I2C_SIMULATOR_BME280_ADC_16_SKIPPED;
+  int32_t adc_temperature = i2c_simulator_bme280_adc_temperature(bme280->environment.temperature);
+  double t_fine;
+
+  /* Pressure and humidity compensation needs t_fine even when temperature is skipped. */
+  i2c_simulator_bme280_temperature(adc_temperature, &t_fine);
+
+  if ((ctrl_meas >> 5) & 0x07) {
+    adc_t = adc_temperature;
+  }
+
+  if ((ctrl_meas >> 2) & 0x07) {
+    adc_p = i2c_simulator_bme280_adc_pressure(bme280->environment.pressure, t_fine);
+  }
+
+  if (bme280->ctrl_hum & 0x07) {
+    adc_h = i2c_simulator_bme280_adc_humidity(bme280->environment.humidity, t_fine);
+  }
+
+  registers[BME280_REGISTER_PRESS_MSB] = (uint8_t)(adc_p >> 12);
+  registers[BME280_REGISTER_PRESS_LSB] = (uint8_t)(adc_p >> 4);
+  registers[BME280_REGISTER_PRESS_XLSB] = (uint8_t)((adc_p & 0x0f) << 4);
+  registers[BME280_REGISTER_TEMP_MSB] = (uint8_t)(adc_t >> 12);
+  registers[BME280_REGISTER_TEMP_LSB] = (uint8_t)(adc_t >> 4);
+  registers[BME280_REGISTER_TEMP_XLSB] = (uint8_t)((adc_t & 0x0f) << 4);
+  registers[BME280_REGISTER_HUM_MSB] = (uint8_t)(adc_h >> 8);
+  registers[BME280_REGISTER_HUM_LSB] = (uint8_t)(adc_h & 0xff);
+}
+
+/* 
+ * Finish a forced conversion whose time has passed. Normal mode is modelled
+ * as a conversion that is always complete, t_sb is not simulated.
+ */
+static void i2c_simulator_bme280_update(i2c_simulator_bme280_t *bme280)
+{
+  uint8_t *registers = bme280->registers;
+  uint8_t mode = registers[BME280_REGISTER_CTRL_MEAS] & BME280_SETTINGS_MODE_MASK;
+
+  if ((bme280->measuring) && (esp_timer_get_time() >= bme280->measure_end_us)) {
+    i2c_simulator_bme280_sample(bme280);
+    bme280->measuring = false;
+    /* Forced mode falls back to sleep when the conversion is done. */
+    registers[BME280_REGISTER_CTRL_MEAS] &= (uint8_t)~BME280_SETTINGS_MODE_MASK;
+  } else if (mode == BME280_SETTINGS_MODE_NORMAL) {
+    i2c_simulator_bme280_sample(bme280);
+  }
+
+  registers[BME280_REGISTER_STATUS] = (bme280->measuring) ? I2C_SIMULATOR_BME280_STATUS_MEASURING : 0x00;
+}
+
+static void i2c_simulator_bme280_write(i2c_simulator_bus_t *bus, i2c_simulator_bme280_t *bme280, 
+                                       uint8_t reg, uint8_t value)
+{  uint8_t mode;
+
+  switch (reg) {
+  case BME280_REGISTER_RESET:
+    if (value == BME280_DATA_RESET) {
+      i2c_simulator_bme280_reset(bme280);
+    }
+    break;
+
+  case BME280_REGISTER_CTRL_HUM:
+    bme280->registers[reg] = (value & 0x07);
+    break;
+
+  case BME280_REGISTER_CONFIG:
+    /* Writes in normal mode may be ignored, the model always ignores them. */
+    if ((bme280->registers[BME280_REGISTER_CTRL_MEAS] & BME280_SETTINGS_MODE_MASK) != BME280_SETTINGS_MODE_NORMAL) {
+      bme280->registers[reg] = (value & 0xfd);
+    }
+    break;
+
+  case BME280_REGISTER_CTRL_MEAS:
+    /* CTRL_HUM becomes effective only after a CTRL_MEAS write. */
+    bme280->ctrl_hum = bme280->registers[BME280_REGISTER_CTRL_HUM];
+    bme280->registers[reg] = value;
+    mode = value & BME280_SETTINGS_MODE_MASK;
+    if ((mode != BME280_SETTINGS_MODE_SLEEP) && (mode != BME280_SETTINGS_MODE_NORMAL) &&
+        (!bme280->measuring)) {
+      bme280->measuring = true;
+      bme280->measure_end_us = esp_timer_get_time() +
+                               i2c_simulator_bme280_measure_time_us(value, bme280->ctrl_hum);
+      ++bus->stats.measurements;
+    }
+    break;
+
+  default:
+    /* ID, calibration, status and data registers are read-only. */
+    break;
+  }
+}
+
+/* 
+ * BME280 I2C protocol: the first byte sets the register pointer, a write
+ * continues as (register, value) pairs, a read auto-increments the pointer.
+ */
+static void i2c_simulator_bme280_transfer(i2c_simulator_bus_t *bus, i2c_simulator_bme280_t *bme280,
+                                          const uint8_t *data, size_t data_len,
+                                          uint8_t *read_data, size_t read_len)
+{
+  i2c_simulator_bme280_update(bme280);
+
+  if (data_len > 0) {
+    bme280->pointer = data[0];
+  }
+
+  if (data_len > 1) {
+    i2c_simulator_bme280_write(bus, bme280, data[0], data[1]);
+    for (size_t i = 2; (i + 1) < data_len; i += 2) {
+      i2c_simulator_bme280_write(bus, bme280, data[i], data[i + 1]);
+    }
+    i2c_simulator_bme280_update(bme280);
+  }
+
+  for (size_t i = 0; i < read_len; ++i) {
+    read_data[i] = bme280->registers[bme280->pointer++];
+  }
+}
+
+static i2c_simulator_bme280_t *i2c_simulator_bme280_find(i2c_simulator_bus_t *bus, uint8_t address)
+{
+  for (size_t i = 0; i < I2C_SIMULATOR_DEVICES_MAX; ++i) {
+    if ((bus->bme280[i].attached) && (bus->bme280[i].address == address)) {
+      return &bus->bme280[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* Nine clocks per byte plus START, repeated START and STOP. */
+static uint64_t i2c_simulator_busy_us(uint32_t clk_speed, size_t write_len, size_t read_len)
+{
+  uint64_t bits = 2 + (9 * (1 + write_len));
+
+  if (read_len > 0) {
+    bits += 1 + (9 * (1 + read_len));
+  }
+
+  return ((bits * 1000000ull) + clk_speed - 1) / clk_speed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+i2c_simulator_result_t i2c_simulator_attach_bme280(i2c_port_t i2c_num, uint8_t address)
+{
+  if ((i2c_num < 0) || (i2c_num >= I2C_NUM_MAX)) {
+    return I2C_SIMULATOR_RESULT_ERROR;
+  }
+
+  i2c_simulator_bme280_t *bme280 = i2c_simulator_bme280_find(&buses[i2c_num], address);
+
+  for (size_t i = 0; (!bme280) && (i < I2C_SIMULATOR_DEVICES_MAX); ++i) {
+    if (!buses[i2c_num].bme280[i].attached) {
+      bme280 = &buses[i2c_num].bme280[i];
+    }
+  }
+
+  if (!bme280) {
+    return I2C_SIMULATOR_RESULT_ERROR;
+  }
+
+  memset(bme280, 0, sizeof(*bme280));
+  bme280->attached = true;
+  bme280->address = address;
+  bme280->environment = (i2c_simulator_environment_t)I2C_SIMULATOR_ENVIRONMENT_DEFAULT;
+
+  i2c_simulator_bme280_calibrate(bme280->registers);
+  i2c_simulator_bme280_reset(bme280);
+
+  return I2C_SIMULATOR_RESULT_SUCCESS;
+}
+
+i2c_simulator_result_t i2c_simulator_set_environment(i2c_port_t i2c_num, uint8_t address,
+                                                     const i2c_simulator_environment_t *environment)
+{
+  if ((i2c_num < 0) || (i2c_num >= I2C_NUM_MAX) || (!environment)) {
+    return I2C_SIMULATOR_RESULT_ERROR;
+  }
+
+  i2c_simulator_bme280_t *bme280 = i2c_simulator_bme280_find(&buses[i2c_num], address);
+
+  if (!bme280) {
+    return I2C_SIMULATOR_RESULT_ERROR;
+  }
+
+  bme280->environment = *environment;
+
+  return I2C_SIMULATOR_RESULT_SUCCESS;
+}
+
+i2c_simulator_result_t i2c_simulator_inject(i2c_port_t i2c_num, const i2c_simulator_fault_t *fault)
+{
+  if ((i2c_num < 0) || (i2c_num >= I2C_NUM_MAX) || (!fault)) {
+    return I2C_SIMULATOR_RESULT_ERROR;
+  }
+
+  buses[i2c_num].fault = *fault;
+
+  return I2C_SIMULATOR_RESULT_SUCCESS;
+}
+
+i2c_simulator_result_t i2c_simulator_stats(i2c_port_t i2c_num, i2c_simulator_stats_t *stats)
+{
+  if ((i2c_num < 0) || (i2c_num >= I2C_NUM_MAX) || (!stats)) {
+    return I2C_SIMULATOR_RESULT_ERROR;
+  }
+
+  *stats = buses[i2c_num].stats;
+
+  return I2C_SIMULATOR_RESULT_SUCCESS;
+}
+
+i2c_simulator_result_t i2c_simulator_stats_reset(i2c_port_t i2c_num)
+{
+  if ((i2c_num < 0) || (i2c_num >= I2C_NUM_MAX)) {
+    return I2C_SIMULATOR_RESULT_ERROR;
+  }
+
+  memset(&buses[i2c_num].stats, 0, sizeof(buses[i2c_num].stats));
+
+  return I2C_SIMULATOR_RESULT_SUCCESS;
+}
+
+esp_err_t i2c_simulator_install(i2c_port_t i2c_num, uint32_t clk_speed)
+{
+  return i2c_simulator_set_clock(i2c_num, clk_speed);
+}
+
+esp_err_t i2c_simulator_set_clock(i2c_port_t i2c_num, uint32_t clk_speed)
+{
+  if ((i2c_num < 0) || (i2c_num >= I2C_NUM_MAX) || (clk_speed == 0)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  buses[i2c_num].clk_speed = clk_speed;
+
+  return ESP_OK;
+}
+
+esp_err_t i2c_simulator_transfer(i2c_port_t i2c_num, uint8_t address,
+                                 const uint8_t *prefix, size_t prefix_len,
+                                 const uint8_t *write_data, size_t write_len,
+                                 uint8_t *read_data, size_t read_len,
+                                 TickType_t transfer_ticks)
+{
+  if ((i2c_num < 0) || (i2c_num >= I2C_NUM_MAX) || (buses[i2c_num].clk_speed == 0)) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  i2c_simulator_bus_t *bus = &buses[i2c_num];
+  i2c_simulator_bme280_t *bme280 = i2c_simulator_bme280_find(bus, address);
+  uint8_t data[I2C_SIMULATOR_REGISTERS_SIZE];
+  uint64_t busy_us;
+  static const char *I2C_SIMULATOR_TRANSFER_TAG = "I2C_SIMULATOR_TRANSFER";
+
+  if ((prefix_len + write_len) > sizeof(data)) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  ++bus->stats.transfers;
+
+  if (bus->fault.stuck_pulses) {
+    ++bus->stats.timeouts;
+    return ESP_ERR_TIMEOUT;
+  }
+
+  busy_us = i2c_simulator_busy_us(bus->clk_speed, prefix_len + write_len, read_len) + bus->fault.delay_us;
+  bus->stats.busy_us += busy_us;
+
+  if (busy_us > ((uint64_t)transfer_ticks * portTICK_PERIOD_MS * 1000)) {
+    ++bus->stats.timeouts;
+    return ESP_ERR_TIMEOUT;
+  }
+
+  if ((bus->fault.nacks) || (!bme280)) {
+    if (bus->fault.nacks) {
+      --bus->fault.nacks;
+    }
+    ++bus->stats.nacks;
+    return ESP_FAIL;
+  }
+
+  if (prefix_len) {
+    memcpy(data, prefix, prefix_len);
+  }
+
+  if (write_len) {
+    memcpy(&data[prefix_len], write_data, write_len);
+  }
+
+  i2c_simulator_bme280_transfer(bus, bme280, data, prefix_len + write_len, read_data, read_len);
+
+  bus->stats.bytes_written += (uint32_t)(prefix_len + write_len);
+  bus->stats.bytes_read += (uint32_t)read_len;
+
+#if defined(ETHER_DEBUG)
+  ESP_LOGD(I2C_SIMULATOR_TRANSFER_TAG, "0x%02x: %u written, %u read, %u us", address,
+           (unsigned)(prefix_len + write_len), (unsigned)read_len, (unsigned)busy_us);
+#else
+  (void)I2C_SIMULATOR_TRANSFER_TAG;
+#endif
+
+  return ESP_OK;
+}
+
+bool i2c_simulator_bus_stuck(i2c_port_t i2c_num)
+{
+  if ((i2c_num < 0) || (i2c_num >= I2C_NUM_MAX)) {
+    return false;
+  }
+
+  return (buses[i2c_num].fault.stuck_pulses != 0);
+}
+
+esp_err_t i2c_simulator_bus_clear(i2c_port_t i2c_num, uint8_t pulses)
+{
+  if ((i2c_num < 0) || (i2c_num >= I2C_NUM_MAX)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  i2c_simulator_bus_t *bus = &buses[i2c_num];
+
+  ++bus->stats.recoveries;
+
+  if ((bus->fault.stuck_pulses == I2C_SIMULATOR_STUCK_FOREVER) || (bus->fault.stuck_pulses > pulses)) {
+    return ESP_FAIL;
+  }
+
+  bus->fault.stuck_pulses = 0;
+
+  return ESP_OK;
+}
+
+#endif // I2C_CONTROLLER_SIMULATOR
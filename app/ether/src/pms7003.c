@@ -25,21 +25,13 @@ pms7003_result_t pms7003_frame_send(const pms7003_callback_sent_t handler, uart_
   return PMS7003_RESULT_SUCCESS;
 }
 
-pms7003_result_t pms7003_frame_receive(const pms7003_callback_received_t handler, 
-                                       uart_port_t uart_num, pms7003_frame_answer_t *frame) 
+pms7003_result_t pms7003_frame_check(const pms7003_frame_answer_t *frame) 
 {
-  if ((!handler) || (!frame)) {
+  if (!frame) {
     return PMS7003_RESULT_ERROR;
   }
-  
-  int32_t bytes_received = handler(uart_num, frame);
-  uint16_t calculated_check_code = 0;
 
-  if (bytes_received < 0) {
-    return PMS7003_RESULT_ERROR;
-  } else if (bytes_received != PMS7003_FRAME_ANSWER_SIZE) {
-    return PMS7003_RESULT_PARTIAL_RECEIVED;
-  }
+  uint16_t calculated_check_code = 0;
 
   for (uint8_t i = 0; i < PMS7003_FRAME_CHECK_CODE_SIZE; ++i) {
     calculated_check_code += frame->buffer_answer[i];
@@ -58,16 +50,37 @@ pms7003_result_t pms7003_frame_receive(const pms7003_callback_received_t handler
   }
 }
 
-int32_t pms7003_read_request(uart_port_t uart_num) 
+pms7003_result_t pms7003_frame_measurements(const pms7003_frame_answer_t *frame, 
+                                            pms7003_measurements_t *measurements) 
 {
-  pms7003_frame_request_t frame = PMS7003_FRAME_READ;
-  return uart_write_bytes(uart_num, frame.buffer_request, PMS7003_FRAME_REQUEST_SIZE);
+  if ((!frame) || (!measurements)) {
+    return PMS7003_RESULT_ERROR;
+  }
+
+  const uint8_t *data = frame->buffer_answer + PMS7003_FRAME_DATA_OFFSET;
+
+  /* One pass over the big endian words, independent of the host byte order. */
+  for (uint8_t i = 0; i < PMS7003_DATA_WORDS; ++i) {
+    measurements->data[i] = (uint16_t)((data[2 * i] << 8) | data[(2 * i) + 1]);
+  }
+
+  return PMS7003_RESULT_SUCCESS;
 }
 
-int32_t pms7003_change_mode_passive(uart_port_t uart_num) 
+size_t pms7003_record_encode(const pms7003_measurements_t *measurements, uint8_t *buffer, size_t size) 
 {
-  pms7003_frame_request_t frame = PMS7003_FRAME_CHANGE_MODE_PASSIVE;
-  return uart_write_bytes(uart_num, frame.buffer_request, PMS7003_FRAME_REQUEST_SIZE);
+  if ((!measurements) || (!buffer) || (size < PMS7003_RECORD_SIZE)) {
+    return 0;
+  }
+
+  buffer[0] = PMS7003_RECORD_VERSION;
+
+  for (uint8_t i = 0; i < PMS7003_DATA_WORDS; ++i) {
+    buffer[1 + (2 * i)] = (uint8_t)(measurements->data[i] >> 8);
+    buffer[2 + (2 * i)] = (uint8_t)(measurements->data[i]);
+  }
+
+  return PMS7003_RECORD_SIZE;
 }
 
 int32_t pms7003_change_mode_active(uart_port_t uart_num) 
@@ -87,23 +100,3 @@ int32_t pms7003_wakeup(uart_port_t uart_num)
   pms7003_frame_request_t frame = PMS7003_FRAME_WAKEUP;
   return uart_write_bytes(uart_num, frame.buffer_request, PMS7003_FRAME_REQUEST_SIZE);
 }
-
-int32_t pms7003_read(uart_port_t uart_num, pms7003_frame_answer_t *frame) 
-{
-  int32_t length = 0;
-
-  while (1) {
-    length = uart_read_bytes(uart_num, frame->buffer_answer, 2 * PMS7003_FRAME_BYTE_SIZE, 
-                             PMS7003_UART_WAIT_TIMEOUT_MS);
-
-    if (length == 2) {
-      if ((frame->buffer_answer[0] == PMS7003_START_CHARACTER_1) && 
-          (frame->buffer_answer[1] == PMS7003_START_CHARACTER_2)) {
-        return uart_read_bytes(uart_num, frame->buffer_answer + length, 
-                               PMS7003_FRAME_ANSWER_SIZE - length, PMS7003_UART_WAIT_TIMEOUT_MS) + length;
-      }
-    }
-
-    length = 0;
-  }
-}
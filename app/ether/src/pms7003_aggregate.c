@@ -0,0 +1,87 @@
+#include "pms7003_aggregate.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+static uint16_t pms7003_aggregate_field(const pms7003_aggregate_t *aggregate, uint8_t word,
+                                        pms7003_aggregate_method_t method)
+{
+  uint16_t values[PMS7003_AGGREGATE_SIZE];
+  uint32_t sum = 0;
+
+  for (uint8_t i = 0; i < aggregate->count; ++i) {
+    uint16_t value = aggregate->samples[i].data[word];
+
+    sum += value;
+
+    /* Insertion sort, the window is short. */
+    uint8_t j = i;
+
+    for (; (j > 0) && (values[j - 1] > value); --j) {
+      values[j] = values[j - 1];
+    }
+
+    values[j] = value;
+  }
+
+  if (method == PMS7003_AGGREGATE_MEAN) {
+    return (uint16_t)((sum + (aggregate->count / 2)) / aggregate->count);
+  }
+
+  uint8_t middle = aggregate->count / 2;
+
+  if (aggregate->count & 1) {
+    return values[middle];
+  }
+
+  return (uint16_t)((values[middle - 1] + values[middle] + 1) / 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+void pms7003_aggregate_reset(pms7003_aggregate_t *aggregate)
+{
+  if (!aggregate) {
+    return;
+  }
+
+  aggregate->count = 0;
+  aggregate->dropped = 0;
+}
+
+bool pms7003_aggregate_add(pms7003_aggregate_t *aggregate, const pms7003_frame_answer_t *frame)
+{
+  if ((!aggregate) || (!frame)) {
+    return false;
+  }
+
+  if (aggregate->count >= PMS7003_AGGREGATE_SIZE) {
+    aggregate->dropped++;
+    return false;
+  }
+
+  if (pms7003_frame_measurements(frame, &aggregate->samples[aggregate->count]) != PMS7003_RESULT_SUCCESS) {
+    return false;
+  }
+
+  aggregate->count++;
+
+  return true;
+}
+
+bool pms7003_aggregate_result(const pms7003_aggregate_t *aggregate, pms7003_aggregate_method_t method,
+                              pms7003_measurements_t *measurements)
+{
+  if ((!aggregate) || (!measurements) || (aggregate->count < PMS7003_AGGREGATE_MIN_FRAMES)) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < PMS7003_DATA_WORDS; ++i) {
+    measurements->data[i] = pms7003_aggregate_field(aggregate, i, method);
+  }
+
+  return true;
+}
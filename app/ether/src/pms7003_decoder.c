@@ -0,0 +1,174 @@
+#include "pms7003_decoder.h"
+#include <stdbool.h>
+#include <string.h>
+
+/** 
+ * \brief Outcome of one decoded byte.
+ */
+typedef enum {
+  PMS7003_DECODER_STEP_NONE = 0,    /*!< Byte taken, no frame yet. */
+  PMS7003_DECODER_STEP_FRAME,       /*!< Byte completed a valid data frame. */
+  PMS7003_DECODER_STEP_FAILED,      /*!< Byte broke the frame, its bytes need a new search. */
+} pms7003_decoder_step_t;
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+static pms7003_decoder_step_t pms7003_decoder_step(pms7003_decoder_t *decoder, uint8_t byte)
+{
+  switch (decoder->state) {
+    case PMS7003_DECODER_STATE_START_1: {
+      if (byte != PMS7003_START_CHARACTER_1) {
+        decoder->skipped++;
+        break;
+      }
+
+      decoder->frame.buffer_answer[0] = byte;
+      decoder->index = 1;
+      decoder->state = PMS7003_DECODER_STATE_START_2;
+      break;
+    }
+    case PMS7003_DECODER_STATE_START_2: {
+      if (byte == PMS7003_START_CHARACTER_2) {
+        decoder->frame.buffer_answer[decoder->index++] = byte;
+        decoder->state = PMS7003_DECODER_STATE_LENGTH_H;
+      } else if (byte == PMS7003_START_CHARACTER_1) {
+        /* The previous one was not a start, this one may be. */
+        decoder->skipped++;
+      } else {
+        decoder->skipped += 2;
+        pms7003_decoder_reset(decoder);
+      }
+      break;
+    }
+    case PMS7003_DECODER_STATE_LENGTH_H: {
+      decoder->frame.buffer_answer[decoder->index++] = byte;
+      decoder->length = (uint16_t)(byte << 8);
+      decoder->state = PMS7003_DECODER_STATE_LENGTH_L;
+      break;
+    }
+    case PMS7003_DECODER_STATE_LENGTH_L: {
+      decoder->frame.buffer_answer[decoder->index++] = byte;
+      decoder->length |= byte;
+
+      /* At least the check code, at most a data frame. */
+      if ((decoder->length < sizeof(uint16_t)) || (decoder->length > PMS7003_DECODER_DATA_LENGTH)) {
+        decoder->length_errors++;
+        return PMS7003_DECODER_STEP_FAILED;
+      }
+
+      decoder->sum = (uint16_t)(PMS7003_START_CHARACTER_1 + PMS7003_START_CHARACTER_2 +
+                                decoder->frame.buffer_answer[2] + byte);
+      decoder->state = PMS7003_DECODER_STATE_PAYLOAD;
+      break;
+    }
+    case PMS7003_DECODER_STATE_PAYLOAD: {
+      uint8_t end = (uint8_t)(PMS7003_DECODER_HEADER_SIZE + decoder->length);
+
+      decoder->frame.buffer_answer[decoder->index++] = byte;
+
+      if (decoder->index <= end - sizeof(uint16_t)) {
+        decoder->sum += byte;
+      }
+
+      if (decoder->index < end) {
+        break;
+      }
+
+      uint16_t check_code = (uint16_t)((decoder->frame.buffer_answer[end - 2] << 8) |
+                                       decoder->frame.buffer_answer[end - 1]);
+
+      if (check_code != decoder->sum) {
+        decoder->check_code_errors++;
+        return PMS7003_DECODER_STEP_FAILED;
+      }
+
+      bool data = (decoder->length == PMS7003_DECODER_DATA_LENGTH);
+
+      pms7003_decoder_reset(decoder);
+
+      if (!data) {
+        decoder->ignored++;
+        break;
+      }
+
+      decoder->frames++;
+      return PMS7003_DECODER_STEP_FRAME;
+    }
+    default: {
+      pms7003_decoder_reset(decoder);
+      break;
+    }
+  }
+
+  return PMS7003_DECODER_STEP_NONE;
+}
+
+static bool pms7003_decoder_push(pms7003_decoder_t *decoder, uint8_t byte)
+{
+  pms7003_decoder_step_t step = pms7003_decoder_step(decoder, byte);
+
+  if (step != PMS7003_DECODER_STEP_FAILED) {
+    return (step == PMS7003_DECODER_STEP_FRAME);
+  }
+
+  /*
+   * Everything after the false start goes through the decoder again. It is
+   * shorter than a data frame, so no data frame can complete in here; a
+   * nested failure rewinds to the byte after its own start.
+   */
+  uint8_t pending[PMS7003_FRAME_ANSWER_SIZE];
+  size_t count = decoder->index - 1;
+
+  memcpy(pending, decoder->frame.buffer_answer + 1, count);
+  decoder->skipped++;
+  pms7003_decoder_reset(decoder);
+
+  for (size_t next = 0; next < count;) {
+    if (pms7003_decoder_step(decoder, pending[next++]) == PMS7003_DECODER_STEP_FAILED) {
+      next -= decoder->index - 1;
+      decoder->skipped++;
+      pms7003_decoder_reset(decoder);
+    }
+  }
+
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+void pms7003_decoder_reset(pms7003_decoder_t *decoder)
+{
+  if (!decoder) {
+    return;
+  }
+
+  decoder->state = PMS7003_DECODER_STATE_START_1;
+  decoder->index = 0;
+  decoder->length = 0;
+  decoder->sum = 0;
+}
+
+size_t pms7003_decoder_feed(pms7003_decoder_t *decoder, const uint8_t *data, size_t size,
+                            const pms7003_frame_answer_t **frame)
+{
+  if (frame) {
+    *frame = NULL;
+  }
+
+  if ((!decoder) || (!data) || (!frame)) {
+    return size;
+  }
+
+  for (size_t i = 0; i < size;) {
+    if (pms7003_decoder_push(decoder, data[i++])) {
+      *frame = &decoder->frame;
+      return i;
+    }
+  }
+
+  return size;
+}
@@ -0,0 +1,131 @@
+#include "pms7003_receiver.h"
+#include "esp_log.h"
+
+static const char *PMS7003_RECEIVER_TAG = "PMS7003_RECEIVER";
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+static void pms7003_receiver_drain(pms7003_receiver_t *receiver, size_t size)
+{
+  uint8_t chunk[PMS7003_RECEIVER_CHUNK_SIZE];
+  const pms7003_frame_answer_t *frame;
+
+  while (size > 0) {
+    int32_t length = uart_read_bytes(receiver->uart_num, chunk, 
+                                     (size < sizeof(chunk)) ? size : sizeof(chunk), 0);
+
+    if (length <= 0) {
+      return;
+    }
+
+    size -= length;
+
+    for (size_t offset = 0; offset < (size_t)length;) {
+      offset += pms7003_decoder_feed(&receiver->decoder, chunk + offset, length - offset, &frame);
+
+      if (!frame) {
+        continue;
+      }
+
+      /* The reader wants the recent frames, make room for this one. */
+      if (xQueueSend(receiver->frames, frame, 0) != pdTRUE) {
+        pms7003_frame_answer_t oldest;
+
+        xQueueReceive(receiver->frames, &oldest, 0);
+        xQueueSend(receiver->frames, frame, 0);
+        receiver->dropped++;
+      }
+    }
+  }
+}
+
+static void pms7003_receiver_task(void *arg)
+{
+  pms7003_receiver_t *receiver = arg;
+  uart_event_t event;
+
+  while (1) {
+    if (xQueueReceive(receiver->events, &event, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    switch (event.type) {
+      case UART_DATA: {
+        pms7003_receiver_drain(receiver, event.size);
+        break;
+      }
+      case UART_FIFO_OVF:
+      case UART_BUFFER_FULL: {
+        /* The stream has a hole, nothing buffered can complete a frame. */
+        receiver->overflows++;
+        pms7003_decoder_reset(&receiver->decoder);
+        uart_flush_input(receiver->uart_num);
+        xQueueReset(receiver->events);
+
+#if defined(ETHER_DEBUG)
+        ESP_LOGI(PMS7003_RECEIVER_TAG, "overflow = %lu", (unsigned long)receiver->overflows);
+#endif
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+pms7003_receiver_result_t pms7003_receiver_start(pms7003_receiver_t *receiver, uart_port_t uart_num,
+                                                 QueueHandle_t events)
+{
+  if ((!receiver) || (!events)) {
+    return PMS7003_RECEIVER_RESULT_ERROR;
+  }
+
+  receiver->uart_num = uart_num;
+  receiver->events = events;
+  pms7003_decoder_reset(&receiver->decoder);
+  receiver->frames = xQueueCreate(PMS7003_RECEIVER_QUEUE_SIZE, sizeof(pms7003_frame_answer_t));
+
+  if (!receiver->frames) {
+    return PMS7003_RECEIVER_RESULT_ERROR;
+  }
+
+  if (xTaskCreate(pms7003_receiver_task, "pms7003_receiver", PMS7003_RECEIVER_TASK_STACK_SIZE, receiver,
+                  PMS7003_RECEIVER_TASK_PRIORITY, &receiver->task) != pdPASS) {
+    ESP_LOGI(PMS7003_RECEIVER_TAG, "xTaskCreate failed");
+    return PMS7003_RECEIVER_RESULT_ERROR;
+  }
+
+  return PMS7003_RECEIVER_RESULT_SUCCESS;
+}
+
+pms7003_receiver_result_t pms7003_receiver_flush(pms7003_receiver_t *receiver)
+{
+  if ((!receiver) || (!receiver->frames)) {
+    return PMS7003_RECEIVER_RESULT_ERROR;
+  }
+
+  xQueueReset(receiver->frames);
+
+  return PMS7003_RECEIVER_RESULT_SUCCESS;
+}
+
+pms7003_receiver_result_t pms7003_receiver_wait(pms7003_receiver_t *receiver, pms7003_frame_answer_t *frame,
+                                                TickType_t timeout)
+{
+  if ((!receiver) || (!receiver->frames) || (!frame)) {
+    return PMS7003_RECEIVER_RESULT_ERROR;
+  }
+
+  if (xQueueReceive(receiver->frames, frame, timeout) != pdTRUE) {
+    return PMS7003_RECEIVER_RESULT_TIMEOUT;
+  }
+
+  return PMS7003_RECEIVER_RESULT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+#include "pms7003_scheduler.h"
+#include "nvs.h"
+#include "esp_log.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+static void pms7003_scheduler_save(pms7003_scheduler_t *scheduler, uint32_t on_s)
+{
+  static const char *PMS7003_SCHEDULER_SAVE_TAG = "PMS7003_SCHEDULER_SAVE";
+  nvs_handle_t handle;
+  esp_err_t result;
+
+  /* Failed or not, the next try is PMS7003_SCHEDULER_SAVE_S away. */
+  scheduler->saved_s = on_s;
+
+  result = nvs_open(PMS7003_SCHEDULER_NVS_NAMESPACE, NVS_READWRITE, &handle);
+
+  if (result != ESP_OK) {
+    ESP_LOGI(PMS7003_SCHEDULER_SAVE_TAG, "nvs_open result = 0x%x", result);
+    return;
+  }
+
+  result = nvs_set_u32(handle, PMS7003_SCHEDULER_NVS_KEY, on_s);
+
+  if (result == ESP_OK) {
+    result = nvs_commit(handle);
+  }
+
+  nvs_close(handle);
+
+  if (result != ESP_OK) {
+    ESP_LOGI(PMS7003_SCHEDULER_SAVE_TAG, "nvs_set_u32 result = 0x%x", result);
+  }
+}
+
+static void pms7003_scheduler_count(pms7003_scheduler_t *scheduler, int64_t now_ms)
+{
+  if (!scheduler->awake) {
+    return;
+  }
+
+  scheduler->on_ms += now_ms - scheduler->counted_ms;
+  scheduler->counted_ms = now_ms;
+
+  uint32_t on_s = (uint32_t)(scheduler->on_ms / 1000);
+
+  if ((on_s - scheduler->saved_s) >= PMS7003_SCHEDULER_SAVE_S) {
+    pms7003_scheduler_save(scheduler, on_s);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+void pms7003_scheduler_restore(pms7003_scheduler_t *scheduler)
+{
+  if (!scheduler) {
+    return;
+  }
+
+  nvs_handle_t handle;
+  uint32_t on_s = 0;
+
+  if (nvs_open(PMS7003_SCHEDULER_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+    return;
+  }
+
+  if (nvs_get_u32(handle, PMS7003_SCHEDULER_NVS_KEY, &on_s) == ESP_OK) {
+    scheduler->on_ms = (uint64_t)on_s * 1000;
+    scheduler->saved_s = on_s;
+  }
+
+  nvs_close(handle);
+}
+
+uint32_t pms7003_scheduler_period(const pms7003_scheduler_t *scheduler)
+{
+  if (!scheduler) {
+    return 0;
+  }
+
+  uint64_t period = scheduler->period_ms;
+
+  /* Longer than the rated life means the fan may run only part of the time. */
+  if (scheduler->service_h > PMS7003_SCHEDULER_FAN_RATED_H) {
+    uint64_t minimum = ((uint64_t)(PMS7003_SCHEDULER_WARMUP_MS + PMS7003_SCHEDULER_READ_MS) *
+                        scheduler->service_h) / PMS7003_SCHEDULER_FAN_RATED_H;
+
+    period = (minimum > period) ? minimum : period;
+  }
+
+  return (period > UINT32_MAX) ? UINT32_MAX : (uint32_t)period;
+}
+
+bool pms7003_scheduler_due(const pms7003_scheduler_t *scheduler, int64_t now_ms)
+{
+  if ((!scheduler) || (scheduler->read_ms < 0)) {
+    return true;
+  }
+
+  int64_t due = scheduler->read_ms + pms7003_scheduler_period(scheduler) -
+                pms7003_scheduler_warmup_left(scheduler, now_ms);
+
+  return (now_ms >= due);
+}
+
+uint32_t pms7003_scheduler_warmup_left(const pms7003_scheduler_t *scheduler, int64_t now_ms)
+{
+  if ((!scheduler) || (!scheduler->awake)) {
+    return PMS7003_SCHEDULER_WARMUP_MS;
+  }
+
+  int64_t running = now_ms - scheduler->wake_ms;
+
+  return (running < PMS7003_SCHEDULER_WARMUP_MS) ? (uint32_t)(PMS7003_SCHEDULER_WARMUP_MS - running) : 0;
+}
+
+void pms7003_scheduler_wakeup(pms7003_scheduler_t *scheduler, int64_t now_ms)
+{
+  if (!scheduler) {
+    return;
+  }
+
+  if (scheduler->awake) {
+    scheduler->warm_reads++;
+    return;
+  }
+
+  scheduler->awake = true;
+  scheduler->wake_ms = now_ms;
+  scheduler->counted_ms = now_ms;
+  scheduler->warmups++;
+}
+
+void pms7003_scheduler_read(pms7003_scheduler_t *scheduler, int64_t now_ms)
+{
+  if (!scheduler) {
+    return;
+  }
+
+  if (scheduler->read_ms >= 0) {
+    scheduler->cycle_ms = (uint32_t)(now_ms - scheduler->read_ms);
+  }
+
+  scheduler->read_ms = now_ms;
+
+  /* A fan kept awake never sleeps, a reset would lose all of its on-time. */
+  pms7003_scheduler_count(scheduler, now_ms);
+}
+
+bool pms7003_scheduler_keep_awake(const pms7003_scheduler_t *scheduler, int64_t now_ms)
+{
+  if ((!scheduler) || (scheduler->read_ms < 0)) {
+    return false;
+  }
+
+  uint32_t period = pms7003_scheduler_period(scheduler);
+  uint32_t spacing = (scheduler->cycle_ms > period) ? scheduler->cycle_ms : period;
+  int64_t off = scheduler->read_ms + spacing - PMS7003_SCHEDULER_WARMUP_MS - now_ms;
+
+  return (off <= PMS7003_SCHEDULER_SLEEP_MIN_MS);
+}
+
+void pms7003_scheduler_sleep(pms7003_scheduler_t *scheduler, int64_t now_ms)
+{
+  if ((!scheduler) || (!scheduler->awake)) {
+    return;
+  }
+
+  pms7003_scheduler_count(scheduler, now_ms);
+  scheduler->awake = false;
+}
+
+uint64_t pms7003_scheduler_on_time(const pms7003_scheduler_t *scheduler, int64_t now_ms)
+{
+  if (!scheduler) {
+    return 0;
+  }
+
+  return scheduler->on_ms + (scheduler->awake ? (uint64_t)(now_ms - scheduler->counted_ms) : 0);
+}
@@ -0,0 +1,132 @@
+#include "psychrometrics.h"
+
+#define PSYCHROMETRICS_TABLE_SIZE (PSYCHROMETRICS_TABLE_MAX - PSYCHROMETRICS_TABLE_MIN + 1)
+
+/* Saturation vapour pressure in 0.01 Pa, 611.2 * exp(17.62 * t / (243.12 + t)), t = -40...85 degC. */
+static const uint32_t psychrometrics_saturation[PSYCHROMETRICS_TABLE_SIZE] = {
+  1902, 2109, 2336, 2586, 2858, 3157, 3484, 3840,
+  4230, 4654, 5117, 5620, 6168, 6764, 7410, 8112,
+  8872, 9696, 10588, 11553, 12597, 13723, 14939, 16251,
+  17665, 19187, 20826, 22589, 24483, 26518, 28703, 31047,
+  33559, 36251, 39134, 42218, 45517, 49043, 52809, 56830,
+  61120, 65695, 70570, 75763, 81292, 87174, 93430, 100079,
+  107143, 114643, 122603, 131046, 139998, 149483, 159531, 170167,
+  181423, 193327, 205913, 219212, 233260, 248090, 263742, 280251,
+  297659, 316006, 335334, 355689, 377115, 399660, 423372, 448303,
+  474505, 502031, 530939, 561284, 593128, 626531, 661558, 698274,
+  736746, 777044, 819241, 863409, 909627, 957971, 1008523, 1061367,
+  1116588, 1174274, 1234516, 1297407, 1363042, 1431521, 1502945, 1577416,
+  1655043, 1735933, 1820201, 1907960, 1999329, 2094429, 2193384, 2296322,
+  2403374, 2514671, 2630353, 2750558, 2875431, 3005117, 3139768, 3279536,
+  3424580, 3575059, 3731139, 3892987, 4060774, 4234677, 4414874, 4601548,
+  4794885, 4995078, 5202319, 5416808, 5638748, 5868344,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+/* Temperature in 0.01 degC to saturation vapour pressure in 0.01 Pa. */
+static int64_t psychrometrics_vapour_pressure(int32_t temperature)
+{
+  int32_t offset = temperature - (PSYCHROMETRICS_TABLE_MIN * 100);
+
+  if (offset <= 0) {
+    return psychrometrics_saturation[0];
+  }
+
+  if (offset >= ((PSYCHROMETRICS_TABLE_SIZE - 1) * 100)) {
+    return psychrometrics_saturation[PSYCHROMETRICS_TABLE_SIZE - 1];
+  }
+
+  int32_t index = offset / 100;
+  int64_t low = psychrometrics_saturation[index];
+  int64_t high = psychrometrics_saturation[index + 1];
+
+  return low + (((high - low) * (offset % 100)) / 100);
+}
+
+/* Vapour pressure in 0.01 Pa to the temperature it saturates at, in 0.01 degC. */
+static int32_t psychrometrics_dew_point(int64_t vapour_pressure)
+{
+  int32_t low = 0;
+  int32_t high = PSYCHROMETRICS_TABLE_SIZE - 1;
+
+  if (vapour_pressure <= psychrometrics_saturation[low]) {
+    return PSYCHROMETRICS_TABLE_MIN * 100;
+  }
+
+  if (vapour_pressure >= psychrometrics_saturation[high]) {
+    return PSYCHROMETRICS_TABLE_MAX * 100;
+  }
+
+  while ((high - low) > 1) {
+    int32_t middle = (low + high) / 2;
+
+    if (psychrometrics_saturation[middle] <= vapour_pressure) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+
+  int64_t step = psychrometrics_saturation[high] - psychrometrics_saturation[low];
+
+  return ((PSYCHROMETRICS_TABLE_MIN + low) * 100) + 
+         (int32_t)(((vapour_pressure - psychrometrics_saturation[low]) * 100) / step);
+}
+
+/* NWS heat index: Steadman below 80 degF, the Rothfusz regression above. */
+static int32_t psychrometrics_heat_index(int32_t temperature, int32_t humidity)
+{
+  float t = (((float)temperature / 100.0f) * 1.8f) + 32.0f;
+  float rh = (float)humidity / 1024.0f;
+  float hi = 0.5f * (t + 61.0f + ((t - 68.0f) * 1.2f) + (rh * 0.094f));
+
+  if (((hi + t) / 2.0f) >= 80.0f) {
+    hi = -42.379f + (2.04901523f * t) + (10.14333127f * rh) - (0.22475541f * t * rh) - 
+         (0.00683783f * t * t) - (0.05481717f * rh * rh) + (0.00122874f * t * t * rh) + 
+         (0.00085282f * t * rh * rh) - (0.00000199f * t * t * rh * rh);
+  } else {
+    hi = (hi + t) / 2.0f;
+  }
+
+  return (int32_t)((((hi - 32.0f) / 1.8f) * 100.0f) + ((hi >= 32.0f) ? 0.5f : -0.5f));
+}
+
+/* Hypsometric reduction, exp(x) by its series, x stays below 0.2 up to ~1500 m. */
+static int32_t psychrometrics_sea_level(int32_t pressure, int32_t temperature, int32_t altitude_m)
+{
+  /* Mean temperature of the air column under the sensor, standard lapse rate. */
+  float column = ((float)temperature / 100.0f) + 273.15f + (0.0065f * 0.5f * (float)altitude_m);
+  float x = (float)altitude_m / (29.27f * column);
+  float factor = 1.0f + x + ((x * x) / 2.0f) + ((x * x * x) / 6.0f);
+
+  return (int32_t)(((float)pressure * factor) + 0.5f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+psychrometrics_result_t psychrometrics_compute(const bme280_sample_t *sample, int32_t altitude_m, 
+                                               psychrometrics_t *psychrometrics)
+{
+  if ((!sample) || (!psychrometrics)) {
+    return PSYCHROMETRICS_RESULT_ERROR;
+  }
+
+  int32_t temperature = sample->temperature;
+  int32_t humidity = (sample->humidity > (100 * 1024)) ? (100 * 1024) : sample->humidity;
+  /* Partial pressure of the vapour: e = es(T) * RH / 100. */
+  int64_t vapour_pressure = (psychrometrics_vapour_pressure(temperature) * humidity) / (100 * 1024);
+
+  psychrometrics->dew_point = psychrometrics_dew_point(vapour_pressure);
+  /* rho = e / (Rv * T), Rv = 461.5 J/(kg K): 0.01 g/m3 = e[0.01 Pa] * 216.68 / T[0.01 K] / 100. */
+  psychrometrics->absolute_humidity = (int32_t)((vapour_pressure * 21668) / 
+                                                ((int64_t)(temperature + 27315) * 100));
+  psychrometrics->heat_index = psychrometrics_heat_index(temperature, humidity);
+  psychrometrics->sea_level_pressure = psychrometrics_sea_level(sample->pressure, temperature, altitude_m);
+
+  return PSYCHROMETRICS_RESULT_SUCCESS;
+}
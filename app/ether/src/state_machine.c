@@ -8,7 +8,7 @@ bme280_result_t state_machine_bme280_init(ether_t *ether)
     return BME280_RESULT_ERROR;
   }
 
-  bme280_result_t result = bme280_init(ether->descriptor.i2c_controller.i2c_num, &ether->settings.bme280);
+  bme280_result_t result = bme280_init(&ether->descriptor.bme280);
 
 #if defined(ETHER_DEBUG)
   ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_INIT");
@@ -31,7 +31,7 @@ bme280_result_t state_machine_bme280_reset(ether_t *ether)
     return BME280_RESULT_ERROR;
   }
 
-  bme280_result_t result = bme280_reset(ether->descriptor.i2c_controller.i2c_num);
+  bme280_result_t result = bme280_reset(&ether->descriptor.bme280);
 
 #if defined(ETHER_DEBUG)
   ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_RESET");
@@ -55,7 +55,7 @@ bme280_result_t state_machine_bme280_id(ether_t *ether)
   }
 
   uint8_t data = 0;
-  bme280_result_t result = bme280_id(ether->descriptor.i2c_controller.i2c_num, &data, sizeof(data));
+  bme280_result_t result = bme280_id(&ether->descriptor.bme280, &data, sizeof(data));
 
 #if defined(ETHER_DEBUG)
   ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_ID");
@@ -66,6 +66,13 @@ bme280_result_t state_machine_bme280_id(ether_t *ether)
     return BME280_RESULT_ERROR;
   }
 
+  /* A sensor seen before gets its calibration from RTC memory or NVS, not from the bus. */
+  if (bme280_cache_load(&ether->descriptor.bme280, data) == BME280_CACHE_RESULT_SUCCESS) {
+    ether->state_machine.bme280 = (bme280_continuous(&ether->descriptor.bme280)) ? 
+                                  BME280_STATE_MEASURE_ALL : BME280_STATE_FORCE_MODE;
+    return BME280_RESULT_SUCCESS;
+  }
+
   ether->state_machine.bme280 = BME280_STATE_GET_COMPENSATION_DATA;
 
   return BME280_RESULT_SUCCESS;
@@ -78,7 +85,7 @@ bme280_result_t state_machine_bme280_force_mode(ether_t *ether)
     return BME280_RESULT_ERROR;
   }
 
-  bme280_result_t result = bme280_force_mode(ether->descriptor.i2c_controller.i2c_num, &ether->settings.bme280);
+  bme280_result_t result = bme280_force_mode(&ether->descriptor.bme280);
 
 #if defined(ETHER_DEBUG)
   ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_FORCE_MODE");
@@ -89,47 +96,48 @@ bme280_result_t state_machine_bme280_force_mode(ether_t *ether)
     return BME280_RESULT_ERROR;
   }
 
-  ether->state_machine.bme280 = BME280_STATE_MEASURE_HUMIDITY;
+  ether->state_machine.bme280 = BME280_STATE_WAIT;
 
   return BME280_RESULT_SUCCESS;
 }
 
 
-bme280_result_t state_machine_bme280_measure_humidity(ether_t *ether)
+bme280_result_t state_machine_bme280_wait(ether_t *ether)
 {
   if (!ether) {
     return BME280_RESULT_ERROR;
   }
 
-  bme280_result_t result = bme280_measure_humidity(ether->descriptor.i2c_controller.i2c_num, 
-                                                   &ether->measurements.bme280.humidity);
+  bme280_result_t result = bme280_wait(&ether->descriptor.bme280);
 
 #if defined(ETHER_DEBUG)
-  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_MEASURE_HUMIDITY");
+  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_WAIT");
   ESP_LOGI(STATE_MACHINE_TAG, "RESULT: %d", result);
 #endif
 
   if (result != BME280_RESULT_SUCCESS) {
+    /* The conversion never ended, trigger a new one. */
+    ether->state_machine.bme280 = BME280_STATE_FORCE_MODE;
     return BME280_RESULT_ERROR;
   }
 
-  ether->state_machine.bme280 = BME280_STATE_MEASURE_TEMPERATURE;
+  ether->state_machine.bme280 = BME280_STATE_MEASURE_ALL;
 
   return BME280_RESULT_SUCCESS;
 }
 
 
-bme280_result_t state_machine_bme280_measure_temperature(ether_t *ether)
+bme280_result_t state_machine_bme280_measure_humidity(ether_t *ether)
 {
   if (!ether) {
     return BME280_RESULT_ERROR;
   }
 
-  bme280_result_t result = bme280_measure_temperature(ether->descriptor.i2c_controller.i2c_num, 
-                                                      &ether->measurements.bme280.temperature);
+  bme280_result_t result = bme280_measure_humidity(&ether->descriptor.bme280, 
+                                                   &ether->measurements.bme280.humidity);
 
 #if defined(ETHER_DEBUG)
-  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_MEASURE_TEMPERATURE");
+  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_MEASURE_HUMIDITY");
   ESP_LOGI(STATE_MACHINE_TAG, "RESULT: %d", result);
 #endif
 
@@ -137,23 +145,23 @@ bme280_result_t state_machine_bme280_measure_temperature(ether_t *ether)
     return BME280_RESULT_ERROR;
   }
 
-  ether->state_machine.bme280 = BME280_STATE_MEASURE_PRESSURE;
+  ether->state_machine.bme280 = BME280_STATE_MEASURE_TEMPERATURE;
 
   return BME280_RESULT_SUCCESS;
 }
 
 
-bme280_result_t state_machine_bme280_measure_pressure(ether_t *ether)
+bme280_result_t state_machine_bme280_measure_temperature(ether_t *ether)
 {
   if (!ether) {
     return BME280_RESULT_ERROR;
   }
 
-  bme280_result_t result = bme280_measure_pressure(ether->descriptor.i2c_controller.i2c_num, 
-                                                   &ether->measurements.bme280.pressure);
+  bme280_result_t result = bme280_measure_temperature(&ether->descriptor.bme280, 
+                                                      &ether->measurements.bme280.temperature);
 
 #if defined(ETHER_DEBUG)
-  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_MEASURE_PRESSURE");
+  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_MEASURE_TEMPERATURE");
   ESP_LOGI(STATE_MACHINE_TAG, "RESULT: %d", result);
 #endif
 
@@ -161,23 +169,23 @@ bme280_result_t state_machine_bme280_measure_pressure(ether_t *ether)
     return BME280_RESULT_ERROR;
   }
 
-  ether->state_machine.bme280 = BME280_STATE_COMPENSATE_HUMIDITY;
+  ether->state_machine.bme280 = BME280_STATE_MEASURE_PRESSURE;
 
   return BME280_RESULT_SUCCESS;
 }
 
 
-bme280_result_t state_machine_bme280_get_compensation_data(ether_t *ether)
+bme280_result_t state_machine_bme280_measure_pressure(ether_t *ether)
 {
   if (!ether) {
     return BME280_RESULT_ERROR;
   }
 
-  bme280_result_t result = bme280_get_compensation_data(ether->descriptor.i2c_controller.i2c_num, 
-                                                        &ether->measurements.bme280.compensator);
+  bme280_result_t result = bme280_measure_pressure(&ether->descriptor.bme280, 
+                                                   &ether->measurements.bme280.pressure);
 
 #if defined(ETHER_DEBUG)
-  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_GET_COMPENSATION_DATA");
+  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_MEASURE_PRESSURE");
   ESP_LOGI(STATE_MACHINE_TAG, "RESULT: %d", result);
 #endif
 
@@ -185,23 +193,23 @@ bme280_result_t state_machine_bme280_get_compensation_data(ether_t *ether)
     return BME280_RESULT_ERROR;
   }
 
-  ether->state_machine.bme280 = BME280_STATE_FORCE_MODE;
+  ether->state_machine.bme280 = BME280_STATE_COMPENSATE;
 
   return BME280_RESULT_SUCCESS;
 }
 
 
-bme280_result_t state_machine_bme280_compensate_humidity(ether_t *ether)
+bme280_result_t state_machine_bme280_measure_all(ether_t *ether)
 {
   if (!ether) {
     return BME280_RESULT_ERROR;
   }
 
-  bme280_result_t result = bme280_compensate_humidity(&ether->measurements.bme280.compensator, 
-                                                      &ether->measurements.bme280.humidity);
+  bme280_result_t result = bme280_measure_all(&ether->descriptor.bme280, 
+                                              &ether->measurements.bme280);
 
 #if defined(ETHER_DEBUG)
-  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_COMPENSATE_HUMIDITY");
+  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_MEASURE_ALL");
   ESP_LOGI(STATE_MACHINE_TAG, "RESULT: %d", result);
 #endif
 
@@ -209,23 +217,27 @@ bme280_result_t state_machine_bme280_compensate_humidity(ether_t *ether)
     return BME280_RESULT_ERROR;
   }
 
-  ether->state_machine.bme280 = BME280_STATE_COMPENSATE_TEMPERATURE;
+  ether->state_machine.bme280 = BME280_STATE_COMPENSATE;
 
   return BME280_RESULT_SUCCESS;
 }
 
 
-bme280_result_t state_machine_bme280_compensate_temperature(ether_t *ether)
+bme280_result_t state_machine_bme280_get_compensation_data(ether_t *ether)
 {
   if (!ether) {
     return BME280_RESULT_ERROR;
   }
 
-  bme280_result_t result = bme280_compensate_temperature(&ether->measurements.bme280.compensator, 
-                                                         &ether->measurements.bme280.temperature);
+  uint8_t data[BME280_SIZE_COMP];
+  bme280_result_t result = bme280_read_calibration(&ether->descriptor.bme280, data, sizeof(data));
+
+  if (result == BME280_RESULT_SUCCESS) {
+    result = bme280_parse_calibration(data, sizeof(data), &ether->descriptor.bme280.compensator);
+  }
 
 #if defined(ETHER_DEBUG)
-  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_COMPENSATE_TEMPERATURE");
+  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_GET_COMPENSATION_DATA");
   ESP_LOGI(STATE_MACHINE_TAG, "RESULT: %d", result);
 #endif
 
@@ -233,23 +245,31 @@ bme280_result_t state_machine_bme280_compensate_temperature(ether_t *ether)
     return BME280_RESULT_ERROR;
   }
 
-  ether->state_machine.bme280 = BME280_STATE_COMPENSATE_PRESSURE;
+  /* Not fatal, the next boot reads the sensor again. */
+  if (bme280_cache_store(&ether->descriptor.bme280, BME280_DATA_ID, data, 
+                         sizeof(data)) != BME280_CACHE_RESULT_SUCCESS) {
+    ESP_LOGI(STATE_MACHINE_TAG, "bme280_cache_store failed");
+  }
+
+  /* In normal mode the sensor converts on its own, there is nothing to trigger. */
+  ether->state_machine.bme280 = (bme280_continuous(&ether->descriptor.bme280)) ? 
+                                BME280_STATE_MEASURE_ALL : BME280_STATE_FORCE_MODE;
 
   return BME280_RESULT_SUCCESS;
 }
 
 
-bme280_result_t state_machine_bme280_compensate_pressure(ether_t *ether)
+bme280_result_t state_machine_bme280_compensate(ether_t *ether)
 {
   if (!ether) {
     return BME280_RESULT_ERROR;
   }
 
-  bme280_result_t result = bme280_compensate_pressure(&ether->measurements.bme280.compensator, 
-                                                      &ether->measurements.bme280.pressure);
+  bme280_result_t result = bme280_compensate(&ether->descriptor.bme280, 
+                                             &ether->measurements.bme280);
 
 #if defined(ETHER_DEBUG)
-  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_COMPENSATE_PRESSURE");
+  ESP_LOGI(STATE_MACHINE_TAG, "BME280_STATE_COMPENSATE");
   ESP_LOGI(STATE_MACHINE_TAG, "RESULT: %d", result);
 #endif
 
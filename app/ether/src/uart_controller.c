@@ -1,13 +1,15 @@
 #include "uart_controller.h"
 
-uart_controller_result_t uart_controller_init(const uart_controller_descriptor_t *uart_controller_descriptor) 
+uart_controller_result_t uart_controller_init(uart_controller_descriptor_t *uart_controller_descriptor) 
 {
   if (!uart_controller_descriptor) {
     return UART_CONTROLLER_RESULT_ERROR;
   }
 
-  uart_driver_install(uart_controller_descriptor->uart_port, 
-                      UART_CONTROLLER_RX_BUF_SIZE * 2, 0, 0, NULL, 0);
+  if (uart_driver_install(uart_controller_descriptor->uart_port, UART_CONTROLLER_RX_BUF_SIZE * 2, 0, 
+                          UART_CONTROLLER_EVENT_QUEUE_SIZE, &uart_controller_descriptor->event_queue, 0) != ESP_OK) {
+    return UART_CONTROLLER_RESULT_ERROR;
+  }
 
   uart_param_config(uart_controller_descriptor->uart_port, 
                     &uart_controller_descriptor->uart_config);
@@ -15,5 +17,9 @@ uart_controller_result_t uart_controller_init(const uart_controller_descriptor_t
   uart_set_pin(uart_controller_descriptor->uart_port, UART_CONTROLLER_TX_PIN, 
                UART_CONTROLLER_RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
 
+  /* A whole PMS7003 frame or the end of a burst wakes the reader, not every byte. */
+  uart_set_rx_full_threshold(uart_controller_descriptor->uart_port, UART_CONTROLLER_RX_FULL_THRESHOLD);
+  uart_set_rx_timeout(uart_controller_descriptor->uart_port, UART_CONTROLLER_RX_TIMEOUT);
+
   return UART_CONTROLLER_RESULT_SUCCESS;
 }
@@ -0,0 +1,547 @@
+#include "host_shim.h"
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define HOST_SHIM_NVS_ENTRIES     (16)    /*!< Keys kept by the in-memory NVS. */
+#define HOST_SHIM_NVS_VALUE_SIZE  (128)   /*!< Largest blob. */
+#define HOST_SHIM_NVS_NAMESPACES  (8)     /*!< Namespaces, a handle is an index + 1. */
+
+/**
+ * \brief Structure behind a queue handle.
+ */
+struct host_shim_queue {
+  uint8_t *storage;     /*!< length * item_size bytes. */
+  size_t item_size;     /*!< Size of one item. */
+  size_t length;        /*!< Items the queue holds. */
+  size_t head;          /*!< Index of the oldest item. */
+  size_t count;         /*!< Items queued. */
+};
+
+/**
+ * \brief Structure for the one task there is.
+ */
+struct host_shim_task {
+  uint32_t notifications[configTASK_NOTIFICATION_ARRAY_ENTRIES];  /*!< Notification values. */
+  bool pending[configTASK_NOTIFICATION_ARRAY_ENTRIES];            /*!< Notification waiting. */
+};
+
+/**
+ * \brief Structure for a key of the in-memory NVS.
+ */
+typedef struct {
+  bool used;                                  /*!< Entry holds a key. */
+  uint8_t space;                              /*!< Namespace index. */
+  char key[NVS_KEY_NAME_MAX_SIZE];            /*!< Key name. */
+  size_t length;                              /*!< Value length. */
+  uint8_t value[HOST_SHIM_NVS_VALUE_SIZE];    /*!< Value bytes, u32 little endian. */
+} host_shim_nvs_entry_t;
+
+esp_log_level_t host_shim_log_level = ESP_LOG_WARN;
+esp_sleep_wakeup_cause_t host_shim_wakeup_cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+
+static int64_t host_shim_clock_us;
+static struct host_shim_task host_shim_task;
+static char host_shim_nvs_spaces[HOST_SHIM_NVS_NAMESPACES][NVS_KEY_NAME_MAX_SIZE];
+static host_shim_nvs_entry_t host_shim_nvs[HOST_SHIM_NVS_ENTRIES];
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+/* Nothing else runs, a wait that can't be satisfied just lets its time pass. */
+static BaseType_t host_shim_timeout(TickType_t ticks)
+{
+  if (ticks == portMAX_DELAY) {
+    fprintf(stderr, "host shim: waiting forever with a single task\n");
+    abort();
+  }
+
+  vTaskDelay(ticks);
+
+  return pdFALSE;
+}
+
+static host_shim_nvs_entry_t *host_shim_nvs_find(nvs_handle_t handle, const char *key)
+{
+  for (size_t i = 0; i < HOST_SHIM_NVS_ENTRIES; ++i) {
+    if ((host_shim_nvs[i].used) && (host_shim_nvs[i].space == (handle - 1)) &&
+        (strncmp(host_shim_nvs[i].key, key, NVS_KEY_NAME_MAX_SIZE) == 0)) {
+      return &host_shim_nvs[i];
+    }
+  }
+
+  return NULL;
+}
+
+static esp_err_t host_shim_nvs_set(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+  host_shim_nvs_entry_t *entry = host_shim_nvs_find(handle, key);
+
+  if ((handle == 0) || (handle > HOST_SHIM_NVS_NAMESPACES) || (length > HOST_SHIM_NVS_VALUE_SIZE) ||
+      (strlen(key) >= NVS_KEY_NAME_MAX_SIZE)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  for (size_t i = 0; (!entry) && (i < HOST_SHIM_NVS_ENTRIES); ++i) {
+    if (!host_shim_nvs[i].used) {
+      entry = &host_shim_nvs[i];
+    }
+  }
+
+  if (!entry) {
+    return ESP_ERR_NVS_NO_FREE_PAGES;
+  }
+
+  entry->used = true;
+  entry->space = (uint8_t)(handle - 1);
+  strncpy(entry->key, key, sizeof(entry->key) - 1);
+  entry->length = length;
+  memcpy(entry->value, value, length);
+
+  return ESP_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+void host_shim_advance_us(int64_t us)
+{
+  host_shim_clock_us += us;
+}
+
+void host_shim_nvs_erase(void)
+{
+  memset(host_shim_nvs_spaces, 0, sizeof(host_shim_nvs_spaces));
+  memset(host_shim_nvs, 0, sizeof(host_shim_nvs));
+}
+
+uint64_t host_shim_wall_ns(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return ((uint64_t)now.tv_sec * 1000000000ull) + (uint64_t)now.tv_nsec;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  host_shim_clock_us += (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+  return (TickType_t)(host_shim_clock_us / (portTICK_PERIOD_MS * 1000));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+  return &host_shim_task;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+  (void)task;
+}
+
+/* There is no scheduler to run a second task, anything that needs one fails as if out of memory. */
+BaseType_t xTaskCreate(void (*function)(void *), const char *name, uint32_t stack_size, void *arg,
+                       UBaseType_t priority, TaskHandle_t *task)
+{
+  (void)function;
+  (void)name;
+  (void)stack_size;
+  (void)arg;
+  (void)priority;
+  (void)task;
+
+  return pdFAIL;
+}
+
+BaseType_t xTaskNotifyIndexed(TaskHandle_t task, UBaseType_t index, uint32_t value, eNotifyAction action)
+{
+  if ((!task) || (index >= configTASK_NOTIFICATION_ARRAY_ENTRIES)) {
+    return pdFAIL;
+  }
+
+  switch (action) {
+    case eSetBits: {
+      task->notifications[index] |= value;
+      break;
+    }
+    case eIncrement: {
+      task->notifications[index]++;
+      break;
+    }
+    case eSetValueWithOverwrite:
+    case eSetValueWithoutOverwrite: {
+      task->notifications[index] = value;
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+
+  task->pending[index] = true;
+
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyWaitIndexed(UBaseType_t index, uint32_t clear_on_entry, uint32_t clear_on_exit,
+                                  uint32_t *value, TickType_t ticks)
+{
+  struct host_shim_task *task = &host_shim_task;
+
+  if (index >= configTASK_NOTIFICATION_ARRAY_ENTRIES) {
+    return pdFAIL;
+  }
+
+  if (!task->pending[index]) {
+    task->notifications[index] &= ~clear_on_entry;
+    return host_shim_timeout(ticks);
+  }
+
+  if (value) {
+    *value = task->notifications[index];
+  }
+
+  task->notifications[index] &= ~clear_on_exit;
+  task->pending[index] = false;
+
+  return pdTRUE;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  return xTaskNotifyIndexed(task, 0, 0, eIncrement);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+  struct host_shim_task *task = &host_shim_task;
+  uint32_t value = task->notifications[0];
+
+  if (value == 0) {
+    host_shim_timeout(ticks);
+    return 0;
+  }
+
+  task->notifications[0] = (clear) ? 0 : (value - 1);
+  task->pending[0] = (task->notifications[0] != 0);
+
+  return value;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+  SemaphoreHandle_t semaphore = calloc(1, sizeof(*semaphore));
+
+  if (semaphore) {
+    semaphore->max = 1;
+  }
+
+  return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+  SemaphoreHandle_t semaphore = xSemaphoreCreateBinary();
+
+  if (semaphore) {
+    semaphore->count = 1;
+  }
+
+  return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+  if (!buffer) {
+    return NULL;
+  }
+
+  buffer->count = 1;
+  buffer->max = 1;
+
+  return buffer;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+  if (!semaphore) {
+    return pdFALSE;
+  }
+
+  if (semaphore->count == 0) {
+    return host_shim_timeout(ticks);
+  }
+
+  semaphore->count--;
+
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+  if ((!semaphore) || (semaphore->count >= semaphore->max)) {
+    return pdFALSE;
+  }
+
+  semaphore->count++;
+
+  return pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+  QueueHandle_t queue = calloc(1, sizeof(*queue));
+
+  if (!queue) {
+    return NULL;
+  }
+
+  queue->storage = calloc(length, item_size);
+  queue->item_size = item_size;
+  queue->length = length;
+
+  if (!queue->storage) {
+    free(queue);
+    return NULL;
+  }
+
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+  if (queue) {
+    free(queue->storage);
+    free(queue);
+  }
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+  if (!queue) {
+    return pdFALSE;
+  }
+
+  if (queue->count == queue->length) {
+    return host_shim_timeout(ticks);
+  }
+
+  memcpy(&queue->storage[((queue->head + queue->count) % queue->length) * queue->item_size], item,
+         queue->item_size);
+  queue->count++;
+
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+  if (xQueuePeek(queue, item, ticks) != pdTRUE) {
+    return pdFALSE;
+  }
+
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+
+  return pdTRUE;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+  if (!queue) {
+    return pdFALSE;
+  }
+
+  if (queue->count == 0) {
+    return host_shim_timeout(ticks);
+  }
+
+  memcpy(item, &queue->storage[queue->head * queue->item_size], queue->item_size);
+
+  return pdTRUE;
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item)
+{
+  if (!queue) {
+    return pdFALSE;
+  }
+
+  xQueueReset(queue);
+
+  return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+  if (queue) {
+    queue->head = 0;
+    queue->count = 0;
+  }
+
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+  return (queue) ? (UBaseType_t)queue->count : 0;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+  (void)tag;
+  (void)level;
+}
+
+int64_t esp_timer_get_time(void)
+{
+  return host_shim_clock_us;
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+  host_shim_clock_us += us;
+}
+
+/* The real counter where there is one, nanoseconds elsewhere. */
+uint32_t esp_cpu_get_cycle_count(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return (uint32_t)__rdtsc();
+#else
+  return (uint32_t)host_shim_wall_ns();
+#endif
+}
+
+/* CRC-32/ISO-HDLC, what the ROM's crc32_le computes. */
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+  crc = ~crc;
+
+  for (uint32_t i = 0; i < length; ++i) {
+    crc ^= data[i];
+
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1u)));
+    }
+  }
+
+  return ~crc;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void)
+{
+  return host_shim_wakeup_cause;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+  return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+  host_shim_nvs_erase();
+
+  return ESP_OK;
+}
+
+/* Like the real one, a namespace opened read-only must exist already. */
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle)
+{
+  if ((!name) || (!handle) || (strlen(name) >= NVS_KEY_NAME_MAX_SIZE)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  for (size_t i = 0; i < HOST_SHIM_NVS_NAMESPACES; ++i) {
+    if (strcmp(host_shim_nvs_spaces[i], name) == 0) {
+      *handle = (nvs_handle_t)(i + 1);
+      return ESP_OK;
+    }
+  }
+
+  if (mode == NVS_READONLY) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+
+  for (size_t i = 0; i < HOST_SHIM_NVS_NAMESPACES; ++i) {
+    if (host_shim_nvs_spaces[i][0] == '\0') {
+      strncpy(host_shim_nvs_spaces[i], name, NVS_KEY_NAME_MAX_SIZE - 1);
+      *handle = (nvs_handle_t)(i + 1);
+      return ESP_OK;
+    }
+  }
+
+  return ESP_ERR_NVS_NO_FREE_PAGES;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+  (void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+  (void)handle;
+
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length)
+{
+  const host_shim_nvs_entry_t *entry = host_shim_nvs_find(handle, key);
+
+  if (!length) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (!entry) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+
+  if (!value) {
+    *length = entry->length;
+    return ESP_OK;
+  }
+
+  if (*length < entry->length) {
+    return ESP_ERR_NVS_INVALID_LENGTH;
+  }
+
+  memcpy(value, entry->value, entry->length);
+  *length = entry->length;
+
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+  return host_shim_nvs_set(handle, key, value, length);
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value)
+{
+  const host_shim_nvs_entry_t *entry = host_shim_nvs_find(handle, key);
+
+  if ((!entry) || (entry->length != sizeof(*value))) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+
+  memcpy(value, entry->value, sizeof(*value));
+
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+  return host_shim_nvs_set(handle, key, &value, sizeof(value));
+}
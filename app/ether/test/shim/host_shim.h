@@ -0,0 +1,336 @@
+#ifndef TEST_SHIM_HOST_SHIM_H
+#define TEST_SHIM_HOST_SHIM_H
+
+/*
+ * ESP-IDF and FreeRTOS stand-ins for building the firmware modules on a
+ * Linux host. There is one task and no scheduler: time is virtual, it moves
+ * only when the code waits (vTaskDelay, esp_rom_delay_us, a timeout running
+ * out) or when a test advances it. Types the modules only carry around,
+ * e.g. the MQTT and WIFI configurations, are declared and nothing more.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* esp_err.h */
+typedef int esp_err_t;
+
+#define ESP_OK                          (0)
+#define ESP_FAIL                        (-1)
+#define ESP_ERR_NO_MEM                  (0x101)
+#define ESP_ERR_INVALID_ARG             (0x102)
+#define ESP_ERR_INVALID_STATE           (0x103)
+#define ESP_ERR_INVALID_SIZE            (0x104)
+#define ESP_ERR_NOT_FOUND               (0x105)
+#define ESP_ERR_TIMEOUT                 (0x107)
+#define ESP_ERR_INVALID_CRC             (0x109)
+#define ESP_ERR_NVS_NOT_FOUND           (0x1102)
+#define ESP_ERR_NVS_NO_FREE_PAGES       (0x110d)
+#define ESP_ERR_NVS_INVALID_LENGTH      (0x110c)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND   (0x1110)
+
+#define ESP_ERROR_CHECK(x)              ((void)(x))
+
+/* esp_attr.h */
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+#define BIT0  (1 << 0)
+#define BIT1  (1 << 1)
+
+/* FreeRTOS, at the tick rate of the firmware's sdkconfig. */
+typedef uint32_t TickType_t;
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+
+#define configTICK_RATE_HZ                      (100)
+#define configMAX_PRIORITIES                    (25)
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES   (2)
+#define tskIDLE_PRIORITY                        (0)
+
+#define portTICK_PERIOD_MS    (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY         ((TickType_t)0xffffffff)
+#define pdMS_TO_TICKS(ms)     ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTICKS_TO_MS(ticks)  ((uint32_t)(((uint64_t)(ticks) * 1000) / configTICK_RATE_HZ))
+#define pdTRUE                (1)
+#define pdFALSE               (0)
+#define pdPASS                (1)
+#define pdFAIL                (0)
+
+typedef enum {
+  eNoAction = 0,
+  eSetBits,
+  eIncrement,
+  eSetValueWithOverwrite,
+  eSetValueWithoutOverwrite,
+} eNotifyAction;
+
+/**
+ * \brief Structure behind a semaphore or mutex, also its static storage.
+ */
+typedef struct {
+  UBaseType_t count;    /*!< Takes left. */
+  UBaseType_t max;      /*!< Count of a full semaphore. */
+} StaticSemaphore_t;
+
+typedef StaticSemaphore_t *SemaphoreHandle_t;
+typedef struct host_shim_queue *QueueHandle_t;
+typedef struct host_shim_task *TaskHandle_t;
+typedef void *EventGroupHandle_t;
+
+typedef struct {
+  int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED  { 0 }
+#define portENTER_CRITICAL(mux)       ((void)(mux))
+#define portEXIT_CRITICAL(mux)        ((void)(mux))
+
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vTaskDelete(TaskHandle_t task);
+BaseType_t xTaskCreate(void (*function)(void *), const char *name, uint32_t stack_size, void *arg,
+                       UBaseType_t priority, TaskHandle_t *task);
+BaseType_t xTaskNotifyIndexed(TaskHandle_t task, UBaseType_t index, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyWaitIndexed(UBaseType_t index, uint32_t clear_on_entry, uint32_t clear_on_exit,
+                                  uint32_t *value, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+
+#define xTaskNotify(task, value, action)              xTaskNotifyIndexed((task), 0, (value), (action))
+#define xTaskNotifyWait(entry, exit, value, ticks)    xTaskNotifyWaitIndexed(0, (entry), (exit), (value), (ticks))
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#define xQueueSendToBack(queue, item, ticks)  xQueueSend((queue), (item), (ticks))
+
+/* esp_log.h */
+typedef enum {
+  ESP_LOG_NONE = 0,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+extern esp_log_level_t host_shim_log_level;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+
+#define HOST_SHIM_LOG(level, letter, tag, format, ...) do {                 \
+  if ((level) <= host_shim_log_level) {                                     \
+    printf(letter " (%s) " format "\n", (tag), ##__VA_ARGS__);             \
+  }                                                                         \
+} while (0)
+
+#define ESP_LOGE(tag, format, ...)  HOST_SHIM_LOG(ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)  HOST_SHIM_LOG(ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)  HOST_SHIM_LOG(ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)  HOST_SHIM_LOG(ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)  HOST_SHIM_LOG(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
+
+/* esp_timer.h, esp_rom_sys.h, esp_cpu.h */
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *);
+
+typedef enum {
+  ESP_TIMER_TASK = 0,
+  ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct {
+  esp_timer_cb_t callback;
+  void *arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char *name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+int64_t esp_timer_get_time(void);
+void esp_rom_delay_us(uint32_t us);
+uint32_t esp_cpu_get_cycle_count(void);
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *data, uint32_t length);
+
+/* esp_sleep.h, esp_task_wdt.h */
+typedef enum {
+  ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+  ESP_SLEEP_WAKEUP_TIMER = 4,
+} esp_sleep_wakeup_cause_t;
+
+extern esp_sleep_wakeup_cause_t host_shim_wakeup_cause;
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void);
+
+/* nvs.h, nvs_flash.h: an in-memory partition, gone with the process. */
+#define NVS_KEY_NAME_MAX_SIZE   (16)
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+  NVS_READONLY = 0,
+  NVS_READWRITE,
+} nvs_open_mode_t;
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length);
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value);
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value);
+
+/* soc/gpio_num.h, hal/gpio_types.h, driver/gpio.h */
+typedef enum {
+  GPIO_NUM_NC = -1,
+  GPIO_NUM_16 = 16,
+  GPIO_NUM_17 = 17,
+  GPIO_NUM_21 = 21,
+  GPIO_NUM_22 = 22,
+} gpio_num_t;
+
+typedef enum {
+  GPIO_PULLUP_DISABLE = 0,
+  GPIO_PULLUP_ENABLE,
+} gpio_pullup_t;
+
+/* hal/i2c_types.h, driver/i2c.h: the types, the simulator stands in for the driver. */
+typedef int i2c_port_t;
+
+#define I2C_NUM_0     (0)
+#define I2C_NUM_1     (1)
+#define I2C_NUM_MAX   (2)
+
+typedef enum {
+  I2C_MODE_SLAVE = 0,
+  I2C_MODE_MASTER,
+} i2c_mode_t;
+
+typedef struct {
+  i2c_mode_t mode;
+  int sda_io_num;
+  int scl_io_num;
+  bool sda_pullup_en;
+  bool scl_pullup_en;
+  union {
+    struct {
+      uint32_t clk_speed;
+    } master;
+  };
+  uint32_t clk_flags;
+} i2c_config_t;
+
+#define I2C_LINK_RECOMMENDED_SIZE(transactions)   (2 * (transactions) * 20 + 20)
+
+/* hal/uart_types.h, driver/uart.h */
+typedef int uart_port_t;
+
+#define UART_NUM_2    (2)
+
+typedef enum {
+  UART_DATA_8_BITS = 3,
+} uart_word_length_t;
+
+typedef enum {
+  UART_PARITY_DISABLE = 0,
+} uart_parity_t;
+
+typedef enum {
+  UART_STOP_BITS_1 = 1,
+} uart_stop_bits_t;
+
+typedef enum {
+  UART_HW_FLOWCTRL_DISABLE = 0,
+} uart_hw_flowcontrol_t;
+
+typedef enum {
+  UART_SCLK_DEFAULT = 0,
+} uart_sclk_t;
+
+typedef struct {
+  int baud_rate;
+  uart_word_length_t data_bits;
+  uart_parity_t parity;
+  uart_stop_bits_t stop_bits;
+  uart_hw_flowcontrol_t flow_ctrl;
+  uint8_t rx_flow_ctrl_thresh;
+  uart_sclk_t source_clk;
+} uart_config_t;
+
+typedef enum {
+  UART_DATA = 0,
+  UART_BREAK,
+  UART_BUFFER_FULL,
+  UART_FIFO_OVF,
+  UART_FRAME_ERR,
+  UART_PARITY_ERR,
+  UART_DATA_BREAK,
+  UART_PATTERN_DET,
+  UART_EVENT_MAX,
+} uart_event_type_t;
+
+typedef struct {
+  uart_event_type_t type;
+  size_t size;
+  bool timeout_flag;
+} uart_event_t;
+
+/* esp_event.h, esp_wifi.h, mqtt_client.h */
+typedef const char *esp_event_base_t;
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef struct {
+  struct {
+    struct {
+      const char *uri;
+    } address;
+  } broker;
+} esp_mqtt_client_config_t;
+
+typedef struct {
+  struct {
+    uint8_t ssid[32];
+    uint8_t password[64];
+  } sta;
+} wifi_config_t;
+
+/**
+ * \brief Move the virtual clock forward.
+ *
+ * \param[in]   us: Microseconds to add.
+ */
+void host_shim_advance_us(int64_t us);
+
+/**
+ * \brief Forget everything the in-memory NVS holds, like a fresh flash.
+ */
+void host_shim_nvs_erase(void);
+
+/**
+ * \brief Monotonic host time, for timing the code itself.
+ *
+ * \return      Nanoseconds of CLOCK_MONOTONIC.
+ */
+uint64_t host_shim_wall_ns(void);
+
+#endif // !TEST_SHIM_HOST_SHIM_H
@@ -0,0 +1 @@
+#include "host_shim.h"
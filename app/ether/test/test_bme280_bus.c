@@ -0,0 +1,400 @@
+/*
+ * BME280 driver and state machine on the simulated I2C bus.
+ *
+ * Every sample prints the bus transactions and bytes it took, the bus time
+ * at the simulated clock, the time spent waiting on the virtual clock and
+ * the host time spent in the code, so the output can be compared between
+ * builds. The compensated values are checked against the environment the
+ * simulated sensor measures, any failed check fails the test.
+ */
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include "nvs.h"
+#include "state_machine.h"
+#include "i2c_simulator.h"
+
+#define TEST_SAMPLES            (8)       /*!< Samples per scenario. */
+#define TEST_CYCLE_RETRIES      (5)       /*!< Failed states a cycle tolerates, as in the BME280 task. */
+#define TEST_TEMPERATURE_DELTA  (0.1)     /*!< Tolerated temperature error in degC. */
+#define TEST_PRESSURE_DELTA     (5.0)     /*!< Tolerated pressure error in Pa. */
+#define TEST_HUMIDITY_DELTA     (1.0)     /*!< Tolerated humidity error in %. */
+#define TEST_PAIR_SAMPLES       (4)       /*!< Interleaved samples per sensor of a pair. */
+
+#define TEST_CHECK(condition) do {                                          \
+  if (!(condition)) {                                                       \
+    printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);            \
+    ++test_failures;                                                        \
+  }                                                                         \
+} while (0)
+
+/**
+ * \brief Structure for what one state machine cycle cost.
+ */
+typedef struct {
+  bool success;                   /*!< Cycle reached BME280_STATE_UNSET. */
+  i2c_simulator_stats_t stats;    /*!< Bus counters of the cycle. */
+  int64_t wait_us;                /*!< Virtual time spent waiting. */
+  uint64_t host_ns;               /*!< Host time spent in the code. */
+} test_cycle_t;
+
+static const i2c_simulator_environment_t test_environment = I2C_SIMULATOR_ENVIRONMENT_DEFAULT;
+static const i2c_simulator_environment_t test_secondary_environment = {
+  .temperature = 30.0,
+  .pressure = 95000.0,
+  .humidity = 70.0,
+};
+static ether_t test_ether;
+static bme280_dev_t test_secondary = BME280_DEV(I2C_NUM_0, BME280_I2C_ADDRESS_SECONDARY);
+static unsigned test_failures;
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+static bme280_result_t test_state(ether_t *ether)
+{
+  switch (ether->state_machine.bme280) {
+    case BME280_STATE_RESET: {
+      return state_machine_bme280_reset(ether);
+    }
+    case BME280_STATE_INIT: {
+      bme280_result_t result = state_machine_bme280_init(ether);
+
+      if ((result == BME280_RESULT_SUCCESS) && (bme280_continuous(&ether->descriptor.bme280))) {
+        vTaskDelay(pdMS_TO_TICKS(bme280_measurement_time_us(&ether->descriptor.bme280.settings, true) / 1000) + 1);
+      }
+      return result;
+    }
+    case BME280_STATE_ID: {
+      return state_machine_bme280_id(ether);
+    }
+    case BME280_STATE_GET_COMPENSATION_DATA: {
+      return state_machine_bme280_get_compensation_data(ether);
+    }
+    case BME280_STATE_FORCE_MODE: {
+      return state_machine_bme280_force_mode(ether);
+    }
+    case BME280_STATE_WAIT: {
+      return state_machine_bme280_wait(ether);
+    }
+    case BME280_STATE_MEASURE_HUMIDITY: {
+      return state_machine_bme280_measure_humidity(ether);
+    }
+    case BME280_STATE_MEASURE_TEMPERATURE: {
+      return state_machine_bme280_measure_temperature(ether);
+    }
+    case BME280_STATE_MEASURE_PRESSURE: {
+      return state_machine_bme280_measure_pressure(ether);
+    }
+    case BME280_STATE_MEASURE_ALL: {
+      return state_machine_bme280_measure_all(ether);
+    }
+    case BME280_STATE_COMPENSATE: {
+      return state_machine_bme280_compensate(ether);
+    }
+    default: {
+      ether->state_machine.bme280 = BME280_STATE_UNSET;
+      return BME280_RESULT_SUCCESS;
+    }
+  }
+}
+
+/* One pass of the BME280 task, from the given state to BME280_STATE_UNSET. */
+static test_cycle_t test_cycle(ether_t *ether, bme280_state_t state)
+{
+  test_cycle_t cycle = { 0 };
+  uint8_t retry = 0;
+  int64_t start_us;
+  uint64_t start_ns;
+
+  i2c_simulator_stats_reset(I2C_NUM_0);
+  ether->state_machine.bme280 = state;
+  start_us = esp_timer_get_time();
+  start_ns = host_shim_wall_ns();
+
+  while ((ether->state_machine.bme280 != BME280_STATE_UNSET) && (retry < TEST_CYCLE_RETRIES)) {
+    if (test_state(ether) != BME280_RESULT_SUCCESS) {
+      ++retry;
+    }
+  }
+
+  cycle.host_ns = host_shim_wall_ns() - start_ns;
+  cycle.wait_us = esp_timer_get_time() - start_us;
+  cycle.success = (ether->state_machine.bme280 == BME280_STATE_UNSET);
+  i2c_simulator_stats(I2C_NUM_0, &cycle.stats);
+
+  return cycle;
+}
+
+static void test_report(const char *name, unsigned sample, const test_cycle_t *cycle)
+{
+  const bme280_measurements_t *measurements = &test_ether.measurements.bme280;
+
+  printf("%-8s %2u: %s %2" PRIu32 " transactions %3" PRIu32 " bytes %5" PRIu64 " us bus %6" PRId64
+         " us waiting %7" PRIu64 " ns host | %.2f degC %.1f Pa %.2f %%\n",
+         name, sample, (cycle->success) ? "ok " : "err", cycle->stats.transfers,
+         cycle->stats.bytes_written + cycle->stats.bytes_read, cycle->stats.busy_us, cycle->wait_us,
+         cycle->host_ns, (double)BME280_TEMPERATURE_CELSIUS(measurements->temperature.compensated),
+         (double)BME280_PRESSURE_PASCALS(measurements->pressure.compensated),
+         (double)BME280_HUMIDITY_PERCENT(measurements->humidity.compensated));
+}
+
+static void test_check_measurements(const bme280_measurements_t *measurements,
+                                    const i2c_simulator_environment_t *environment)
+{
+  TEST_CHECK(fabs((double)BME280_TEMPERATURE_CELSIUS(measurements->temperature.compensated) -
+                  environment->temperature) <= TEST_TEMPERATURE_DELTA);
+  TEST_CHECK(fabs((double)BME280_PRESSURE_PASCALS(measurements->pressure.compensated) -
+                  environment->pressure) <= TEST_PRESSURE_DELTA);
+  TEST_CHECK(fabs((double)BME280_HUMIDITY_PERCENT(measurements->humidity.compensated) -
+                  environment->humidity) <= TEST_HUMIDITY_DELTA);
+}
+
+/* Bring up, then forced samples: mode write, STATUS polls, one burst read. */
+static void test_forced(void)
+{
+  test_cycle_t cycle = test_cycle(&test_ether, BME280_STATE_RESET);
+
+  test_report("setup", 0, &cycle);
+  TEST_CHECK(cycle.success);
+  TEST_CHECK(cycle.stats.measurements == 1);
+  test_check_measurements(&test_ether.measurements.bme280, &test_environment);
+
+  for (unsigned i = 0; i < TEST_SAMPLES; ++i) {
+    cycle = test_cycle(&test_ether, BME280_STATE_FORCE_MODE);
+    test_report("forced", i, &cycle);
+    TEST_CHECK(cycle.success);
+    TEST_CHECK(cycle.stats.measurements == 1);
+    TEST_CHECK(cycle.stats.nacks == 0);
+    test_check_measurements(&test_ether.measurements.bme280, &test_environment);
+  }
+}
+
+/* The conversion wait follows the oversampling, from the typical time to one tick past the maximum. */
+static void test_oversampling(void)
+{
+  const bme280_settings_t settings[] = {
+    { .ctrl_hum = BME280_SETTINGS_OSRS_H_1,
+      .ctrl_meas = (BME280_SETTINGS_OSRS_T_1 | BME280_SETTINGS_OSRS_P_1 | BME280_SETTINGS_MODE_FORCE) },
+    { .ctrl_hum = BME280_SETTINGS_OSRS_H_4,
+      .ctrl_meas = (BME280_SETTINGS_OSRS_T_4 | BME280_SETTINGS_OSRS_P_4 | BME280_SETTINGS_MODE_FORCE) },
+    { .ctrl_hum = BME280_SETTINGS_OSRS_H_16,
+      .ctrl_meas = (BME280_SETTINGS_OSRS_T_16 | BME280_SETTINGS_OSRS_P_16 | BME280_SETTINGS_MODE_FORCE) },
+  };
+  const bme280_settings_t restore = BME280_SETTINGS_DEFAULT;
+  const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+  const unsigned oversampling[] = { 1, 4, 16 };
+  test_cycle_t cycle;
+
+  for (size_t i = 0; i < (sizeof(settings) / sizeof(settings[0])); ++i) {
+    uint32_t typical_us = bme280_measurement_time_us(&settings[i], false);
+    uint32_t max_us = bme280_measurement_time_us(&settings[i], true);
+
+    test_ether.descriptor.bme280.settings = settings[i];
+    cycle = test_cycle(&test_ether, BME280_STATE_INIT);
+    TEST_CHECK(cycle.success);
+
+    cycle = test_cycle(&test_ether, BME280_STATE_FORCE_MODE);
+    printf("x%-2u      %6" PRId64 " us waiting, %6" PRIu32 " us typical %6" PRIu32 " us max\n",
+           oversampling[i], cycle.wait_us, typical_us, max_us);
+    TEST_CHECK(cycle.success);
+    TEST_CHECK(cycle.stats.measurements == 1);
+    TEST_CHECK(cycle.wait_us >= typical_us);
+    TEST_CHECK(cycle.wait_us <= ((max_us + tick_us - 1) / tick_us + 1) * tick_us);
+    test_check_measurements(&test_ether.measurements.bme280, &test_environment);
+  }
+
+  test_ether.descriptor.bme280.settings = restore;
+  cycle = test_cycle(&test_ether, BME280_STATE_INIT);
+  TEST_CHECK(cycle.success);
+}
+
+/* Normal mode reads the latest conversion with a single transaction and no wait. */
+static void test_normal(void)
+{
+  const bme280_settings_t settings = BME280_SETTINGS_NORMAL;
+  test_cycle_t cycle;
+
+  test_ether.descriptor.bme280.settings = settings;
+  cycle = test_cycle(&test_ether, BME280_STATE_INIT);
+  test_report("switch", 0, &cycle);
+  TEST_CHECK(cycle.success);
+
+  for (unsigned i = 0; i < TEST_SAMPLES; ++i) {
+    cycle = test_cycle(&test_ether, BME280_STATE_MEASURE_ALL);
+    test_report("normal", i, &cycle);
+    TEST_CHECK(cycle.success);
+    TEST_CHECK(cycle.stats.transfers == 1);
+    TEST_CHECK(cycle.wait_us == 0);
+    test_check_measurements(&test_ether.measurements.bme280, &test_environment);
+  }
+
+  /* The configuration is already in the sensor, the register shadow knows it. */
+  i2c_simulator_stats_reset(I2C_NUM_0);
+  TEST_CHECK(bme280_init(&test_ether.descriptor.bme280) == BME280_RESULT_SUCCESS);
+  i2c_simulator_stats(I2C_NUM_0, &cycle.stats);
+  printf("re-init      %2" PRIu32 " transactions\n", cycle.stats.transfers);
+  TEST_CHECK(cycle.stats.transfers == 0);
+}
+
+/* Faults on the bus, in normal mode so that every transaction is a sample. */
+static void test_faults(void)
+{
+  const i2c_simulator_fault_t nack = { .nacks = 1 };
+  const i2c_simulator_fault_t stuck = { .stuck_pulses = 3 };
+  const i2c_simulator_fault_t stretch = { .delay_us = 100000 };
+  const i2c_simulator_fault_t none = { 0 };
+  test_cycle_t cycle;
+
+  /* The device retry absorbs a single NACK. */
+  i2c_simulator_inject(I2C_NUM_0, &nack);
+  cycle = test_cycle(&test_ether, BME280_STATE_MEASURE_ALL);
+  test_report("nack", 0, &cycle);
+  TEST_CHECK(cycle.success);
+  TEST_CHECK(cycle.stats.nacks == 1);
+  TEST_CHECK(cycle.stats.transfers == 2);
+  test_check_measurements(&test_ether.measurements.bme280, &test_environment);
+
+  /* A held SDA is released by the bus clear and the transfer goes through. */
+  i2c_simulator_inject(I2C_NUM_0, &stuck);
+  cycle = test_cycle(&test_ether, BME280_STATE_MEASURE_ALL);
+  test_report("stuck", 0, &cycle);
+  TEST_CHECK(cycle.success);
+  TEST_CHECK(cycle.stats.recoveries >= 1);
+  test_check_measurements(&test_ether.measurements.bme280, &test_environment);
+
+  /* Stretching past the deadline fails the cycle, the next one is fine again. */
+  i2c_simulator_inject(I2C_NUM_0, &stretch);
+  cycle = test_cycle(&test_ether, BME280_STATE_MEASURE_ALL);
+  test_report("stretch", 0, &cycle);
+  TEST_CHECK(!cycle.success);
+  TEST_CHECK(cycle.stats.timeouts >= 1);
+
+  i2c_simulator_inject(I2C_NUM_0, &none);
+  cycle = test_cycle(&test_ether, BME280_STATE_MEASURE_ALL);
+  test_report("cleared", 0, &cycle);
+  TEST_CHECK(cycle.success);
+  test_check_measurements(&test_ether.measurements.bme280, &test_environment);
+}
+
+/* Cold boot with a calibration blob in NVS, the sensor behind it is checked first. */
+static void test_cache(void)
+{
+  bme280_dev_t *dev = &test_secondary;
+  bme280_cache_entry_t entry = { 0 };
+  i2c_simulator_stats_t stats;
+  char key[NVS_KEY_NAME_MAX_SIZE];
+  nvs_handle_t handle;
+
+  TEST_CHECK(i2c_simulator_attach_bme280(I2C_NUM_0, dev->device.address) == I2C_SIMULATOR_RESULT_SUCCESS);
+  TEST_CHECK(i2c_controller_device_register(&dev->device) == I2C_CONTROLLER_RESULT_SUCCESS);
+  TEST_CHECK(bme280_read_calibration(dev, entry.raw, sizeof(entry.raw)) == BME280_RESULT_SUCCESS);
+
+  /* A blob as bme280_cache_store leaves it, but of another part: dig_T1 differs. */
+  entry.magic = BME280_CACHE_MAGIC;
+  entry.chip_id = BME280_DATA_ID;
+  entry.address = dev->device.address;
+  entry.i2c_num = (uint8_t)dev->device.i2c_num;
+  entry.raw[0] ^= 0x01;
+  entry.raw_crc = esp_rom_crc32_le(0, entry.raw, sizeof(entry.raw));
+  snprintf(key, sizeof(key), "calib_%u_%02x", (unsigned)dev->device.i2c_num, dev->device.address);
+  TEST_CHECK(nvs_open(BME280_CACHE_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK);
+  TEST_CHECK(nvs_set_blob(handle, key, &entry, sizeof(entry)) == ESP_OK);
+
+  i2c_simulator_stats_reset(I2C_NUM_0);
+  TEST_CHECK(bme280_cache_load(dev, BME280_DATA_ID) == BME280_CACHE_RESULT_ERROR);
+  i2c_simulator_stats(I2C_NUM_0, &stats);
+  printf("swapped      %2" PRIu32 " transactions %3" PRIu32 " bytes\n", stats.transfers, stats.bytes_read);
+  TEST_CHECK(stats.transfers == 1);
+
+  /* The same part, trusted after the same single read. */
+  entry.raw[0] ^= 0x01;
+  entry.raw_crc = esp_rom_crc32_le(0, entry.raw, sizeof(entry.raw));
+  TEST_CHECK(nvs_set_blob(handle, key, &entry, sizeof(entry)) == ESP_OK);
+  nvs_close(handle);
+
+  i2c_simulator_stats_reset(I2C_NUM_0);
+  TEST_CHECK(bme280_cache_load(dev, BME280_DATA_ID) == BME280_CACHE_RESULT_SUCCESS);
+  i2c_simulator_stats(I2C_NUM_0, &stats);
+  printf("cold boot    %2" PRIu32 " transactions %3" PRIu32 " bytes\n", stats.transfers, stats.bytes_read);
+  TEST_CHECK(stats.transfers == 1);
+  TEST_CHECK(stats.bytes_read == BME280_CACHE_VERIFY_SIZE);
+
+  /* From now on RTC memory has it, as after a wake from deep sleep. */
+  i2c_simulator_stats_reset(I2C_NUM_0);
+  TEST_CHECK(bme280_cache_load(dev, BME280_DATA_ID) == BME280_CACHE_RESULT_SUCCESS);
+  i2c_simulator_stats(I2C_NUM_0, &stats);
+  printf("wake         %2" PRIu32 " transactions\n", stats.transfers);
+  TEST_CHECK(stats.transfers == 0);
+}
+
+/* One sample of a sensor outside the state machine, as a second sensor would be read. */
+static bool test_sample(bme280_dev_t *dev, bme280_measurements_t *measurements)
+{
+  if ((!bme280_continuous(dev)) &&
+      ((bme280_force_mode(dev) != BME280_RESULT_SUCCESS) || (bme280_wait(dev) != BME280_RESULT_SUCCESS))) {
+    return false;
+  }
+
+  return ((bme280_measure_all(dev, measurements) == BME280_RESULT_SUCCESS) &&
+          (bme280_compensate(dev, measurements) == BME280_RESULT_SUCCESS));
+}
+
+/* 0x76 and 0x77 on one bus, interleaved, each reads its own environment. */
+static void test_pair(void)
+{
+  bme280_measurements_t primary = { 0 };
+  bme280_measurements_t secondary = { 0 };
+
+  TEST_CHECK(i2c_simulator_set_environment(I2C_NUM_0, test_secondary.device.address,
+                                           &test_secondary_environment) == I2C_SIMULATOR_RESULT_SUCCESS);
+  TEST_CHECK(bme280_init(&test_secondary) == BME280_RESULT_SUCCESS);
+
+  for (unsigned i = 0; i < TEST_PAIR_SAMPLES; ++i) {
+    TEST_CHECK(test_sample(&test_ether.descriptor.bme280, &primary));
+    TEST_CHECK(test_sample(&test_secondary, &secondary));
+    printf("pair     %2u: 0x%02x %.2f degC %.1f Pa %.2f %% | 0x%02x %.2f degC %.1f Pa %.2f %%\n", i,
+           test_ether.descriptor.bme280.device.address,
+           (double)BME280_TEMPERATURE_CELSIUS(primary.temperature.compensated),
+           (double)BME280_PRESSURE_PASCALS(primary.pressure.compensated),
+           (double)BME280_HUMIDITY_PERCENT(primary.humidity.compensated), test_secondary.device.address,
+           (double)BME280_TEMPERATURE_CELSIUS(secondary.temperature.compensated),
+           (double)BME280_PRESSURE_PASCALS(secondary.pressure.compensated),
+           (double)BME280_HUMIDITY_PERCENT(secondary.humidity.compensated));
+    test_check_measurements(&primary, &test_environment);
+    test_check_measurements(&secondary, &test_secondary_environment);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+int main(void)
+{
+  const i2c_controller_descriptor_t descriptor = I2C_CONTROLLER_DESCRIPTOR_DEFAULT;
+  const bme280_dev_t bme280 = BME280_DEV_DEFAULT;
+
+  test_ether.descriptor.bme280 = bme280;
+
+  if ((i2c_controller_init(&descriptor) != I2C_CONTROLLER_RESULT_SUCCESS) ||
+      (i2c_simulator_attach_bme280(I2C_NUM_0, BME280_I2C_ADDRESS) != I2C_SIMULATOR_RESULT_SUCCESS) ||
+      (i2c_simulator_set_environment(I2C_NUM_0, BME280_I2C_ADDRESS, &test_environment) != I2C_SIMULATOR_RESULT_SUCCESS) ||
+      (i2c_controller_device_register(&test_ether.descriptor.bme280.device) != I2C_CONTROLLER_RESULT_SUCCESS) ||
+      (i2c_controller_probe(I2C_NUM_0) != I2C_CONTROLLER_RESULT_SUCCESS)) {
+    printf("FAIL: simulated bus setup\n");
+    return 1;
+  }
+
+  test_forced();
+  test_oversampling();
+  test_normal();
+  test_faults();
+  test_cache();
+  test_pair();
+
+  printf("%u failed checks\n", test_failures);
+
+  return (test_failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+/*
+ * BME280 calibration parsing and compensation against the reference vectors
+ * of bme280_selftest.c, for the compensation this binary was built with. The
+ * CMake project builds it once per compensation, integer, float and double.
+ */
+#include <stdio.h>
+#include "bme280_selftest.h"
+#include "esp_log.h"
+
+int main(void)
+{
+  bme280_selftest_report_t report;
+  bme280_selftest_result_t result;
+
+  host_shim_log_level = ESP_LOG_INFO;
+  result = bme280_selftest_run(&report);
+
+  printf("%lu checks, %lu failures, bme280_compensate() %lu cycles mean, %lu min\n",
+         (unsigned long)report.checks, (unsigned long)report.failures,
+         (unsigned long)report.cycles_mean, (unsigned long)report.cycles_min);
+
+  return ((result == BME280_SELFTEST_RESULT_SUCCESS) && (report.checks > 0)) ? 0 : 1;
+}
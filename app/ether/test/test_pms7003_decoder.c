@@ -0,0 +1,283 @@
+/*
+ * PMS7003 frame decoder on a generated byte stream.
+ *
+ * The stream mixes data frames with junk, false headers, command answers
+ * and corrupted frames, and reaches the decoder in random chunks, as the
+ * UART hands them out. Every data frame must come out once, in order and
+ * byte for byte. The stream is decoded again in one chunk to print the
+ * throughput. Built with the headers in inc/ only, no shim.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pms7003_decoder.h"
+
+#define TEST_STREAM_SIZE      (4u << 20)  /*!< Bytes of the generated stream. */
+#define TEST_CHUNK_MAX        (70)        /*!< Largest chunk fed at once. */
+#define TEST_SEED             (0x2545f491u)
+#define TEST_ANSWER_LENGTH    (0x04)      /*!< Length field of a command answer. */
+#define TEST_ANSWER_COMMAND   (0xe4)      /*!< Sleep set, echoed in its answer. */
+
+#define TEST_CHECK(condition) do {                                          \
+  if (!(condition)) {                                                       \
+    printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);            \
+    ++test_failures;                                                        \
+  }                                                                         \
+} while (0)
+
+/**
+ * \brief Structure for the generated stream and what the decoder must find in it.
+ */
+typedef struct {
+  uint8_t *bytes;                 /*!< The stream. */
+  size_t size;                    /*!< Bytes used. */
+  pms7003_frame_answer_t *frames; /*!< Data frames in stream order. */
+  size_t frame_count;             /*!< Data frames written. */
+  size_t frame_capacity;          /*!< Data frames that fit in frames. */
+  uint32_t answers;               /*!< Valid command answers written. */
+  uint32_t corrupted;             /*!< Data frames with a wrong check code. */
+  uint32_t bad_lengths;           /*!< Headers with an impossible length. */
+} test_stream_t;
+
+static uint32_t test_state = TEST_SEED;
+static unsigned test_failures;
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+static uint32_t test_random(void)
+{
+  /* xorshift32, the same stream on every host. */
+  test_state ^= test_state << 13;
+  test_state ^= test_state >> 17;
+  test_state ^= test_state << 5;
+  return test_state;
+}
+
+static uint64_t test_now_ns(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+}
+
+static void test_seal(uint8_t *frame, uint16_t length)
+{
+  uint16_t sum = 0;
+  size_t end = PMS7003_DECODER_HEADER_SIZE + length;
+
+  for (size_t i = 0; i < end - sizeof(uint16_t); ++i) {
+    sum += frame[i];
+  }
+
+  frame[end - 2] = (uint8_t)(sum >> 8);
+  frame[end - 1] = (uint8_t)(sum & 0xff);
+}
+
+static void test_header(uint8_t *frame, uint16_t length)
+{
+  frame[0] = PMS7003_START_CHARACTER_1;
+  frame[1] = PMS7003_START_CHARACTER_2;
+  frame[2] = (uint8_t)(length >> 8);
+  frame[3] = (uint8_t)(length & 0xff);
+}
+
+static void test_append(test_stream_t *stream, const uint8_t *data, size_t size)
+{
+  memcpy(stream->bytes + stream->size, data, size);
+  stream->size += size;
+}
+
+static void test_append_frame(test_stream_t *stream)
+{
+  pms7003_frame_answer_t frame;
+
+  test_header(frame.buffer_answer, PMS7003_DECODER_DATA_LENGTH);
+
+  for (size_t i = PMS7003_DECODER_HEADER_SIZE; i < PMS7003_FRAME_ANSWER_SIZE; ++i) {
+    frame.buffer_answer[i] = (uint8_t)test_random();
+  }
+
+  test_seal(frame.buffer_answer, PMS7003_DECODER_DATA_LENGTH);
+  test_append(stream, frame.buffer_answer, sizeof(frame.buffer_answer));
+  stream->frames[stream->frame_count++] = frame;
+}
+
+static void test_append_noise(test_stream_t *stream)
+{
+  uint8_t bytes[PMS7003_FRAME_ANSWER_SIZE];
+
+  switch (test_random() % 5) {
+    case 0: {
+      /* Junk, start characters included. */
+      size_t size = 1 + (test_random() % sizeof(bytes));
+
+      for (size_t i = 0; i < size; ++i) {
+        bytes[i] = (test_random() & 1) ? PMS7003_START_CHARACTER_1 : (uint8_t)test_random();
+      }
+      test_append(stream, bytes, size);
+      break;
+    }
+    case 1: {
+      /* A header with a length no frame has. */
+      uint16_t length = (test_random() & 1) ? (uint16_t)(test_random() % sizeof(uint16_t))
+                                             : (uint16_t)(PMS7003_DECODER_DATA_LENGTH + 1 + (test_random() % 0xff00));
+
+      test_header(bytes, length);
+      test_append(stream, bytes, PMS7003_DECODER_HEADER_SIZE);
+      stream->bad_lengths++;
+      break;
+    }
+    case 2: {
+      /* A header cut short by a real frame. */
+      test_header(bytes, PMS7003_DECODER_DATA_LENGTH);
+      test_append(stream, bytes, 1 + (test_random() % PMS7003_DECODER_HEADER_SIZE));
+      break;
+    }
+    case 3: {
+      /* The answer to a command, valid but no data. */
+      test_header(bytes, TEST_ANSWER_LENGTH);
+      bytes[4] = TEST_ANSWER_COMMAND;
+      bytes[5] = (uint8_t)test_random();
+      test_seal(bytes, TEST_ANSWER_LENGTH);
+      test_append(stream, bytes, PMS7003_DECODER_HEADER_SIZE + TEST_ANSWER_LENGTH);
+      stream->answers++;
+      break;
+    }
+    default: {
+      /* A data frame with one byte broken, possibly cut short. */
+      test_header(bytes, PMS7003_DECODER_DATA_LENGTH);
+
+      for (size_t i = PMS7003_DECODER_HEADER_SIZE; i < sizeof(bytes); ++i) {
+        bytes[i] = (uint8_t)test_random();
+      }
+
+      test_seal(bytes, PMS7003_DECODER_DATA_LENGTH);
+      bytes[PMS7003_DECODER_HEADER_SIZE + (test_random() % PMS7003_DECODER_DATA_LENGTH)] ^= (uint8_t)(1 + (test_random() % 0xff));
+
+      if (test_random() & 1) {
+        test_append(stream, bytes, sizeof(bytes));
+        stream->corrupted++;
+      } else {
+        test_append(stream, bytes, PMS7003_DECODER_HEADER_SIZE + (test_random() % PMS7003_DECODER_DATA_LENGTH));
+      }
+      break;
+    }
+  }
+}
+
+static bool test_generate(test_stream_t *stream)
+{
+  memset(stream, 0, sizeof(*stream));
+  stream->frame_capacity = TEST_STREAM_SIZE / PMS7003_FRAME_ANSWER_SIZE;
+  stream->bytes = malloc(TEST_STREAM_SIZE);
+  stream->frames = malloc(stream->frame_capacity * sizeof(*stream->frames));
+
+  if ((!stream->bytes) || (!stream->frames)) {
+    return false;
+  }
+
+  /* Every piece is at most a frame long, the last two always fit. */
+  while (stream->size + (2 * PMS7003_FRAME_ANSWER_SIZE) <= TEST_STREAM_SIZE) {
+    if (test_random() & 1) {
+      test_append_noise(stream);
+    }
+    test_append_frame(stream);
+  }
+
+  return true;
+}
+
+static void test_chunks(const test_stream_t *stream)
+{
+  pms7003_decoder_t decoder = PMS7003_DECODER_DEFAULT;
+  size_t found = 0;
+  bool in_order = true;
+
+  for (size_t offset = 0; offset < stream->size;) {
+    size_t size = 1 + (test_random() % TEST_CHUNK_MAX);
+
+    if (size > stream->size - offset) {
+      size = stream->size - offset;
+    }
+
+    /* The receiver feeds what is left after each frame. */
+    while (size > 0) {
+      const pms7003_frame_answer_t *frame;
+      size_t used = pms7003_decoder_feed(&decoder, stream->bytes + offset, size, &frame);
+
+      offset += used;
+      size -= used;
+
+      if (!frame) {
+        continue;
+      }
+
+      if ((found >= stream->frame_count) ||
+          (memcmp(frame->buffer_answer, stream->frames[found].buffer_answer, PMS7003_FRAME_ANSWER_SIZE) != 0)) {
+        in_order = false;
+      }
+      ++found;
+    }
+  }
+
+  printf("chunks: %zu bytes, %zu of %zu frames, %" PRIu32 " ignored, %" PRIu32 " check code errors, "
+         "%" PRIu32 " length errors, %" PRIu32 " skipped\n",
+         stream->size, found, stream->frame_count, decoder.ignored, decoder.check_code_errors,
+         decoder.length_errors, decoder.skipped);
+
+  TEST_CHECK(in_order);
+  TEST_CHECK(found == stream->frame_count);
+  TEST_CHECK(decoder.frames == stream->frame_count);
+  TEST_CHECK(decoder.ignored >= stream->answers);
+  TEST_CHECK(decoder.check_code_errors >= stream->corrupted);
+  TEST_CHECK(decoder.length_errors >= stream->bad_lengths);
+}
+
+static void test_throughput(const test_stream_t *stream)
+{
+  pms7003_decoder_t decoder = PMS7003_DECODER_DEFAULT;
+  const pms7003_frame_answer_t *frame;
+  uint64_t start = test_now_ns();
+
+  for (size_t offset = 0; offset < stream->size;) {
+    offset += pms7003_decoder_feed(&decoder, stream->bytes + offset, stream->size - offset, &frame);
+  }
+
+  uint64_t elapsed = test_now_ns() - start;
+
+  printf("throughput: %.1f MB/s, %.1f ns per frame\n",
+         (elapsed > 0) ? ((double)stream->size * 1000.0 / (double)elapsed) : 0.0,
+         (double)elapsed / (double)((decoder.frames > 0) ? decoder.frames : 1));
+
+  TEST_CHECK(decoder.frames == stream->frame_count);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+int main(void)
+{
+  test_stream_t stream;
+
+  if (!test_generate(&stream)) {
+    printf("FAIL: stream allocation\n");
+    return 1;
+  }
+
+  test_chunks(&stream);
+  test_throughput(&stream);
+
+  free(stream.bytes);
+  free(stream.frames);
+
+  printf("%u failed checks\n", test_failures);
+
+  return (test_failures == 0) ? 0 : 1;
+}
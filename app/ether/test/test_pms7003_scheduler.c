@@ -0,0 +1,231 @@
+/*
+ * PMS7003 fan scheduler driven by a model of the task chain.
+ *
+ * Every cycle the PMS7003 task either skips the sensor or wakes it, waits
+ * for the warmup, reads for PMS7003_SCHEDULER_READ_MS and puts it to sleep
+ * unless it should stay awake; the BME280 and MQTT tasks then take
+ * TEST_CHAIN_MS or a shorter chain. Each scenario prints the spacing of
+ * the readings and the fan duty, and checks them against the period and
+ * the fan life it asked for. One scenario fails a burst of windows, the
+ * task retries them as it does a failed aggregate. A last scenario resets
+ * a fan that is never put to sleep and checks the on-time NVS kept.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "nvs.h"
+#include "pms7003_scheduler.h"
+
+#define TEST_CYCLES           (200)       /*!< Chain cycles per scenario. */
+#define TEST_CHAIN_MS         (61000)     /*!< BME280 and MQTT tasks, the 60 s MQTT delay included. */
+#define TEST_SHORT_CHAIN_MS   (5000)      /*!< A chain short enough to keep the fan running. */
+#define TEST_COMMAND_MS       (500)       /*!< Delay after a wakeup or sleep command. */
+#define TEST_RETRIES          (5)         /*!< Failed windows a cycle tolerates, as in the PMS7003 task. */
+#define TEST_RESET_MS         (3 * PMS7003_SCHEDULER_SAVE_S * 1000LL)   /*!< Uptime before the reset. */
+
+#define TEST_CHECK(condition) do {                                          \
+  if (!(condition)) {                                                       \
+    printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);            \
+    ++test_failures;                                                        \
+  }                                                                         \
+} while (0)
+
+/**
+ * \brief Structure for what a scenario asks for and what it got.
+ */
+typedef struct {
+  const char *name;               /*!< Printed name. */
+  uint32_t period_s;              /*!< Wanted time between two readings. */
+  uint32_t service_h;             /*!< Wanted fan service life. */
+  uint32_t chain_ms;              /*!< Time the rest of the chain takes. */
+  uint32_t fail_first;            /*!< First reading window that fails. */
+  uint32_t fail_windows;          /*!< Reading windows that fail from there, 0 for none. */
+  uint32_t windows;               /*!< Reading windows run. */
+  uint32_t failed;                /*!< Reading windows without a result. */
+  bool pending;                   /*!< The last cycle ended without a reading. */
+  uint32_t late;                  /*!< Cycles skipped although the last one had no reading. */
+  uint32_t readings;              /*!< Cycles that read the sensor. */
+  uint32_t skipped;               /*!< Cycles that skipped it. */
+  int64_t first_read_ms;          /*!< Start of the first reading. */
+  uint64_t first_on_ms;           /*!< Fan on-time at the first reading. */
+  uint64_t last_on_ms;            /*!< Fan on-time at the last reading. */
+  int64_t min_spacing_ms;         /*!< Shortest time between two readings. */
+  int64_t max_task_ms;            /*!< Longest time the PMS7003 task held the chain. */
+} test_scenario_t;
+
+static int64_t test_now_ms;
+static unsigned test_failures;
+
+///////////////////////////////////////////////////////////////////////////////
+/* BEGIN OF STATIC FUNCTIONS                                                 */
+///////////////////////////////////////////////////////////////////////////////
+
+static bool test_window_fails(test_scenario_t *scenario)
+{
+  uint32_t window = scenario->windows++;
+
+  return ((window >= scenario->fail_first) && (window - scenario->fail_first < scenario->fail_windows));
+}
+
+static void test_task(pms7003_scheduler_t *scheduler, test_scenario_t *scenario)
+{
+  int64_t start = test_now_ms;
+
+  if (!pms7003_scheduler_due(scheduler, test_now_ms)) {
+    scenario->skipped++;
+    scenario->late += (scenario->pending) ? 1 : 0;
+    return;
+  }
+
+  if (!scheduler->awake) {
+    test_now_ms += TEST_COMMAND_MS;
+  }
+
+  pms7003_scheduler_wakeup(scheduler, test_now_ms);
+  test_now_ms += pms7003_scheduler_warmup_left(scheduler, test_now_ms);
+  scenario->pending = true;
+
+  for (uint32_t retry = 0; (scenario->pending) && (retry < TEST_RETRIES); ++retry) {
+    int64_t window = test_now_ms;
+
+    test_now_ms += PMS7003_SCHEDULER_READ_MS;
+
+    /* No result, the fan keeps running for the retry. */
+    if (test_window_fails(scenario)) {
+      scenario->failed++;
+      continue;
+    }
+
+    if (scheduler->read_ms >= 0) {
+      int64_t spacing = window - scheduler->read_ms;
+
+      if ((scenario->min_spacing_ms < 0) || (spacing < scenario->min_spacing_ms)) {
+        scenario->min_spacing_ms = spacing;
+      }
+    } else {
+      scenario->first_read_ms = window;
+      scenario->first_on_ms = pms7003_scheduler_on_time(scheduler, window);
+    }
+
+    pms7003_scheduler_read(scheduler, window);
+    scenario->last_on_ms = pms7003_scheduler_on_time(scheduler, window);
+    scenario->readings++;
+    scenario->pending = false;
+
+    if (!pms7003_scheduler_keep_awake(scheduler, test_now_ms)) {
+      pms7003_scheduler_sleep(scheduler, test_now_ms);
+      test_now_ms += TEST_COMMAND_MS;
+    }
+  }
+
+  if ((test_now_ms - start) > scenario->max_task_ms) {
+    scenario->max_task_ms = test_now_ms - start;
+  }
+}
+
+static void test_run(test_scenario_t *scenario)
+{
+  pms7003_scheduler_t scheduler = PMS7003_SCHEDULER_DEFAULT;
+
+  host_shim_nvs_erase();
+  test_now_ms = 0;
+  scenario->first_read_ms = -1;
+  scenario->min_spacing_ms = -1;
+  scheduler.period_ms = scenario->period_s * 1000;
+  scheduler.service_h = scenario->service_h;
+  pms7003_scheduler_restore(&scheduler);
+
+  for (uint32_t i = 0; i < TEST_CYCLES; ++i) {
+    test_task(&scheduler, scenario);
+    test_now_ms += scenario->chain_ms;
+  }
+
+  uint32_t period = pms7003_scheduler_period(&scheduler);
+  double spacing = (double)(scheduler.read_ms - scenario->first_read_ms) / (scenario->readings - 1);
+
+  /* Whole periods only, a run cut right after a reading would look better than it is. */
+  double duty = (double)(scenario->last_on_ms - scenario->first_on_ms) /
+                (double)(scheduler.read_ms - scenario->first_read_ms);
+
+  printf("%-14s %3" PRIu32 " readings, %3" PRIu32 " skipped, %6.1f s apart (min %6.1f s, period %6.1f s), "
+         "duty %.2f, %3" PRIu32 " warmups, task %4.1f s at most, %" PRIu32 " failed windows\n",
+         scenario->name, scenario->readings, scenario->skipped, spacing / 1000.0,
+         (double)scenario->min_spacing_ms / 1000.0, period / 1000.0, duty, scheduler.warmups,
+         (double)scenario->max_task_ms / 1000.0, scenario->failed);
+
+  TEST_CHECK(scenario->readings > 1);
+  TEST_CHECK(scenario->min_spacing_ms >= period);
+
+  /* The chain is never held longer than a wakeup, a warmup and the windows of one cycle. */
+  TEST_CHECK(scenario->max_task_ms <= PMS7003_SCHEDULER_WARMUP_MS + (2 * TEST_COMMAND_MS) +
+                                      (PMS7003_SCHEDULER_READ_MS * ((scenario->fail_windows > 0) ? TEST_RETRIES : 1)));
+
+  /* A cycle without a reading is no reading, the next cycle tries again. */
+  TEST_CHECK(scenario->late == 0);
+  TEST_CHECK(scenario->failed == scenario->fail_windows);
+
+  if (scenario->service_h > PMS7003_SCHEDULER_FAN_RATED_H) {
+    TEST_CHECK(duty <= (double)PMS7003_SCHEDULER_FAN_RATED_H / scenario->service_h);
+  }
+
+  if (scenario->chain_ms == TEST_SHORT_CHAIN_MS) {
+    TEST_CHECK(scheduler.warmups == 1);
+  }
+}
+
+static void test_reset(void)
+{
+  pms7003_scheduler_t scheduler = PMS7003_SCHEDULER_DEFAULT;
+  pms7003_scheduler_t restored = PMS7003_SCHEDULER_DEFAULT;
+  test_scenario_t scenario = { .name = "reset" };
+
+  host_shim_nvs_erase();
+  test_now_ms = 0;
+  scenario.first_read_ms = -1;
+  scenario.min_spacing_ms = -1;
+
+  /* The short chain keeps the fan awake, pms7003_scheduler_sleep() is never called. */
+  while (test_now_ms < TEST_RESET_MS) {
+    test_task(&scheduler, &scenario);
+    test_now_ms += TEST_SHORT_CHAIN_MS;
+  }
+
+  uint64_t on_ms = pms7003_scheduler_on_time(&scheduler, test_now_ms);
+
+  pms7003_scheduler_restore(&restored);
+
+  printf("%-14s fan on %" PRIu64 " s, %" PRIu64 " s kept over the reset\n", scenario.name,
+         on_ms / 1000, restored.on_ms / 1000);
+
+  TEST_CHECK(scheduler.awake);
+  TEST_CHECK(restored.on_ms > 0);
+  TEST_CHECK(restored.on_ms + (PMS7003_SCHEDULER_SAVE_S * 1000ULL) >= on_ms);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* END OF STATIC FUNCTIONS                                                   */
+///////////////////////////////////////////////////////////////////////////////
+
+int main(void)
+{
+  test_scenario_t scenarios[] = {
+    { .name = "default", .chain_ms = TEST_CHAIN_MS },
+    { .name = "300 s period", .period_s = 300, .chain_ms = TEST_CHAIN_MS },
+    { .name = "24000 h life", .service_h = 24000, .chain_ms = TEST_CHAIN_MS },
+    { .name = "80000 h life", .service_h = 80000, .chain_ms = TEST_CHAIN_MS },
+    { .name = "short chain", .chain_ms = TEST_SHORT_CHAIN_MS },
+    /* One whole cycle fails, the next one fails twice before it reads. */
+    { .name = "failed windows", .period_s = 300, .chain_ms = TEST_CHAIN_MS,
+      .fail_first = 10, .fail_windows = TEST_RETRIES + 2 },
+  };
+
+  for (size_t i = 0; i < (sizeof(scenarios) / sizeof(scenarios[0])); ++i) {
+    test_run(&scenarios[i]);
+  }
+
+  test_reset();
+
+  printf("%u failed checks\n", test_failures);
+
+  return (test_failures == 0) ? 0 : 1;
+}